@@ -0,0 +1,296 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "corpus.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <system_error>
+
+namespace sapc::bench {
+    namespace {
+        enum class Kind { Enum, Generic, Struct };
+
+        // Deterministic on every platform, unlike the standard distributions
+        struct Random {
+            std::uint32_t state = 1;
+
+            std::uint32_t next() noexcept {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                return state;
+            }
+
+            int below(int limit) noexcept { return limit > 0 ? static_cast<int>(next() % static_cast<std::uint32_t>(limit)) : 0; }
+            bool percent(int chance) noexcept { return below(100) < chance; }
+        };
+
+        struct Generator {
+            CorpusOptions const& options;
+            Random random;
+            std::vector<std::vector<int>> imports; // per module
+            std::string out;
+
+            Kind kindOf(int index) const noexcept {
+                if (index % 16 == 0)
+                    return Kind::Enum;
+                if ((index * 37 + 11) % 100 < options.generics)
+                    return Kind::Generic;
+                return Kind::Struct;
+            }
+
+            static std::string moduleName(int module) { return "corpus_m" + std::to_string(module); }
+            static std::string nsName(int module, int ns) { return 'm' + std::to_string(module) + "_n" + std::to_string(ns); }
+            static std::string typeName(int module, int ns, int index) { return nsName(module, ns) + "_t" + std::to_string(index); }
+            static std::string noteName(int module) { return 'm' + std::to_string(module) + "_note"; }
+
+            void layout();
+            std::string module(int module);
+            std::string root();
+
+            void declareEnum(int module, int ns, int index);
+            void declareGeneric(int module, int ns, int index);
+            void declareStruct(int module, int ns, int index);
+
+            std::string fieldType(int module, int ns, int index);
+            std::string pickType(int module, int ns, int limit, bool qualified, Kind kind);
+            void annotate(int module, std::string_view indent, std::string_view text);
+        };
+
+        void Generator::layout() {
+            int const modules = std::max(options.modules, 1);
+            int const depth = std::clamp(options.depth, 1, modules);
+
+            std::vector<std::vector<int>> layers(depth);
+            for (int index = 0; index != modules; ++index)
+                layers[static_cast<size_t>(index) * depth / modules].push_back(index);
+
+            imports.resize(modules);
+            for (size_t layer = 1; layer < layers.size(); ++layer) {
+                auto const& below = layers[layer - 1];
+                auto const count = std::min<size_t>(std::max(options.fanOut, 0), below.size());
+                for (int const index : layers[layer])
+                    for (size_t offset = 0; offset != count; ++offset)
+                        imports[index].push_back(below[(index + offset) % below.size()]);
+            }
+        }
+
+        std::string Generator::module(int module) {
+            out.clear();
+            out += "// generated benchmark corpus\n";
+            out += "module " + moduleName(module) + ";\n\n";
+
+            for (int const imported : imports[module])
+                out += "import " + moduleName(imported) + ";\n";
+
+            out += "\nattribute " + noteName(module) + " { string text; int weight = 0; }\n\n";
+            out += "const int m" + std::to_string(module) + "_version = " + std::to_string(module) + ";\n";
+
+            for (int ns = 0; ns != options.namespaces; ++ns) {
+                out += "\nnamespace " + nsName(module, ns) + " {\n";
+                for (int index = 0; index != options.namespaceWidth; ++index) {
+                    switch (kindOf(index)) {
+                    case Kind::Enum: declareEnum(module, ns, index); break;
+                    case Kind::Generic: declareGeneric(module, ns, index); break;
+                    case Kind::Struct: declareStruct(module, ns, index); break;
+                    }
+                }
+                out += "}\n";
+            }
+
+            return out;
+        }
+
+        std::string Generator::root() {
+            // the root imports the top layer, and through it the whole corpus
+            std::vector<int> top;
+            for (int index = 0; index != static_cast<int>(imports.size()); ++index) {
+                bool imported = false;
+                for (auto const& list : imports)
+                    imported = imported || std::find(list.begin(), list.end(), index) != list.end();
+                if (!imported)
+                    top.push_back(index);
+            }
+
+            out.clear();
+            out += "// generated benchmark corpus\nmodule corpus;\n\n";
+            for (int const module : top)
+                out += "import " + moduleName(module) + ";\n";
+
+            out += "\nstruct corpus_root {\n";
+            for (int const module : top) {
+                auto const type = options.namespaces > 0 ? pickType(module, 0, options.namespaceWidth, true, Kind::Struct) : std::string{};
+                out += "    " + (type.empty() ? "int" : type) + " m" + std::to_string(module) + ";\n";
+            }
+            out += "}\n";
+
+            return out;
+        }
+
+        void Generator::declareEnum(int module, int ns, int index) {
+            annotate(module, "    ", "enum");
+            out += "    enum " + typeName(module, ns, index) + " {";
+            int const items = 4 + random.below(5);
+            for (int item = 0; item != items; ++item) {
+                out += item == 0 ? " " : ", ";
+                out += "item" + std::to_string(item);
+                if (item == 0)
+                    out += " = 1";
+            }
+            out += " }\n";
+        }
+
+        void Generator::declareGeneric(int module, int ns, int index) {
+            annotate(module, "    ", "generic");
+            out += "    struct " + typeName(module, ns, index) + "<T> {\n";
+            out += "        T value;\n";
+            out += "        T[] values;\n";
+            out += "        int count = 0;\n";
+            out += "    }\n";
+        }
+
+        void Generator::declareStruct(int module, int ns, int index) {
+            annotate(module, "    ", "struct");
+            out += "    struct " + typeName(module, ns, index) + " {\n";
+            for (int field = 0; field != options.fields; ++field) {
+                annotate(module, "        ", "field");
+                auto const type = fieldType(module, ns, index);
+                out += "        " + type + " f" + std::to_string(field);
+                if (random.below(4) == 0) {
+                    if (type == "int")
+                        out += " = " + std::to_string(random.below(1000));
+                    else if (type == "bool")
+                        out += " = true";
+                    else if (type == "string")
+                        out += " = \"default\"";
+                }
+                out += ";\n";
+            }
+            out += "    }\n";
+        }
+
+        std::string Generator::fieldType(int module, int ns, int index) {
+            static constexpr char const* builtins[] = { "int", "float", "string", "bool", "byte" };
+            auto const builtin = [this] { return std::string{ builtins[random.below(5)] }; };
+
+            auto const& imported = imports[module];
+            auto const importedType = [&](Kind kind) -> std::string {
+                if (imported.empty() || options.namespaces == 0)
+                    return {};
+                return pickType(imported[random.below(static_cast<int>(imported.size()))], random.below(options.namespaces), options.namespaceWidth, true, kind);
+            };
+
+            if (random.percent(options.generics)) {
+                auto generic = pickType(module, ns, index, false, Kind::Generic);
+                if (generic.empty())
+                    generic = importedType(Kind::Generic);
+                if (!generic.empty()) {
+                    auto arg = random.below(2) == 0 ? pickType(module, ns, index, false, Kind::Struct) : std::string{};
+                    return generic + '<' + (arg.empty() ? builtin() : arg) + '>';
+                }
+            }
+
+            std::string type;
+            switch (random.below(8)) {
+            case 2:
+                return builtin() + "[]";
+            case 3:
+            case 4:
+                type = pickType(module, ns, index, false, random.below(4) == 0 ? Kind::Enum : Kind::Struct);
+                break;
+            case 5:
+                if (ns > 0)
+                    type = pickType(module, random.below(ns), options.namespaceWidth, true, Kind::Struct);
+                break;
+            case 6:
+                type = importedType(random.below(4) == 0 ? Kind::Enum : Kind::Struct);
+                break;
+            case 7:
+                type = pickType(module, ns, index, false, Kind::Struct);
+                if (type.empty())
+                    type = importedType(Kind::Struct);
+                if (!type.empty())
+                    type += '*';
+                break;
+            default:
+                break;
+            }
+            return type.empty() ? builtin() : type;
+        }
+
+        // picks a type declared before limit within a namespace, if one of that kind is found
+        std::string Generator::pickType(int module, int ns, int limit, bool qualified, Kind kind) {
+            // enums are every sixteenth type, too sparse to find by chance
+            if (kind == Kind::Enum && limit > 0) {
+                int const index = random.below((limit + 15) / 16) * 16;
+                auto name = typeName(module, ns, index);
+                return qualified ? nsName(module, ns) + '.' + name : name;
+            }
+
+            for (int attempt = 0; attempt != 8 && limit > 0; ++attempt) {
+                int const index = random.below(limit);
+                if (kindOf(index) != kind)
+                    continue;
+                auto name = typeName(module, ns, index);
+                return qualified ? nsName(module, ns) + '.' + name : name;
+            }
+            return {};
+        }
+
+        void Generator::annotate(int module, std::string_view indent, std::string_view text) {
+            if (!random.percent(options.attributes))
+                return;
+
+            // annotations come from this module or, less often, one of its imports
+            auto const& imported = imports[module];
+            int const owner = !imported.empty() && random.below(4) == 0 ? imported[random.below(static_cast<int>(imported.size()))] : module;
+
+            out += indent;
+            out += '[' + noteName(owner) + "(\"";
+            out += text;
+            out += "\"";
+            if (random.below(2) == 0)
+                out += ", " + std::to_string(random.below(100));
+            out += ")]\n";
+        }
+    }
+
+    Corpus generateCorpus(std::filesystem::path const& directory, CorpusOptions const& options) {
+        Generator gen{ options };
+        gen.random.state = options.seed != 0 ? options.seed : 1;
+        gen.layout();
+
+        Corpus corpus;
+        for (int index = 0; index != static_cast<int>(gen.imports.size()); ++index) {
+            auto& mod = corpus.modules.emplace_back();
+            mod.name = Generator::moduleName(index);
+            mod.filename = directory / (mod.name + ".sap");
+            mod.source = gen.module(index);
+            corpus.bytes += mod.source.size();
+        }
+
+        auto& root = corpus.modules.emplace_back();
+        root.name = "corpus";
+        root.filename = directory / "corpus.sap";
+        root.source = gen.root();
+        corpus.bytes += root.source.size();
+
+        return corpus;
+    }
+
+    bool writeCorpus(Corpus const& corpus) {
+        for (auto const& mod : corpus.modules) {
+            std::error_code ec;
+            std::filesystem::create_directories(mod.filename.parent_path(), ec);
+
+            std::ofstream output(mod.filename, std::ios::binary);
+            output << mod.source;
+            if (!output)
+                return false;
+        }
+        return true;
+    }
+}
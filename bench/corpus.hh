@@ -0,0 +1,42 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace sapc::bench {
+    // Shape of a synthetic corpus; the generated sources depend only on these
+    struct CorpusOptions {
+        int modules = 24; // imported modules, not counting the root
+        int depth = 4; // layers of modules beneath the root; each layer imports from the one below
+        int fanOut = 3; // imports per module above the bottom layer
+        int namespaces = 2; // namespaces per module
+        int namespaceWidth = 64; // types per namespace
+        int fields = 8; // fields per struct
+        int generics = 10; // percentage of generic structs, and of fields using a specialization
+        int attributes = 25; // percentage of types and fields with an annotation
+        unsigned seed = 1;
+    };
+
+    struct CorpusModule {
+        std::string name;
+        std::filesystem::path filename;
+        std::string source;
+    };
+
+    struct Corpus {
+        std::vector<CorpusModule> modules; // in dependency order; the root module is last
+        size_t bytes = 0;
+
+        CorpusModule const& root() const { return modules.back(); }
+    };
+
+    Corpus generateCorpus(std::filesystem::path const& directory, CorpusOptions const& options);
+
+    // writes every module of the corpus into its file
+    bool writeCorpus(Corpus const& corpus);
+}
@@ -0,0 +1,63 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "lexer.hh"
+#include "log.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    // Builds a schema resembling generated sources: long runs of structs with
+    // indented fields, annotations, comments and string literals
+    std::string generateSource(int structs) {
+        std::string source = "// generated benchmark input\nmodule bench;\n\n";
+        for (int index = 0; index != structs; ++index) {
+            auto const name = "GeneratedStruct" + std::to_string(index);
+            source += "/* block comment describing " + name + " */\n";
+            source += "[description(\"the " + name + " type\\nsecond line\")]\n";
+            source += "struct " + name + " {\n";
+            for (int field = 0; field != 12; ++field) {
+                source += "    int fieldNumber" + std::to_string(field) + " = " + std::to_string(index * field) + ";\n";
+                source += "    # trailing comment for the field\n";
+            }
+            source += "    string label = \"" + name + "\";\n";
+            source += "    float[] values;\n";
+            source += "}\n\n";
+        }
+        return source;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int const structs = argc > 1 ? std::atoi(argv[1]) : 20000;
+    int const iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    auto const source = generateSource(structs);
+    std::vector<sapc::Token> tokens;
+
+    double best = 0;
+    for (int iteration = 0; iteration != iterations; ++iteration) {
+        tokens.clear();
+        sapc::Log log;
+
+        auto const start = std::chrono::steady_clock::now();
+        if (!sapc::tokenize(source, 0, tokens, log)) {
+            for (auto const& line : log.lines())
+                std::cerr << line << '\n';
+            return 1;
+        }
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+        auto const rate = static_cast<double>(source.size()) / elapsed.count() / (1024.0 * 1024.0);
+        best = std::max(best, rate);
+    }
+
+    std::cout << "lexer: " << source.size() << " bytes, " << tokens.size() << " tokens, best " << best << " MiB/s over " << iterations << " iterations\n";
+    return 0;
+}
@@ -0,0 +1,398 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "corpus.hh"
+
+#include "ast.hh"
+#include "compiler.hh"
+#include "context.hh"
+#include "file_util.hh"
+#include "grammar.hh"
+#include "json.hh"
+#include "lexer.hh"
+#include "log.hh"
+#include "sapc/flat.hh"
+#include "sapc/schema.hh"
+#include "symbol_pool.hh"
+#include "validate.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Each iteration times only the work between start() and stop(), so
+    // setup such as loading the corpus stays out of the measurement
+    struct Timer {
+        Clock::time_point began;
+        double elapsed = 0;
+
+        void start() { began = Clock::now(); }
+        void stop() { elapsed += std::chrono::duration<double>(Clock::now() - began).count(); }
+    };
+
+    struct Benchmark {
+        std::string name;
+        std::function<bool(Timer&)> run;
+        size_t bytes = 0; // input consumed per iteration, for throughput
+    };
+
+    // discards output, counting the bytes written
+    struct NullBuffer : std::streambuf {
+        size_t count = 0;
+
+        int_type overflow(int_type ch) override {
+            ++count;
+            return traits_type::not_eof(ch);
+        }
+        std::streamsize xsputn(char const*, std::streamsize size) override {
+            count += static_cast<size_t>(size);
+            return size;
+        }
+    };
+
+    struct Options {
+        sapc::bench::CorpusOptions corpus;
+        fs::path directory = fs::temp_directory_path() / "sapc_bench";
+        std::string filter;
+        int iterations = 10;
+        bool generateOnly = false;
+    };
+
+    // a context holding the parsed corpus, as the compiler finds it after loading every file
+    struct Loaded {
+        std::unique_ptr<sapc::Context> ctx = std::make_unique<sapc::Context>();
+        std::vector<std::vector<sapc::Token>> tokens;
+        sapc::Log log;
+    };
+
+    bool report(sapc::Log const& log) {
+        for (auto const& line : log.lines())
+            std::cerr << line << '\n';
+        return log.countErrors == 0;
+    }
+
+    bool load(sapc::bench::Corpus const& corpus, Loaded& loaded) {
+        auto& ctx = *loaded.ctx;
+        loaded.log.files = &ctx.files;
+
+        // the generated corpus declares no custom tags
+        sapc::ImportedTags const importedTags;
+
+        for (auto const& mod : corpus.modules) {
+            auto const file = ctx.files.intern(mod.filename);
+            ctx.files.file(file).text = mod.source;
+
+            auto& tokens = loaded.tokens.emplace_back();
+            if (!sapc::tokenize(ctx.files.file(file).text, file, tokens, loaded.log))
+                return report(loaded.log);
+
+            auto unit = sapc::parse(mod.filename, file, tokens, importedTags, ctx.symbols, loaded.log);
+            if (unit == nullptr)
+                return report(loaded.log);
+
+            ctx.astMap.insert({ mod.filename, std::move(unit) });
+        }
+        return true;
+    }
+
+    bool compileLoaded(sapc::bench::Corpus const& corpus, Loaded& loaded) {
+        loaded.ctx->targetFile = corpus.root().filename;
+        return sapc::compile(*loaded.ctx, loaded.log) || report(loaded.log);
+    }
+
+    std::vector<sapc::schema::Module const*> modulesOf(sapc::Context const& ctx) {
+        std::vector<sapc::schema::Module const*> modules;
+        for (auto const& filename : ctx.dependencies)
+            if (auto it = ctx.moduleMap.find(filename); it != ctx.moduleMap.end())
+                modules.push_back(it->second);
+        return modules;
+    }
+
+    std::vector<sapc::flat::Module> flattenAll(sapc::Context const& ctx) {
+        std::vector<sapc::flat::Module> flats;
+        for (auto const* mod : modulesOf(ctx))
+            flats.push_back(sapc::flatten(*mod));
+        return flats;
+    }
+
+    std::vector<Benchmark> benchmarks(sapc::bench::Corpus const& corpus) {
+        std::vector<Benchmark> list;
+
+        list.push_back({ "tokenize", [&corpus](Timer& timer) {
+            sapc::Log log;
+            std::vector<sapc::Token> tokens;
+            timer.start();
+            for (auto const& mod : corpus.modules) {
+                tokens.clear();
+                if (!sapc::tokenize(mod.source, 0, tokens, log))
+                    return report(log);
+            }
+            timer.stop();
+            return true;
+        }, corpus.bytes });
+
+        list.push_back({ "parse", [&corpus](Timer& timer) {
+            sapc::FileTable files;
+            sapc::SymbolPool symbols;
+            sapc::Log log;
+            std::vector<std::vector<sapc::Token>> tokens;
+            std::vector<std::uint32_t> fileIds;
+            for (auto const& mod : corpus.modules) {
+                auto const file = fileIds.emplace_back(files.intern(mod.filename));
+                if (!sapc::tokenize(mod.source, file, tokens.emplace_back(), log))
+                    return report(log);
+            }
+
+            sapc::ImportedTags const importedTags;
+            std::vector<std::unique_ptr<sapc::ast::ModuleUnit>> units;
+
+            timer.start();
+            for (size_t index = 0; index != corpus.modules.size(); ++index) {
+                units.push_back(sapc::parse(corpus.modules[index].filename, fileIds[index], tokens[index], importedTags, symbols, log));
+                if (units.back() == nullptr)
+                    return report(log);
+            }
+            timer.stop();
+            return true;
+        }, corpus.bytes });
+
+        list.push_back({ "compile", [&corpus](Timer& timer) {
+            Loaded loaded;
+            if (!load(corpus, loaded))
+                return false;
+
+            timer.start();
+            auto const compiled = compileLoaded(corpus, loaded);
+            timer.stop();
+            return compiled;
+        }, corpus.bytes });
+
+        list.push_back({ "flatten", [&corpus](Timer& timer) {
+            Loaded loaded;
+            if (!load(corpus, loaded) || !compileLoaded(corpus, loaded))
+                return false;
+
+            auto const modules = modulesOf(*loaded.ctx);
+            std::vector<sapc::flat::Module> flats;
+            flats.reserve(modules.size());
+            timer.start();
+            for (auto const* mod : modules)
+                flats.push_back(sapc::flatten(*mod));
+            timer.stop();
+            return true;
+        }, corpus.bytes });
+
+        // with one thread, and with every core
+        for (unsigned const jobs : { 1u, 0u }) {
+            list.push_back({ jobs == 1 ? "validate" : "validate/parallel", [&corpus, jobs](Timer& timer) {
+                Loaded loaded;
+                if (!load(corpus, loaded) || !compileLoaded(corpus, loaded))
+                    return false;
+
+                auto const flats = flattenAll(*loaded.ctx);
+                timer.start();
+                for (auto const& flat : flats)
+                    if (!sapc::validate(flat, loaded.log, jobs))
+                        return report(loaded.log);
+                timer.stop();
+                return true;
+            }, corpus.bytes });
+        }
+
+        list.push_back({ "serializeToJson", [&corpus](Timer& timer) {
+            Loaded loaded;
+            if (!load(corpus, loaded) || !compileLoaded(corpus, loaded))
+                return false;
+
+            auto const flats = flattenAll(*loaded.ctx);
+            NullBuffer buffer;
+            std::ostream os(&buffer);
+            timer.start();
+            for (auto const& flat : flats)
+                sapc::serializeToJson(os, flat, loaded.ctx->files);
+            timer.stop();
+            return static_cast<bool>(os);
+        }, corpus.bytes });
+
+        // the whole pipeline for the root, reading the corpus from disk
+        list.push_back({ "end-to-end", [&corpus](Timer& timer) {
+            timer.start();
+            sapc::Context ctx;
+            sapc::Log log;
+            log.files = &ctx.files;
+            ctx.targetFile = corpus.root().filename;
+            if (!sapc::compile(ctx, log))
+                return report(log);
+            auto const flat = sapc::flatten(*ctx.rootModule);
+            if (!sapc::validate(flat, log))
+                return report(log);
+
+            NullBuffer buffer;
+            std::ostream os(&buffer);
+            sapc::serializeToJson(os, flat, ctx.files);
+            timer.stop();
+            return true;
+        }, corpus.bytes });
+
+        // every module as its own target in one context, as with multiple inputs
+        list.push_back({ "end-to-end/batch", [&corpus](Timer& timer) {
+            timer.start();
+            sapc::Context ctx;
+            sapc::Log log;
+            log.files = &ctx.files;
+            NullBuffer buffer;
+            std::ostream os(&buffer);
+            for (auto const& mod : corpus.modules) {
+                ctx.targetFile = mod.filename;
+                if (!sapc::compile(ctx, log))
+                    return report(log);
+                auto const flat = sapc::flatten(*ctx.rootModule);
+                if (!sapc::validate(flat, log))
+                    return report(log);
+                sapc::serializeToJson(os, flat, ctx.files);
+            }
+            timer.stop();
+            return true;
+        }, corpus.bytes });
+
+        return list;
+    }
+
+    bool parseInt(std::string_view arg, int& out) {
+        char* end = nullptr;
+        std::string const text{ arg };
+        auto const value = std::strtol(text.c_str(), &end, 10);
+        if (end == text.c_str() || *end != '\0' || value < 0)
+            return false;
+        out = static_cast<int>(value);
+        return true;
+    }
+
+    void usage(std::ostream& os) {
+        os << "Usage: sapc_bench [options]\n" <<
+            "Generates a synthetic corpus and times each stage of the compiler on it.\n" <<
+            "  --corpus <dir>        Directory for the generated corpus (default: " << (fs::temp_directory_path() / "sapc_bench").string() << ")\n" <<
+            "  --generate            Only write the corpus, without running benchmarks\n" <<
+            "  --filter <text>       Run only benchmarks whose name contains the text\n" <<
+            "  --iterations <n>      Iterations per benchmark (default: 10)\n" <<
+            "  --modules <n>         Modules beneath the root (default: 24)\n" <<
+            "  --depth <n>           Layers of imports (default: 4)\n" <<
+            "  --fan-out <n>         Imports per module (default: 3)\n" <<
+            "  --namespaces <n>      Namespaces per module (default: 2)\n" <<
+            "  --width <n>           Types per namespace (default: 64)\n" <<
+            "  --fields <n>          Fields per struct (default: 8)\n" <<
+            "  --generics <percent>  Generic structs and specialized fields (default: 10)\n" <<
+            "  --attributes <percent> Annotated types and fields (default: 25)\n" <<
+            "  --seed <n>            Seed for the generator (default: 1)\n";
+    }
+
+    bool parseArguments(int argc, char* argv[], Options& options) {
+        auto& corpus = options.corpus;
+        int seed = static_cast<int>(corpus.seed);
+
+        struct IntOption {
+            std::string_view name;
+            int* target;
+        };
+        IntOption const intOptions[] = {
+            { "--iterations", &options.iterations },
+            { "--modules", &corpus.modules },
+            { "--depth", &corpus.depth },
+            { "--fan-out", &corpus.fanOut },
+            { "--namespaces", &corpus.namespaces },
+            { "--width", &corpus.namespaceWidth },
+            { "--fields", &corpus.fields },
+            { "--generics", &corpus.generics },
+            { "--attributes", &corpus.attributes },
+            { "--seed", &seed },
+        };
+
+        for (int index = 1; index < argc; ++index) {
+            std::string_view const arg = argv[index];
+            bool const hasValue = index + 1 < argc;
+
+            if (arg == "--help" || arg == "-h") {
+                usage(std::cout);
+                std::exit(0);
+            }
+            else if (arg == "--generate")
+                options.generateOnly = true;
+            else if (arg == "--corpus" && hasValue)
+                options.directory = argv[++index];
+            else if (arg == "--filter" && hasValue)
+                options.filter = argv[++index];
+            else {
+                auto const it = std::find_if(std::begin(intOptions), std::end(intOptions), [arg](auto const& opt) { return opt.name == arg; });
+                if (it == std::end(intOptions) || !hasValue || !parseInt(argv[++index], *it->target)) {
+                    std::cerr << "sapc_bench: invalid argument '" << arg << "'\n";
+                    usage(std::cerr);
+                    return false;
+                }
+            }
+        }
+
+        corpus.seed = static_cast<unsigned>(seed);
+        options.iterations = std::max(options.iterations, 1);
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseArguments(argc, argv, options))
+        return 1;
+
+    auto const directory = fs::absolute(options.directory);
+    auto const corpus = sapc::bench::generateCorpus(directory, options.corpus);
+    if (!sapc::bench::writeCorpus(corpus)) {
+        std::cerr << "sapc_bench: failed to write corpus to " << directory.string() << '\n';
+        return 1;
+    }
+
+    std::cout << "corpus: " << corpus.modules.size() << " modules, " << corpus.bytes << " bytes in " << directory.string() << '\n';
+    if (options.generateOnly)
+        return 0;
+
+    std::cout << std::left << std::setw(20) << "benchmark" << std::right <<
+        std::setw(12) << "best ms" << std::setw(12) << "mean ms" << std::setw(12) << "MiB/s" << std::setw(12) << "iterations" << '\n';
+
+    for (auto const& bench : benchmarks(corpus)) {
+        if (bench.name.find(options.filter) == std::string::npos)
+            continue;
+
+        double best = 0;
+        double total = 0;
+        for (int iteration = 0; iteration != options.iterations; ++iteration) {
+            Timer timer;
+            if (!bench.run(timer)) {
+                std::cerr << "sapc_bench: " << bench.name << " failed\n";
+                return 1;
+            }
+            best = iteration == 0 ? timer.elapsed : std::min(best, timer.elapsed);
+            total += timer.elapsed;
+        }
+
+        auto const rate = best > 0 ? static_cast<double>(bench.bytes) / best / (1024.0 * 1024.0) : 0.0;
+        std::cout << std::left << std::setw(20) << bench.name << std::right << std::fixed << std::setprecision(3) <<
+            std::setw(12) << best * 1000.0 << std::setw(12) << total / options.iterations * 1000.0 <<
+            std::setprecision(1) << std::setw(12) << rate << std::setw(12) << options.iterations << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sapc {
+    namespace fuzz {
+        // larger inputs are skipped; a schema this size already nests and
+        // chains far past every limit, and bigger ones only slow each run
+        constexpr std::size_t maxInputSize = 64 * 1024;
+    }
+}
+
+// the libFuzzer entry point, defined by each target
+extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const* data, std::size_t size);
@@ -0,0 +1,57 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "fuzz.hh"
+
+#include <sapc/sapc.hh>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // modules after the first are imported as m1, m2, and so on
+    constexpr int maxModules = 4;
+}
+
+// The input holds up to four modules separated by NUL bytes; the first is
+// compiled, with specializations instantiated, and written as JSON
+extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const* data, std::size_t size) {
+    if (size > sapc::fuzz::maxInputSize)
+        return 0;
+
+    std::string_view input{ reinterpret_cast<char const*>(data), size };
+
+    sapc::Session session;
+    session.instantiate = true;
+
+    int modules = 0;
+    while (modules != maxModules) {
+        auto const end = modules + 1 != maxModules ? std::min(input.find('\0'), input.size()) : input.size();
+        session.setSource(fs::path{ "fuzz" } / ("m" + std::to_string(modules) + ".sap"), std::string{ input.substr(0, end) });
+        ++modules;
+
+        if (end == input.size())
+            break;
+        input.remove_prefix(end + 1);
+    }
+
+    // imports that aren't among the inputs are missing, rather than looked for on disk
+    session.resolver = [modules](std::string_view name, fs::path const&) {
+        for (int index = 1; index != modules; ++index)
+            if (name == "m" + std::to_string(index))
+                return fs::path{ "fuzz" } / (std::string{ name } + ".sap");
+        return fs::path{};
+    };
+
+    auto const result = session.compile(fs::path{ "fuzz" } / "m0.sap");
+    if (result) {
+        std::ostringstream json;
+        session.writeJson(json, *result.module);
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "ast.hh"
+#include "fuzz.hh"
+#include "grammar.hh"
+#include "log.hh"
+#include "symbol_pool.hh"
+
+#include <string_view>
+
+extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const* data, std::size_t size) {
+    if (size > sapc::fuzz::maxInputSize)
+        return 0;
+
+    sapc::FileTable files;
+    sapc::SymbolPool symbols;
+    sapc::Log log;
+    log.files = &files;
+
+    std::filesystem::path const filename = "fuzz.sap";
+    auto const file = files.intern(filename);
+    sapc::parse(filename, file, std::string_view{ reinterpret_cast<char const*>(data), size }, {}, symbols, log);
+    return 0;
+}
@@ -0,0 +1,24 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "fuzz.hh"
+#include "lexer.hh"
+#include "log.hh"
+
+#include <string_view>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const* data, std::size_t size) {
+    if (size > sapc::fuzz::maxInputSize)
+        return 0;
+
+    // kept between runs, as the compiler keeps one per file, so that runs
+    // measure the lexer rather than growing the vector
+    static std::vector<sapc::Token> tokens;
+    tokens.clear();
+
+    sapc::Log log;
+    sapc::tokenize(std::string_view{ reinterpret_cast<char const*>(data), size }, 0, tokens, log);
+    return 0;
+}
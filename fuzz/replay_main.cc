@@ -0,0 +1,137 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "fuzz.hh"
+#include "stats.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Ends the process once an input runs past the timeout, as libFuzzer
+    // does, since an input caught in a loop would never return to be timed
+    struct Watchdog {
+        explicit Watchdog(double timeout) : timeout(timeout) {
+            if (timeout > 0)
+                thread = std::thread([this] { watch(); });
+        }
+
+        ~Watchdog() {
+            if (!thread.joinable())
+                return;
+            {
+                std::lock_guard lock(mutex);
+                stopped = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+
+        Watchdog(Watchdog const&) = delete;
+        Watchdog& operator=(Watchdog const&) = delete;
+
+        void start(fs::path const& input) {
+            {
+                std::lock_guard lock(mutex);
+                current = &input;
+                deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout));
+            }
+            wake.notify_one();
+        }
+
+        void finish() {
+            std::lock_guard lock(mutex);
+            current = nullptr;
+        }
+
+        void watch() {
+            std::unique_lock lock(mutex);
+            while (!stopped) {
+                if (current == nullptr)
+                    wake.wait(lock);
+                else if (Clock::now() < deadline)
+                    wake.wait_until(lock, deadline);
+                else {
+                    std::cerr << "error: " << current->string() << " ran past the limit of " << timeout << "s\n";
+                    std::_Exit(1);
+                }
+            }
+        }
+
+        double timeout = 0;
+        std::mutex mutex;
+        std::condition_variable wake;
+        fs::path const* current = nullptr; // the input running, if any
+        Clock::time_point deadline;
+        bool stopped = false;
+        std::thread thread;
+    };
+}
+
+// Runs a fuzz target once over each file given, or each file under the
+// directories given, where libFuzzer isn't available. It takes the same
+// -timeout and -rss_limit_mb options as libFuzzer and ignores the others,
+// so the same command line replays a corpus either way.
+int main(int argc, char** argv) {
+    double timeout = 0; // seconds per input; 0 is no limit
+    std::uint64_t rssLimit = 0; // megabytes; 0 is no limit
+    std::vector<fs::path> inputs;
+
+    for (int arg = 1; arg != argc; ++arg) {
+        std::string_view const value = argv[arg];
+        if (value.substr(0, 9) == "-timeout=")
+            timeout = std::atof(argv[arg] + 9);
+        else if (value.substr(0, 14) == "-rss_limit_mb=")
+            rssLimit = std::strtoull(argv[arg] + 14, nullptr, 10);
+        else if (value.substr(0, 1) == "-")
+            continue;
+        else if (fs::is_directory(value)) {
+            for (auto const& entry : fs::recursive_directory_iterator(value))
+                if (entry.is_regular_file())
+                    inputs.push_back(entry.path());
+        }
+        else
+            inputs.emplace_back(value);
+    }
+
+    Watchdog watchdog(timeout);
+
+    int failures = 0;
+    for (auto const& input : inputs) {
+        std::ifstream file(input, std::ios::binary);
+        if (!file) {
+            std::cerr << "error: cannot read " << input.string() << '\n';
+            ++failures;
+            continue;
+        }
+        std::vector<char> const data{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+
+        watchdog.start(input);
+        LLVMFuzzerTestOneInput(reinterpret_cast<std::uint8_t const*>(data.data()), data.size());
+        watchdog.finish();
+
+        // the peak only grows, so it is reported for the first input to pass the limit
+        auto const peak = sapc::Stats::peakResidentBytes() / (1024 * 1024);
+        if (rssLimit != 0 && peak > rssLimit) {
+            std::cerr << "error: " << input.string() << " raised peak memory to " << peak << " MB, over the limit of " << rssLimit << " MB\n";
+            return 1;
+        }
+    }
+
+    std::cout << "replayed " << inputs.size() << " inputs\n";
+    return failures != 0 ? 1 : 0;
+}
@@ -0,0 +1,258 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+// Reader for the binary output of `sapc --format=binary`.
+//
+// The file is a flat, little-endian image that can be memory-mapped and
+// read in place. A Header at offset 0 locates a set of sections; each one
+// is a contiguous array of one of the fixed-size records below, and every
+// section starts on an 8-byte boundary. Records refer to one another by
+// index into the relevant section, never by pointer:
+//
+//  - strings are indices into the string table; each entry locates a byte
+//    range in the string data, which is always followed by a NUL byte.
+//    Names, qualified names and filenames are each stored once.
+//  - a Range is a run of `count` consecutive records starting at `first`.
+//  - `none` marks an absent optional string or record.
+//
+// Types refer to one another by qualified name, exactly as the JSON output
+// does, since a referenced type may be declared by an imported module.
+//
+// The layout mirrors sap-1.schema.json. A reader must reject a file whose
+// magic or version doesn't match; the version is bumped on any change to
+// the layout.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace sapc::binary {
+    inline constexpr char magic[4] = { 'S', 'A', 'P', 'B' };
+    inline constexpr std::uint32_t version = 1;
+    inline constexpr std::uint32_t none = 0xFFFFFFFFu;
+
+    struct Range {
+        std::uint32_t first = 0;
+        std::uint32_t count = 0;
+    };
+
+    struct Section {
+        std::uint32_t offset = 0; // from the start of the file
+        std::uint32_t count = 0; // number of records
+    };
+
+    struct StringEntry {
+        std::uint32_t offset = 0; // into the string data section
+        std::uint32_t length = 0; // in bytes, excluding the NUL terminator
+    };
+
+    // Positions are 1-based; zero means unknown
+    struct Location {
+        std::uint32_t filename = none;
+        std::uint32_t line = 0;
+        std::uint32_t column = 0;
+        std::uint32_t lineEnd = 0;
+        std::uint32_t columnEnd = 0;
+    };
+
+    enum class ValueKind : std::uint32_t {
+        Null,
+        Bool, // number is 0 or 1
+        Integer, // number
+        String, // first is the string
+        TypeName, // first is the qualified type name
+        Enum, // first is the enumeration name, second the item name, number its value
+        Array, // first and second are the Range of element values
+    };
+
+    struct Value {
+        ValueKind kind = ValueKind::Null;
+        std::uint32_t first = none;
+        std::uint32_t second = none;
+        std::uint32_t reserved = 0;
+        std::int64_t number = 0;
+    };
+
+    struct Annotation {
+        std::uint32_t type = none; // qualified name of the attribute
+        Range args; // values
+        Location location;
+    };
+
+    struct Import {
+        std::uint32_t name = none;
+        std::uint32_t filename = none;
+        Range annotations;
+        Location location;
+    };
+
+    enum class TypeKind : std::uint32_t {
+        Simple,
+        Struct,
+        TypeParam,
+        Specialized,
+        Union,
+        Attribute,
+        Array,
+        Pointer,
+        Enum,
+        Alias,
+        TypeName,
+    };
+
+    struct EnumItem {
+        std::uint32_t name = none;
+        std::uint32_t reserved = 0;
+        std::int64_t value = 0;
+    };
+
+    struct Field {
+        std::uint32_t name = none;
+        std::uint32_t type = none; // qualified name
+        std::uint32_t defaultValue = none; // value
+        Range annotations;
+        Location location;
+    };
+
+    struct Type {
+        std::uint32_t name = none;
+        std::uint32_t qualified = none;
+        std::uint32_t module = none;
+        std::uint32_t ns = none; // qualified name of the enclosing namespace, if any
+        TypeKind kind = TypeKind::Simple;
+        std::uint32_t refType = none; // the base type of aggregates and enums, or the referenced type of indirect types
+        std::int64_t length = 0; // fixed length of arrays, if hasLength is set
+        Range annotations;
+        Range items; // enums
+        Range fields; // structs, unions, attributes, and instantiated specialized types
+        Range typeParams; // string lists, holding names
+        Range typeArgs; // string lists, holding qualified names; specialized types
+        Location location;
+        std::uint32_t hasLength = 0;
+    };
+
+    struct Constant {
+        std::uint32_t name = none;
+        std::uint32_t qualified = none;
+        std::uint32_t module = none;
+        std::uint32_t ns = none;
+        std::uint32_t type = none; // name of the constant's type
+        std::uint32_t value = none;
+        Range annotations;
+        Location location;
+    };
+
+    struct Namespace {
+        std::uint32_t name = none;
+        std::uint32_t qualified = none;
+        std::uint32_t module = none;
+        std::uint32_t ns = none;
+        Range types; // string lists, holding qualified names
+        Range constants;
+        Range namespaces;
+    };
+
+    struct Header {
+        char magic[4] = {};
+        std::uint32_t version = 0;
+        std::uint32_t size = 0; // of the whole file
+        std::uint32_t moduleName = none;
+        Range moduleAnnotations;
+        Section strings; // StringEntry
+        Section stringData; // bytes
+        Section stringLists; // std::uint32_t string indices
+        Section imports;
+        Section types;
+        Section fields;
+        Section enumItems;
+        Section constants;
+        Section namespaces;
+        Section annotations;
+        Section values;
+    };
+
+    template <typename T>
+    struct Array {
+        T const* data = nullptr;
+        std::uint32_t count = 0;
+
+        T const* begin() const noexcept { return data; }
+        T const* end() const noexcept { return data + count; }
+        std::uint32_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+        T const& operator[](std::uint32_t index) const noexcept { return data[index]; }
+    };
+
+    // Read-only view of a binary schema held in memory; the buffer must
+    // outlive the view and be at least 8-byte aligned
+    struct View {
+        View() = default;
+        View(void const* data, std::size_t size) : bytes(static_cast<unsigned char const*>(data)), length(size) {}
+
+        // checks the header and that every section lies within the buffer
+        bool valid() const noexcept {
+            if (bytes == nullptr || length < sizeof(Header))
+                return false;
+
+            auto const& head = header();
+            if (std::memcmp(head.magic, magic, sizeof(magic)) != 0 || head.version != version || head.size > length)
+                return false;
+
+            return fits(head.strings, sizeof(StringEntry)) && fits(head.stringData, 1) && fits(head.stringLists, sizeof(std::uint32_t)) &&
+                fits(head.imports, sizeof(Import)) && fits(head.types, sizeof(Type)) && fits(head.fields, sizeof(Field)) &&
+                fits(head.enumItems, sizeof(EnumItem)) && fits(head.constants, sizeof(Constant)) && fits(head.namespaces, sizeof(Namespace)) &&
+                fits(head.annotations, sizeof(Annotation)) && fits(head.values, sizeof(Value));
+        }
+
+        Header const& header() const noexcept { return *reinterpret_cast<Header const*>(bytes); }
+
+        std::string_view string(std::uint32_t index) const noexcept {
+            if (index == none || index >= header().strings.count)
+                return {};
+            auto const& entry = section<StringEntry>(header().strings)[index];
+            return { reinterpret_cast<char const*>(bytes + header().stringData.offset + entry.offset), entry.length };
+        }
+
+        std::string_view moduleName() const noexcept { return string(header().moduleName); }
+
+        Array<Import> imports() const noexcept { return section<Import>(header().imports); }
+        Array<Type> types() const noexcept { return section<Type>(header().types); }
+        Array<Constant> constants() const noexcept { return section<Constant>(header().constants); }
+        Array<Namespace> namespaces() const noexcept { return section<Namespace>(header().namespaces); }
+
+        Array<Annotation> annotations(Range range) const noexcept { return slice<Annotation>(header().annotations, range); }
+        Array<Field> fields(Range range) const noexcept { return slice<Field>(header().fields, range); }
+        Array<EnumItem> items(Range range) const noexcept { return slice<EnumItem>(header().enumItems, range); }
+        Array<Value> values(Range range) const noexcept { return slice<Value>(header().values, range); }
+        Array<std::uint32_t> strings(Range range) const noexcept { return slice<std::uint32_t>(header().stringLists, range); }
+
+        Value const* value(std::uint32_t index) const noexcept {
+            return index < header().values.count ? &section<Value>(header().values)[index] : nullptr;
+        }
+
+        Array<Value> elements(Value const& array) const noexcept { return values(Range{ array.first, array.second }); }
+
+        template <typename T>
+        Array<T> section(Section const& sect) const noexcept {
+            return { reinterpret_cast<T const*>(bytes + sect.offset), sect.count };
+        }
+
+        template <typename T>
+        Array<T> slice(Section const& sect, Range range) const noexcept {
+            if (range.count == 0 || range.first > sect.count || range.count > sect.count - range.first)
+                return {};
+            return { reinterpret_cast<T const*>(bytes + sect.offset) + range.first, range.count };
+        }
+
+        bool fits(Section const& sect, std::size_t recordSize) const noexcept {
+            return sect.offset <= length && sect.count <= (length - sect.offset) / recordSize;
+        }
+
+        unsigned char const* bytes = nullptr;
+        std::size_t length = 0;
+    };
+}
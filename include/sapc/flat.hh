@@ -0,0 +1,185 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+// Flattened form of a compiled module, built once compilation is done for
+// the passes that walk the whole schema.
+//
+// Every record lives in one of the contiguous arrays of a flat::Module and
+// refers to other records by 32-bit index into the relevant array, never by
+// pointer. A Range is a run of `count` consecutive records starting at
+// `first`; lists of references, such as type arguments or the members of a
+// namespace, are a Range of indices held in `refs`.
+//
+// The types, constants and namespaces listed by the schema module come
+// first in their arrays, in the same order. Records past those are only
+// referenced, such as the types of imported modules that the module itself
+// doesn't list; only their names, kind and scope are filled in. When the
+// listing is narrowed with FlattenOptions::only, the records listed are the
+// selected subset, still in schema order, and namespaces only hold the
+// selected members.
+
+#pragma once
+
+#include "location.hh"
+#include "schema.hh"
+#include "symbol.hh"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sapc::flat {
+    using Index = std::uint32_t;
+    inline constexpr Index none = ~Index{ 0 };
+
+    struct Range {
+        Index first = 0;
+        Index count = 0;
+    };
+
+    // A view of the records of a Range
+    template <typename T>
+    struct Slice {
+        T const* first = nullptr;
+        T const* last = nullptr;
+
+        T const* begin() const noexcept { return first; }
+        T const* end() const noexcept { return last; }
+        size_t size() const noexcept { return static_cast<size_t>(last - first); }
+        bool empty() const noexcept { return first == last; }
+        T const& operator[](size_t index) const noexcept { return first[index]; }
+    };
+
+    enum class ValueKind : std::uint8_t {
+        Null,
+        Bool, // number is 0 or 1
+        Integer, // number
+        String, // index is the string
+        TypeName, // index is the type
+        Enum, // index is the enum item
+        Array, // elements are values
+    };
+
+    struct Value {
+        ValueKind kind = ValueKind::Null;
+        Index index = none;
+        Range elements;
+        long long number = 0;
+    };
+
+    struct Annotation {
+        Index type = none;
+        Location location;
+        Range args; // values
+    };
+
+    struct Field {
+        Symbol name;
+        Location location;
+        Index type = none;
+        Index defaultValue = none; // value
+        Range annotations;
+    };
+
+    struct EnumItem {
+        Symbol name;
+        Location location;
+        long long value = 0;
+        Index parent = none; // type
+        Range annotations;
+    };
+
+    struct Type {
+        schema::Type::Kind kind = schema::Type::Kind::Simple;
+        Symbol name;
+        Symbol qualifiedName;
+        Location location;
+        Index scope = none; // namespace
+        Index refType = none; // the base type of aggregates and enums, or the referenced type of indirect types
+        std::optional<long long> arraySize;
+        Range annotations;
+        Range fields; // structs, unions, attributes, and instantiated specialized types
+        Range items; // enums
+        Range typeParams; // refs to types
+        Range typeArgs; // refs to types; specialized types
+    };
+
+    struct Constant {
+        Symbol name;
+        Symbol qualifiedName;
+        Location location;
+        Index scope = none; // namespace
+        Index type = none;
+        Index value = none;
+        Range annotations;
+    };
+
+    struct Namespace {
+        Symbol name; // empty for the root namespace of a module
+        Symbol qualifiedName;
+        Location location;
+        Symbol module; // name of the owning module
+        Index parent = none; // namespace
+        Range types; // refs to types
+        Range constants; // refs to constants
+        Range namespaces; // refs to namespaces
+    };
+
+    struct Import {
+        Symbol name;
+        Index filename = none; // string
+        Location location;
+        Range annotations; // of the imported module
+    };
+
+    struct Module {
+        Symbol name;
+        Location location;
+        Index filename = none; // string
+        Range moduleAnnotations;
+        Index root = none; // namespace, with its members filled in
+
+        Range listedTypes;
+        Range listedConstants;
+        Range listedNamespaces;
+
+        std::vector<Import> imports;
+        std::vector<Type> types;
+        std::vector<Field> fields;
+        std::vector<EnumItem> enumItems;
+        std::vector<Constant> constants;
+        std::vector<Namespace> namespaces;
+        std::vector<Annotation> annotations;
+        std::vector<Value> values;
+        std::vector<Index> refs;
+        std::vector<std::string> strings;
+
+        template <typename T>
+        static Slice<T> slice(std::vector<T> const& records, Range range) noexcept {
+            return { records.data() + range.first, records.data() + range.first + range.count };
+        }
+
+        Slice<Index> refsOf(Range range) const noexcept { return slice(refs, range); }
+    };
+}
+
+namespace sapc {
+    struct FlattenOptions {
+        bool instantiated = false; // specialized types also list their instantiated fields
+        // if any, only the types and constants whose qualified names match one
+        // of these patterns are listed, together with every type they reach
+        // through fields, bases, type arguments and parameters, and annotations
+        std::vector<std::string> only;
+    };
+
+    // builds the flat form of a compiled module; the result holds no
+    // pointers into the schema and doesn't need it to stay alive
+    flat::Module flatten(schema::Module const& mod, FlattenOptions const& options = {});
+
+    // `*` matches any run of characters, including none; other characters
+    // match themselves
+    bool matchesPattern(std::string_view pattern, std::string_view name) noexcept;
+}
@@ -0,0 +1,82 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <iosfwd>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sapc {
+    struct Position {
+        int line = 0;
+        int column = 0;
+
+        bool operator==(Position const& rhs) const { return line == rhs.line && column == rhs.column; }
+        bool operator!=(Position const& rhs) const { return line != rhs.line || column != rhs.column; }
+    };
+
+    // Byte range within a file of a FileTable; line and column are only
+    // computed when a location is reported
+    struct Location {
+        static constexpr std::uint32_t npos = ~std::uint32_t{ 0 };
+
+        std::uint32_t file = 0; // 0 is no file
+        std::uint32_t start = npos; // npos refers to the file as a whole
+        std::uint32_t end = npos;
+
+        bool operator==(Location const& rhs) const { return file == rhs.file && start == rhs.start && end == rhs.end; }
+
+        Location& merge(Location const& rhs);
+    };
+
+    // Maps byte offsets in a source text to line and column positions
+    struct LineIndex {
+        LineIndex() = default;
+        explicit LineIndex(std::string_view text);
+
+        Position position(size_t offset) const noexcept;
+
+        std::vector<std::uint32_t> lineStarts;
+    };
+
+    // `path(line,col,endLine,endCol)`, leaving out the positions that are unknown
+    void printLocation(std::ostream& os, std::string_view path, Position start, Position end);
+
+    struct SourceFile {
+        std::filesystem::path path;
+        std::string text; // viewed by tokens
+        std::optional<LineIndex> lines; // built on first use
+        bool lineOffsets = false; // offsets are line numbers, for declarations without source text
+    };
+
+    // Every file seen by a Context; ids are stable and reused when a file is reloaded
+    struct FileTable {
+        FileTable() : files(1) {}
+
+        FileTable(FileTable const&) = delete;
+        FileTable& operator=(FileTable const&) = delete;
+
+        std::uint32_t intern(std::filesystem::path const& path);
+
+        // entries are never moved, so the reference stays valid as files are added
+        SourceFile& file(std::uint32_t id);
+
+        std::filesystem::path path(std::uint32_t id) const;
+        Position position(std::uint32_t id, std::uint32_t offset) const;
+
+        void print(std::ostream& os, Location const& loc) const;
+
+        mutable std::mutex mutex;
+        mutable std::deque<SourceFile> files;
+        std::unordered_map<std::string, std::uint32_t> ids;
+    };
+}
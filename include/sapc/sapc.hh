@@ -0,0 +1,75 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "location.hh"
+#include "schema.hh"
+
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sapc {
+    struct Context;
+
+    // In-process compiler for embedding sapc in other tools. A session keeps
+    // every module it compiles and reuses them in later compiles until their
+    // sources change, so repeated compiles only redo the modules that changed.
+    struct Session {
+        // Locates the file of an imported module, returning an empty path if
+        // there is none; when not set, the importer's directory and then the
+        // search paths are probed on disk.
+        using Resolver = std::function<std::filesystem::path(std::string_view moduleName, std::filesystem::path const& importer)>;
+
+        struct Result {
+            schema::Module const* module = nullptr; // owned by the session until it or an import is recompiled; null if the target failed to parse
+            std::vector<std::filesystem::path> dependencies; // the target and everything it imports
+            std::vector<std::string> diagnostics; // formatted as sapc prints them
+            int errors = 0;
+
+            explicit operator bool() const noexcept { return module != nullptr && errors == 0; }
+        };
+
+        Session();
+        ~Session();
+
+        Session(Session const&) = delete;
+        Session& operator=(Session const&) = delete;
+
+        // Settings apply to the next compile, but modules already compiled are
+        // only rebuilt when their sources change
+        std::vector<std::filesystem::path> searchPaths;
+        Resolver resolver;
+        unsigned jobs = 1; // threads used to load imports and validate; 0 uses every core, and the resolver must then be thread-safe
+        int maxErrors = 0; // compiling stops once this many errors are reported; 0 is no limit
+        bool instantiate = false; // specialized types get the generic's fields, with the type arguments substituted
+        std::vector<std::string> only; // if any, writeJson writes only the matching types and constants, and the types they use
+
+        // Supplies or replaces the contents of a file from memory; such files
+        // are never read from disk. Modules that depend on it are recompiled.
+        void setSource(std::filesystem::path const& filename, std::string text);
+        void removeSource(std::filesystem::path const& filename);
+
+        // Compiles and validates a target; files on disk that have changed
+        // since they were loaded are reloaded first
+        Result compile(std::filesystem::path const& target);
+
+        // Writes a module in the same JSON format as sapc, narrowed by only
+        void writeJson(std::ostream& os, schema::Module const& mod, bool compact = false) const;
+
+        // resolves the locations found in schema nodes
+        FileTable const& files() const noexcept;
+
+        // Discards every module, source, and file, releasing their memory;
+        // any schema nodes returned earlier are invalidated
+        void reset();
+
+        std::unique_ptr<Context> context;
+    };
+}
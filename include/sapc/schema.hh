@@ -5,10 +5,12 @@
 #pragma once
 
 #include "location.hh"
+#include "symbol.hh"
 
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <variant>
 
@@ -24,7 +26,7 @@ namespace sapc::schema {
     struct Namespace;
 
     struct Annotated {
-        std::vector<std::unique_ptr<Annotation>> annotations;
+        std::vector<Annotation*> annotations;
     };
 
     struct Value {
@@ -46,19 +48,49 @@ namespace sapc::schema {
     };
 
     struct Field : Annotated {
-        std::string name;
+        Symbol name;
         Location location;
         Type const* type = nullptr;
         std::optional<Value> defaultValue;
     };
 
     struct EnumItem : Annotated {
-        std::string name;
+        Symbol name;
         Location location;
         long long value = 0;
         TypeEnum const* parent = nullptr;
     };
 
+    // Names declared directly within a scope, filled as declarations are
+    // added; each kind keeps the first declaration of a name
+    struct SymbolTable {
+        struct Entry {
+            std::vector<Namespace const*> namespaces; // namespaces may be reopened
+            Type const* type = nullptr;
+            Constant const* constant = nullptr;
+            EnumItem const* enumItem = nullptr;
+        };
+
+        Entry const* find(Symbol name) const noexcept {
+            auto const it = entries.find(name);
+            return it != entries.end() ? &it->second : nullptr;
+        }
+
+        void add(Symbol name, Namespace const* ns) { entries[name].namespaces.push_back(ns); }
+        void add(Symbol name, Type const* type) { add(entries[name].type, type); }
+        void add(Symbol name, Constant const* constant) { add(entries[name].constant, constant); }
+        void add(Symbol name, EnumItem const* enumItem) { add(entries[name].enumItem, enumItem); }
+
+        template <typename T>
+        static void add(T const*& slot, T const* value) noexcept {
+            if (slot == nullptr)
+                slot = value;
+        }
+
+        std::unordered_map<Symbol, Entry> entries;
+        SymbolTable const* inherited = nullptr; // the nearest base type's symbols, if any have symbols
+    };
+
     struct Type : Annotated {
         enum class Kind {
             Simple,
@@ -75,31 +107,35 @@ namespace sapc::schema {
         };
 
         Kind kind = Kind::Simple;
-        std::string name;
-        std::string qualifiedName;
+        Symbol name;
+        Symbol qualifiedName;
         Location location;
         Namespace const* scope = nullptr;
     };
 
     struct TypeAggregate : Type {
         Type const* baseType = nullptr;
-        std::vector<std::unique_ptr<Field>> fields;
+        std::vector<Field*> fields;
         std::vector<Type const*> typeParams;
+        SymbolTable symbols; // type parameters; those of the base types are inherited
     };
 
     struct TypeEnum : Type {
-        std::vector<std::unique_ptr<EnumItem>> items;
+        Type const* baseType = nullptr; // the declared underlying type, if any
+        std::vector<EnumItem*> items;
+        SymbolTable symbols;
     };
 
     struct TypeIndirect : Type {
         Type const* refType = nullptr; // arrays, pointers, aliases, specialized
         std::vector<Type const*> typeArgs; // types arguments for specialized types (generics)
         std::optional<long long> arraySize; // static array size
+        std::vector<Field*> fields; // specialized types, once instantiated: the generic's fields with the type arguments substituted
     };
 
     struct Constant : Annotated {
-        std::string name;
-        std::string qualifiedName;
+        Symbol name;
+        Symbol qualifiedName;
         Location location;
         Namespace const* scope = nullptr;
         Type const* type = nullptr;
@@ -107,14 +143,15 @@ namespace sapc::schema {
     };
 
     struct Namespace {
-        std::string name;
-        std::string qualifiedName;
+        Symbol name;
+        Symbol qualifiedName;
         Location location;
         Module const* owner = nullptr;
         Namespace const* parent = nullptr;
         std::vector<Type const*> types;
         std::vector<Constant const*> constants;
         std::vector<Namespace const*> namespaces;
+        SymbolTable symbols;
     };
 
     struct Import {
@@ -123,8 +160,9 @@ namespace sapc::schema {
     };
 
     struct Module : Annotated {
-        std::string name;
+        Symbol name;
         Location location;
+        std::filesystem::path filename;
         Namespace const* root = nullptr;
         std::vector<Import> imports;
         std::vector<Type const*> types;
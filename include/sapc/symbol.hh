@@ -0,0 +1,42 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace sapc {
+    // Interned string; every distinct spelling is stored once by the pool of
+    // the context that compiled it, so symbols compare and hash by address
+    struct Symbol {
+        static constexpr std::string_view emptyText{};
+
+        Symbol() = default;
+        explicit Symbol(std::string_view const* entry) noexcept : entry(entry) {} // an entry of a SymbolPool
+
+        std::string_view str() const noexcept { return *entry; }
+        char const* data() const noexcept { return entry->data(); }
+        size_t size() const noexcept { return entry->size(); }
+        bool empty() const noexcept { return entry->empty(); }
+
+        friend bool operator==(Symbol lhs, Symbol rhs) noexcept { return lhs.entry == rhs.entry; }
+        friend bool operator!=(Symbol lhs, Symbol rhs) noexcept { return lhs.entry != rhs.entry; }
+        friend bool operator==(Symbol lhs, std::string_view rhs) noexcept { return *lhs.entry == rhs; }
+        friend bool operator!=(Symbol lhs, std::string_view rhs) noexcept { return *lhs.entry != rhs; }
+
+        friend std::ostream& operator<<(std::ostream& os, Symbol sym);
+
+        std::string_view const* entry = &emptyText;
+    };
+}
+
+template <>
+struct std::hash<sapc::Symbol> {
+    using result_type = size_t;
+    size_t operator()(sapc::Symbol sym) const noexcept { return std::hash<void const*>{}(sym.entry); }
+};
@@ -0,0 +1,95 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sapc {
+    // Bump allocator for nodes that all share the lifetime of their owner.
+    // Objects are never freed individually; destructors of non-trivial
+    // objects are run in reverse order of creation when the arena dies.
+    struct Arena {
+        static constexpr size_t blockSize = 64 * 1024;
+
+        Arena() = default;
+        ~Arena() { reset(); }
+
+        Arena(Arena const&) = delete;
+        Arena& operator=(Arena const&) = delete;
+
+        template <typename T, typename... Args>
+        T* create(Args&&... args) {
+            if constexpr (std::is_trivially_destructible_v<T>) {
+                return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            }
+            else {
+                // the record is allocated first so that a throwing constructor can't leave it dangling
+                auto* const record = static_cast<Destructor*>(allocate(sizeof(Destructor), alignof(Destructor)));
+                T* const object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+                record->object = object;
+                record->destroy = [](void* ptr) noexcept { static_cast<T*>(ptr)->~T(); };
+                record->next = destructors;
+                destructors = record;
+
+                return object;
+            }
+        }
+
+        void* allocate(size_t size, size_t align) {
+            auto space = static_cast<size_t>(end - cursor);
+            void* ptr = cursor;
+            if (cursor == nullptr || std::align(align, size, ptr, space) == nullptr) {
+                grow(size + align);
+                space = static_cast<size_t>(end - cursor);
+                ptr = cursor;
+                std::align(align, size, ptr, space);
+            }
+
+            cursor = static_cast<char*>(ptr) + size;
+            return ptr;
+        }
+
+        void reset() noexcept {
+            for (auto* record = destructors; record != nullptr; record = record->next)
+                record->destroy(record->object);
+            destructors = nullptr;
+
+            while (blocks != nullptr) {
+                auto* const next = blocks->next;
+                ::operator delete(blocks);
+                blocks = next;
+            }
+            cursor = end = nullptr;
+        }
+
+        struct Block {
+            Block* next = nullptr;
+        };
+
+        struct Destructor {
+            void* object = nullptr;
+            void (*destroy)(void*) noexcept = nullptr;
+            Destructor* next = nullptr;
+        };
+
+        void grow(size_t minimum) {
+            auto const size = sizeof(Block) + (minimum > blockSize ? minimum : blockSize);
+            auto* const block = new (::operator new(size)) Block{ blocks };
+            blocks = block;
+            cursor = reinterpret_cast<char*>(block + 1);
+            end = reinterpret_cast<char*>(block) + size;
+        }
+
+        Block* blocks = nullptr;
+        Destructor* destructors = nullptr;
+        char* cursor = nullptr;
+        char* end = nullptr;
+    };
+}
@@ -4,7 +4,9 @@
 
 #pragma once
 
-#include "location.hh"
+#include "arena.hh"
+#include "sapc/location.hh"
+#include "sapc/symbol.hh"
 
 #include <filesystem>
 #include <iosfwd>
@@ -16,7 +18,7 @@
 
 namespace sapc::ast {
     struct Identifier {
-        std::string id;
+        Symbol id;
         Location loc;
 
         bool empty() const noexcept { return id.empty(); }
@@ -79,8 +81,8 @@ namespace sapc::ast {
         Kind kind = Kind::Name;
         Location loc;
         QualifiedId name;
-        std::unique_ptr<TypeRef> ref;
-        std::vector<std::unique_ptr<TypeRef>> typeArgs;
+        TypeRef* ref = nullptr;
+        std::vector<TypeRef*> typeArgs;
         std::optional<long long> arraySize; // static array size
 
         friend std::ostream& operator<<(std::ostream& os, TypeRef const& ref);
@@ -88,7 +90,7 @@ namespace sapc::ast {
 
     struct Field {
         Identifier name;
-        std::unique_ptr<TypeRef> type;
+        TypeRef* type = nullptr;
         std::vector<Annotation> annotations;
         std::optional<Literal> init;
     };
@@ -105,7 +107,7 @@ namespace sapc::ast {
         NamespaceDecl() { kind = Kind::Namespace; }
 
         Identifier name;
-        std::vector<std::unique_ptr<Declaration>> decls;
+        std::vector<Declaration*> decls;
     };
 
     struct AliasDecl : Declaration {
@@ -113,7 +115,7 @@ namespace sapc::ast {
 
         Identifier name;
         std::string customTag;
-        std::unique_ptr<TypeRef> targetType; // optional
+        TypeRef* targetType = nullptr; // optional
         std::vector<Annotation> annotations;
     };
 
@@ -122,7 +124,7 @@ namespace sapc::ast {
 
         Identifier name;
         std::string customTag;
-        std::unique_ptr<TypeRef> baseType;
+        TypeRef* baseType = nullptr;
         std::vector<Field> fields;
         std::vector<Identifier> typeParams;
         std::vector<Annotation> annotations;
@@ -157,7 +159,7 @@ namespace sapc::ast {
 
         Identifier name;
         std::string customTag;
-        std::unique_ptr<TypeRef> baseType;
+        TypeRef* baseType = nullptr;
         std::vector<EnumItem> items;
         std::vector<Annotation> annotations;
     };
@@ -167,7 +169,7 @@ namespace sapc::ast {
 
         Identifier name;
         std::string customTag;
-        std::unique_ptr<TypeRef> type;
+        TypeRef* type = nullptr;
         std::vector<Annotation> annotations;
         Literal value;
     };
@@ -185,9 +187,12 @@ namespace sapc::ast {
         std::vector<Annotation> annotations;
     };
 
+    // every node of a unit is allocated from its arena, which must outlive the pointers
     struct ModuleUnit {
+        Arena arena;
         Identifier name;
         std::filesystem::path filename;
-        std::vector<std::unique_ptr<Declaration>> decls;
+        std::vector<Declaration*> decls;
+        bool lowered = false; // compiled, keeping only the imports and custom tags
     };
 }
@@ -0,0 +1,360 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "binary.hh"
+#include "sapc/flat.hh"
+
+#include <sapc/binary.hh>
+
+#include <cassert>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace sapc {
+    namespace {
+        using namespace binary;
+
+        // Records are copied byte-for-byte into the file, so the stored layout
+        // is that of the host; only little-endian hosts are supported. Records
+        // must not contain padding, so that the output is deterministic.
+        template <typename... Records>
+        constexpr bool packed = (std::has_unique_object_representations_v<Records> && ...);
+        static_assert(packed<Header, StringEntry, Import, Type, Field, EnumItem, Constant, Namespace, Annotation, Value>, "binary records must not contain padding");
+
+        struct Builder {
+            flat::Module const& mod;
+            FileTable const& files;
+
+            std::vector<StringEntry> strings;
+            std::string stringData;
+            std::unordered_map<std::string, std::uint32_t> stringIds;
+            std::vector<std::uint32_t> stringLists;
+            std::vector<Import> imports;
+            std::vector<Type> types;
+            std::vector<Field> fields;
+            std::vector<EnumItem> enumItems;
+            std::vector<Constant> constants;
+            std::vector<Namespace> namespaces;
+            std::vector<Annotation> annotations;
+            std::vector<Value> values;
+
+            std::uint32_t string(std::string_view text);
+            std::uint32_t string(Symbol sym) { return string(sym.str()); }
+
+            template <typename Func>
+            Range list(flat::Range refs, Func&& func);
+
+            binary::Location location(sapc::Location const& loc);
+            Range annotate(flat::Range source);
+            Range addFields(flat::Range source);
+            std::uint32_t value(flat::Value const& source);
+            void fill(std::uint32_t slot, flat::Value const& source);
+            void scope(flat::Index scope, std::uint32_t& module, std::uint32_t& ns);
+
+            void add(flat::Type const& type);
+            void add(flat::Constant const& constant);
+            void add(flat::Namespace const& ns);
+
+            void write(std::ostream& os);
+        };
+
+        std::uint32_t count(size_t size) { return static_cast<std::uint32_t>(size); }
+
+        std::uint32_t align(size_t offset) { return count((offset + 7) & ~size_t{ 7 }); }
+
+        TypeKind kindOf(schema::Type::Kind kind) {
+            using Kind = schema::Type::Kind;
+            switch (kind) {
+            case Kind::Simple: return TypeKind::Simple;
+            case Kind::Struct: return TypeKind::Struct;
+            case Kind::TypeParam: return TypeKind::TypeParam;
+            case Kind::Specialized: return TypeKind::Specialized;
+            case Kind::Union: return TypeKind::Union;
+            case Kind::Attribute: return TypeKind::Attribute;
+            case Kind::Array: return TypeKind::Array;
+            case Kind::Pointer: return TypeKind::Pointer;
+            case Kind::Enum: return TypeKind::Enum;
+            case Kind::Alias: return TypeKind::Alias;
+            case Kind::TypeId: return TypeKind::TypeName;
+            default: assert(false && "unknown type kind"); return TypeKind::Simple;
+            }
+        }
+    }
+
+    void serializeToBinary(std::ostream& os, flat::Module const& mod, FileTable const& files) {
+        Builder{ mod, files }.write(os);
+    }
+
+    std::uint32_t Builder::string(std::string_view text) {
+        auto const [it, inserted] = stringIds.emplace(text, count(strings.size()));
+        if (inserted) {
+            strings.push_back({ count(stringData.size()), count(text.size()) });
+            stringData.append(text);
+            stringData.push_back('\0');
+        }
+        return it->second;
+    }
+
+    template <typename Func>
+    Range Builder::list(flat::Range refs, Func&& func) {
+        Range range{ count(stringLists.size()), refs.count };
+        for (auto const index : mod.refsOf(refs))
+            stringLists.push_back(string(func(index)));
+        return range;
+    }
+
+    binary::Location Builder::location(sapc::Location const& loc) {
+        auto const start = files.position(loc.file, loc.start);
+        auto const end = files.position(loc.file, loc.end);
+
+        binary::Location out;
+        out.filename = string(files.path(loc.file).string());
+        out.line = static_cast<std::uint32_t>(start.line);
+        out.column = static_cast<std::uint32_t>(start.column);
+        out.lineEnd = static_cast<std::uint32_t>(end.line);
+        out.columnEnd = static_cast<std::uint32_t>(end.column);
+        return out;
+    }
+
+    // nested values may append further annotations, so the run is reserved first
+    Range Builder::annotate(flat::Range source) {
+        Range range{ count(annotations.size()), source.count };
+        annotations.resize(annotations.size() + source.count);
+
+        for (std::uint32_t index = 0; index != range.count; ++index) {
+            auto const& annotation = mod.annotations[source.first + index];
+            auto const& type = mod.types[annotation.type];
+            assert(type.kind == schema::Type::Kind::Attribute);
+
+            Annotation out;
+            out.type = string(type.qualifiedName);
+            out.location = location(annotation.location);
+
+            out.args = { count(values.size()), annotation.args.count };
+            values.resize(values.size() + annotation.args.count);
+            for (std::uint32_t arg = 0; arg != out.args.count; ++arg)
+                fill(out.args.first + arg, mod.values[annotation.args.first + arg]);
+
+            annotations[range.first + index] = out;
+        }
+        return range;
+    }
+
+    std::uint32_t Builder::value(flat::Value const& source) {
+        auto const slot = count(values.size());
+        values.emplace_back();
+        fill(slot, source);
+        return slot;
+    }
+
+    // array elements are stored contiguously, so their slots are reserved
+    // before any element (which may itself be an array) is filled in
+    void Builder::fill(std::uint32_t slot, flat::Value const& source) {
+        Value out;
+        switch (source.kind) {
+        case flat::ValueKind::Null:
+            out.kind = ValueKind::Null;
+            break;
+        case flat::ValueKind::Bool:
+            out.kind = ValueKind::Bool;
+            out.number = source.number;
+            break;
+        case flat::ValueKind::Integer:
+            out.kind = ValueKind::Integer;
+            out.number = source.number;
+            break;
+        case flat::ValueKind::String:
+            out.kind = ValueKind::String;
+            out.first = string(mod.strings[source.index]);
+            break;
+        case flat::ValueKind::TypeName:
+            out.kind = ValueKind::TypeName;
+            out.first = string(mod.types[source.index].qualifiedName);
+            break;
+        case flat::ValueKind::Enum: {
+            auto const& item = mod.enumItems[source.index];
+            out.kind = ValueKind::Enum;
+            out.first = string(mod.types[item.parent].name);
+            out.second = string(item.name);
+            out.number = item.value;
+            break;
+        }
+        case flat::ValueKind::Array:
+            out.kind = ValueKind::Array;
+            out.first = count(values.size());
+            out.second = source.elements.count;
+            values.resize(values.size() + source.elements.count);
+            for (std::uint32_t index = 0; index != out.second; ++index)
+                fill(out.first + index, mod.values[source.elements.first + index]);
+            break;
+        }
+        values[slot] = out;
+    }
+
+    // the owning module, and the enclosing namespace unless it is the root
+    void Builder::scope(flat::Index scope, std::uint32_t& module, std::uint32_t& ns) {
+        assert(scope != flat::none);
+        auto const& record = mod.namespaces[scope];
+        module = string(record.module);
+        if (!record.name.empty())
+            ns = string(record.qualifiedName);
+    }
+
+    Range Builder::addFields(flat::Range source) {
+        Range const range{ count(fields.size()), source.count };
+        fields.resize(fields.size() + source.count);
+        for (std::uint32_t index = 0; index != range.count; ++index) {
+            auto const& field = mod.fields[source.first + index];
+
+            Field record;
+            record.name = string(field.name);
+            record.type = string(mod.types[field.type].qualifiedName);
+            if (field.defaultValue != flat::none)
+                record.defaultValue = value(mod.values[field.defaultValue]);
+            record.annotations = annotate(field.annotations);
+            record.location = location(field.location);
+            fields[range.first + index] = record;
+        }
+        return range;
+    }
+
+    void Builder::add(flat::Type const& type) {
+        using Kind = schema::Type::Kind;
+
+        Type out;
+        out.name = string(type.name);
+        out.qualified = string(type.qualifiedName);
+        scope(type.scope, out.module, out.ns);
+        out.kind = kindOf(type.kind);
+        out.annotations = annotate(type.annotations);
+
+        if (type.kind == Kind::Enum) {
+            if (type.refType != flat::none)
+                out.refType = string(mod.types[type.refType].qualifiedName);
+
+            out.items = { count(enumItems.size()), type.items.count };
+            for (auto const& item : mod.slice(mod.enumItems, type.items))
+                enumItems.push_back({ string(item.name), 0, item.value });
+        }
+        else if (type.kind == Kind::Struct || type.kind == Kind::Union || type.kind == Kind::Attribute) {
+            if (type.refType != flat::none)
+                out.refType = string(mod.types[type.refType].qualifiedName);
+
+            out.typeParams = list(type.typeParams, [this](flat::Index param) { return mod.types[param].name; });
+            out.fields = addFields(type.fields);
+        }
+        else if (type.kind == Kind::Array || type.kind == Kind::Pointer || type.kind == Kind::Alias || type.kind == Kind::Specialized) {
+            if (type.refType != flat::none)
+                out.refType = string(mod.types[type.refType].qualifiedName);
+
+            if (type.arraySize) {
+                out.hasLength = 1;
+                out.length = *type.arraySize;
+            }
+
+            out.typeArgs = list(type.typeArgs, [this](flat::Index arg) { return mod.types[arg].qualifiedName; });
+            out.fields = addFields(type.fields);
+        }
+
+        out.location = location(type.location);
+
+        types.push_back(out);
+    }
+
+    void Builder::add(flat::Constant const& constant) {
+        Constant out;
+        out.name = string(constant.name);
+        out.qualified = string(constant.qualifiedName);
+        scope(constant.scope, out.module, out.ns);
+        out.type = string(mod.types[constant.type].name);
+        out.value = value(mod.values[constant.value]);
+        out.annotations = annotate(constant.annotations);
+        out.location = location(constant.location);
+        constants.push_back(out);
+    }
+
+    void Builder::add(flat::Namespace const& ns) {
+        Namespace out;
+        out.name = string(ns.name);
+        out.qualified = string(ns.qualifiedName);
+        out.module = string(ns.module);
+        if (auto const& parent = mod.namespaces[ns.parent]; !parent.name.empty())
+            out.ns = string(parent.qualifiedName);
+        out.types = list(ns.types, [this](flat::Index type) { return mod.types[type].qualifiedName; });
+        out.constants = list(ns.constants, [this](flat::Index constant) { return mod.constants[constant].qualifiedName; });
+        out.namespaces = list(ns.namespaces, [this](flat::Index sub) { return mod.namespaces[sub].qualifiedName; });
+        namespaces.push_back(out);
+    }
+
+    void Builder::write(std::ostream& os) {
+        Header header;
+        std::memcpy(header.magic, binary::magic, sizeof(header.magic));
+        header.version = binary::version;
+        header.moduleName = string(mod.name);
+        header.moduleAnnotations = annotate(mod.moduleAnnotations);
+
+        for (auto const& imp : mod.imports) {
+            Import out;
+            out.name = string(imp.name);
+            out.filename = string(mod.strings[imp.filename]);
+            out.annotations = annotate(imp.annotations);
+            out.location = location(imp.location);
+            imports.push_back(out);
+        }
+
+        for (auto const& type : mod.slice(mod.types, mod.listedTypes))
+            add(type);
+        for (auto const& constant : mod.slice(mod.constants, mod.listedConstants))
+            add(constant);
+        for (auto const& ns : mod.slice(mod.namespaces, mod.listedNamespaces))
+            add(ns);
+
+        // lay out every section in order after the header
+        size_t offset = sizeof(Header);
+        auto const place = [&offset](Section& section, size_t records, size_t recordSize) {
+            offset = align(offset);
+            section = { count(offset), count(records) };
+            offset += records * recordSize;
+        };
+
+        place(header.strings, strings.size(), sizeof(StringEntry));
+        place(header.stringData, stringData.size(), 1);
+        place(header.stringLists, stringLists.size(), sizeof(std::uint32_t));
+        place(header.imports, imports.size(), sizeof(Import));
+        place(header.types, types.size(), sizeof(Type));
+        place(header.fields, fields.size(), sizeof(Field));
+        place(header.enumItems, enumItems.size(), sizeof(EnumItem));
+        place(header.constants, constants.size(), sizeof(Constant));
+        place(header.namespaces, namespaces.size(), sizeof(Namespace));
+        place(header.annotations, annotations.size(), sizeof(Annotation));
+        place(header.values, values.size(), sizeof(Value));
+        header.size = align(offset);
+
+        std::string image(header.size, '\0');
+        auto const copy = [&image](Section const& section, void const* data, size_t size) {
+            if (size != 0)
+                std::memcpy(image.data() + section.offset, data, size);
+        };
+
+        std::memcpy(image.data(), &header, sizeof(header));
+        copy(header.strings, strings.data(), strings.size() * sizeof(StringEntry));
+        copy(header.stringData, stringData.data(), stringData.size());
+        copy(header.stringLists, stringLists.data(), stringLists.size() * sizeof(std::uint32_t));
+        copy(header.imports, imports.data(), imports.size() * sizeof(Import));
+        copy(header.types, types.data(), types.size() * sizeof(Type));
+        copy(header.fields, fields.data(), fields.size() * sizeof(Field));
+        copy(header.enumItems, enumItems.data(), enumItems.size() * sizeof(EnumItem));
+        copy(header.constants, constants.data(), constants.size() * sizeof(Constant));
+        copy(header.namespaces, namespaces.data(), namespaces.size() * sizeof(Namespace));
+        copy(header.annotations, annotations.data(), annotations.size() * sizeof(Annotation));
+        copy(header.values, values.data(), values.size() * sizeof(Value));
+
+        os.write(image.data(), static_cast<std::streamsize>(image.size()));
+    }
+}
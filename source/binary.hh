@@ -0,0 +1,15 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "sapc/location.hh"
+#include "sapc/flat.hh"
+
+#include <iosfwd>
+
+namespace sapc {
+    // writes the module in the flat binary layout described by include/sapc/binary.hh
+    void serializeToBinary(std::ostream& os, flat::Module const& mod, FileTable const& files);
+}
@@ -0,0 +1,260 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "cache.hh"
+#include "file_util.hh"
+#include "hash_util.hh"
+
+#include <fstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace sapc {
+    using namespace std::literals;
+
+    namespace {
+        // bump whenever the entry layout or the compiler output changes
+        constexpr std::string_view cacheMagic = "SAPCACHE";
+        constexpr std::uint32_t cacheVersion = 6;
+
+        struct Writer {
+            std::string& out;
+
+            void u32(std::uint32_t value) {
+                for (int byte = 0; byte != 4; ++byte)
+                    out.push_back(static_cast<char>((value >> (byte * 8)) & 0xFF));
+            }
+            void u64(std::uint64_t value) {
+                for (int byte = 0; byte != 8; ++byte)
+                    out.push_back(static_cast<char>((value >> (byte * 8)) & 0xFF));
+            }
+            void str(std::string_view value) {
+                u32(static_cast<std::uint32_t>(value.size()));
+                out.append(value);
+            }
+            void report(Report const& value) {
+                u32(static_cast<std::uint32_t>(value.severity));
+                u32(static_cast<std::uint32_t>(value.code));
+                str(value.path);
+                for (auto const& position : { value.start, value.end }) {
+                    u32(static_cast<std::uint32_t>(position.line));
+                    u32(static_cast<std::uint32_t>(position.column));
+                }
+                str(value.message);
+            }
+        };
+
+        struct Reader {
+            std::string_view in;
+
+            bool u32(std::uint32_t& out) {
+                if (in.size() < 4)
+                    return false;
+                out = 0;
+                for (int byte = 0; byte != 4; ++byte)
+                    out |= std::uint32_t{ static_cast<unsigned char>(in[byte]) } << (byte * 8);
+                in.remove_prefix(4);
+                return true;
+            }
+            bool u64(std::uint64_t& out) {
+                if (in.size() < 8)
+                    return false;
+                out = 0;
+                for (int byte = 0; byte != 8; ++byte)
+                    out |= std::uint64_t{ static_cast<unsigned char>(in[byte]) } << (byte * 8);
+                in.remove_prefix(8);
+                return true;
+            }
+            bool str(std::string& out) {
+                std::uint32_t size = 0;
+                if (!u32(size) || in.size() < size)
+                    return false;
+                out.assign(in.substr(0, size));
+                in.remove_prefix(size);
+                return true;
+            }
+            bool report(Report& out) {
+                std::uint32_t severity = 0;
+                std::uint32_t code = 0;
+                std::uint32_t positions[4] = {};
+                if (!u32(severity) || severity > static_cast<std::uint32_t>(Severity::Info) || !u32(code) || !str(out.path))
+                    return false;
+                for (auto& value : positions)
+                    if (!u32(value))
+                        return false;
+                if (!str(out.message))
+                    return false;
+
+                out.severity = static_cast<Severity>(severity);
+                out.code = static_cast<int>(code);
+                out.start = { static_cast<int>(positions[0]), static_cast<int>(positions[1]) };
+                out.end = { static_cast<int>(positions[2]), static_cast<int>(positions[3]) };
+                return true;
+            }
+        };
+
+        fs::path entryPath(fs::path const& cacheDir, std::string_view key) {
+            static constexpr char digits[] = "0123456789abcdef";
+
+            auto hash = hash_fnv1a(key);
+            std::string name(16, '0');
+            for (int index = 15; index >= 0; --index, hash >>= 4)
+                name[index] = digits[hash & 0xF];
+            name += ".sapcache";
+
+            return cacheDir / name;
+        }
+
+        bool hashFile(fs::path const& filename, std::uint64_t& out_hash) {
+            std::string contents;
+            if (!loadText(filename, contents))
+                return false;
+            out_hash = hash_fnv1a(contents);
+            return true;
+        }
+
+        // paths are recorded normalized, so that they compare however they
+        // were found, and relative to the working directory, so that they
+        // hold for any checkout of the same project
+        std::string normalPath(fs::path const& path) {
+            return fs::absolute(path).lexically_normal().lexically_proximate(fs::current_path()).string();
+        }
+    }
+
+    // the output records the input and import paths as they were spelled, so
+    // the key holds them as given rather than normalized; relative paths,
+    // like those a build runs from the project root, keep it root-independent
+    std::string cacheKey(fs::path const& target, std::vector<fs::path> const& searchPaths, std::string_view options) {
+        std::string key{ SAPC_VERSION };
+        key += '\n';
+        key += target.string();
+        for (auto const& path : searchPaths) {
+            key += "\n-I"sv;
+            key += path.string();
+        }
+        key += '\n';
+        key += options;
+        return key;
+    }
+
+    bool loadCacheEntry(fs::path const& cacheDir, std::string_view key, CacheResolver const& resolve, CacheEntry& out_entry) {
+        std::string contents;
+        if (!loadText(entryPath(cacheDir, key), contents))
+            return false;
+
+        Reader reader{ contents };
+
+        std::string magic;
+        std::uint32_t version = 0;
+        if (!reader.str(magic) || magic != cacheMagic || !reader.u32(version) || version != cacheVersion)
+            return false;
+
+        // another key may hash to the same entry
+        std::string storedKey;
+        if (!reader.str(storedKey) || storedKey != key)
+            return false;
+
+        std::uint32_t count = 0;
+        if (!reader.u32(count))
+            return false;
+
+        out_entry.dependencies.clear();
+        out_entry.dependencies.reserve(count);
+        for (std::uint32_t index = 0; index != count; ++index) {
+            std::string filename;
+            std::uint64_t expected = 0;
+            std::uint64_t actual = 0;
+            if (!reader.str(filename) || !reader.u64(expected))
+                return false;
+
+            // any modified or missing dependency invalidates the entry
+            if (!hashFile(filename, actual) || actual != expected)
+                return false;
+
+            out_entry.dependencies.emplace_back(filename);
+        }
+
+        if (!reader.u32(count))
+            return false;
+
+        out_entry.imports.clear();
+        out_entry.imports.reserve(count);
+        for (std::uint32_t index = 0; index != count; ++index) {
+            std::string name;
+            std::string importer;
+            std::string filename;
+            if (!reader.str(name) || !reader.str(importer) || !reader.str(filename))
+                return false;
+
+            // a new file may now be found before the one compiled
+            if (normalPath(resolve(name, importer)) != filename)
+                return false;
+
+            out_entry.imports.push_back({ std::move(name), std::move(importer), std::move(filename) });
+        }
+
+        if (!reader.u32(count))
+            return false;
+
+        out_entry.diagnostics.clear();
+        out_entry.diagnostics.reserve(count);
+        for (std::uint32_t index = 0; index != count; ++index)
+            if (!reader.report(out_entry.diagnostics.emplace_back()))
+                return false;
+
+        return reader.str(out_entry.output) && reader.in.empty();
+    }
+
+    bool storeCacheEntry(fs::path const& cacheDir, std::string_view key, CacheEntry const& entry) {
+        std::string contents;
+        Writer writer{ contents };
+
+        writer.str(cacheMagic);
+        writer.u32(cacheVersion);
+        writer.str(key);
+
+        writer.u32(static_cast<std::uint32_t>(entry.dependencies.size()));
+        for (auto const& filename : entry.dependencies) {
+            std::uint64_t hash = 0;
+            if (!hashFile(filename, hash))
+                return false;
+
+            writer.str(normalPath(filename));
+            writer.u64(hash);
+        }
+
+        writer.u32(static_cast<std::uint32_t>(entry.imports.size()));
+        for (auto const& imp : entry.imports) {
+            writer.str(imp.name);
+            writer.str(normalPath(imp.importer));
+            writer.str(normalPath(imp.filename));
+        }
+
+        writer.u32(static_cast<std::uint32_t>(entry.diagnostics.size()));
+        for (auto const& report : entry.diagnostics)
+            writer.report(report);
+
+        writer.str(entry.output);
+
+        std::error_code ec;
+        fs::create_directories(cacheDir, ec);
+
+        // the cache may be shared by concurrent builds, so entries are
+        // written to a unique temporary and then renamed into place
+        auto const target = entryPath(cacheDir, key);
+        auto const temp = tempPath(target);
+
+        {
+            std::ofstream stream(temp, std::ios::binary);
+            if (!stream)
+                return false;
+            stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+            if (!stream)
+                return false;
+        }
+
+        return replaceFile(temp, target, true);
+    }
+}
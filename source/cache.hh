@@ -0,0 +1,47 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "log.hh"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sapc {
+    // An import of one of the dependencies, and the file it resolved to
+    struct CacheImport {
+        std::string name;
+        std::filesystem::path importer;
+        std::filesystem::path filename;
+    };
+
+    // The compiled result of a single input, keyed on the input, the options
+    // that affect the output, and the contents of every file it depended on.
+    // Paths are recorded relative to the working directory, so that a cache
+    // may be shared by checkouts at different roots.
+    struct CacheEntry {
+        std::vector<std::filesystem::path> dependencies;
+        std::vector<CacheImport> imports;
+        std::vector<Report> diagnostics;
+        std::string output;
+    };
+
+    using CacheResolver = std::function<std::filesystem::path(std::string_view moduleName, std::filesystem::path const& importer)>;
+
+    // Everything besides the dependencies that the output depends on; entries
+    // are named by its hash and store it in full to rule out collisions
+    std::string cacheKey(std::filesystem::path const& target, std::vector<std::filesystem::path> const& searchPaths, std::string_view options);
+
+    // Fails if there is no entry, if the entry was stored for another key, if
+    // any recorded dependency has changed, or if any recorded import now
+    // resolves to a different file, as when a file added to an earlier search
+    // path hides the one compiled
+    bool loadCacheEntry(std::filesystem::path const& cacheDir, std::string_view key, CacheResolver const& resolve, CacheEntry& out_entry);
+    bool storeCacheEntry(std::filesystem::path const& cacheDir, std::string_view key, CacheEntry const& entry);
+}
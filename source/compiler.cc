@@ -11,9 +11,13 @@
 #include "lexer.hh"
 #include "log.hh"
 #include "overload.hh"
-#include "schema.hh"
+#include "sapc/schema.hh"
+#include "stats.hh"
+#include "thread_pool.hh"
 
-#include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <cassert>
@@ -61,7 +65,7 @@ namespace sapc {
                     return true;
 
                 for (auto const* lp = lhs.first, *rp = rhs.first; lp != lhs.last; ++lp, ++rp)
-                    if (lp->id != rp->id)
+                    if (lp->id != rp->id) // interned, so compares by address
                         return false;
 
                 return true;
@@ -75,6 +79,23 @@ namespace sapc {
             }
         };
 
+        // a name resolves differently from each namespace
+        struct ResolveKey {
+            schema::Namespace const* scope = nullptr;
+            QualIdSpan qualId;
+
+            friend bool operator==(ResolveKey const& lhs, ResolveKey const& rhs) noexcept {
+                return lhs.scope == rhs.scope && lhs.qualId == rhs.qualId;
+            }
+        };
+
+        struct ResolveKeyHash {
+            using result_type = size_t;
+            result_type operator()(ResolveKey const& key) const noexcept {
+                return hash_combine(key.scope, key.qualId.hash());
+            }
+        };
+
         struct Resolve {
             enum class Kind { Empty, Type, Constant, Namespace, EnumItem };
 
@@ -96,12 +117,66 @@ namespace sapc {
             } data;
         };
 
+        // A file found by import discovery, with the imports its header
+        // names; files not parsed by an earlier target are loaded and
+        // tokenized on worker threads, ahead of parsing
+        struct Node {
+            struct Import {
+                Symbol name;
+                Location location;
+                fs::path filename; // empty if the module wasn't found
+                bool cyclic = false; // closes an import cycle, so it is never compiled
+            };
+
+            bool parsed = false; // by an earlier target, so it isn't loaded again
+            bool opened = false;
+            bool tokenized = false;
+            fs::file_time_type timestamp;
+            std::uint32_t file = 0;
+            std::vector<Token> tokens;
+            std::vector<Import> imports;
+            Log log;
+        };
+
         struct State {
-            ast::ModuleUnit const* unit = nullptr;
+            ast::ModuleUnit* unit = nullptr;
             schema::Module* mod = nullptr;
+            Arena* arena = nullptr; // the module's own, freed when it is released
             std::vector<schema::Namespace*> nsStack;
+            std::unordered_map<std::string_view, ast::CustomTagDecl const*> customTags; // declared or imported by this module
             std::unordered_set<schema::Type const*> importedTypes;
-            std::unordered_map<QualIdSpan, Resolve, QualIdSpanHash> resolveCache;
+            std::unordered_map<ResolveKey, Resolve, ResolveKeyHash> resolveCache; // keys view names in the syntax tree
+            std::vector<std::vector<ast::Annotation>> tagAnnotations; // consumed by uses of custom tags, kept for resolveCache
+            // the root symbols of every import, by name and in import order
+            std::unordered_map<Symbol, std::vector<schema::SymbolTable::Entry const*>> importedSymbols;
+        };
+
+        // a specialization to instantiate once the generics of the module
+        // being compiled are complete
+        struct Instantiation {
+            schema::TypeIndirect* spec = nullptr;
+            unsigned depth = 0; // specializations instantiated to reach this one
+            Location origin; // the use that started the chain
+        };
+
+        // Lists the imported types that a module's types reach, each after
+        // the type that first reaches it, in the order of a recursive walk.
+        // Every module listing everything it reaches would grow with the
+        // square of a chain of imports, so only the target is listed this way.
+        // Chains of types may be as long as the input, so the walk uses a
+        // stack; the types reached are pushed in order and then reversed.
+        struct ReachedTypes {
+            schema::Module& mod;
+            std::vector<schema::Type const*> listed;
+            std::unordered_set<schema::Type const*> seen;
+            std::vector<schema::Type const*> unvisited;
+
+            void list();
+            void walk(schema::Type const* type);
+            void reach(schema::Type const& type);
+            void reach(schema::Field const& field);
+            void reach(schema::Annotation const& annotation);
+            void reach(schema::Value const& value);
         };
 
         struct Compiler {
@@ -109,47 +184,54 @@ namespace sapc {
             Log& log;
 
             std::vector<State> state;
+            std::vector<Instantiation> pending;
 
             schema::Type const* typeIdType = nullptr;
             schema::TypeAggregate const* customTagAttr = nullptr;
             schema::Module const* coreModule = nullptr;
 
-            std::unordered_map<size_t, schema::Type const*> arrayTypeMap;
-            std::unordered_map<schema::Type const*, schema::Type const*> pointerTypeMap;
-            std::unordered_map<size_t, schema::Type const*> specializedTypeMap;
-            std::unordered_map<std::string_view, ast::CustomTagDecl const*> customTagMap;
-
-            schema::Module const* compile(fs::path const& filename);
-
-            void build(ast::Declaration const& decl);
-            void build(ast::NamespaceDecl const& nsDecl);
-            void build(ast::StructDecl const& structDecl);
-            void build(ast::AliasDecl const& aliasDecl);
-            void build(ast::AttributeDecl const& attrDecl);
-            void build(ast::UnionDecl const& unionDecl);
-            void build(ast::EnumDecl const& enumDecl);
-            void build(ast::ConstantDecl const& constantDecl);
+            std::unordered_map<fs::path, std::unique_ptr<Node>, PathHash> nodes;
+            std::unordered_map<fs::path, schema::Module const*, PathHash> compiled; // by this compile, including broken modules
+
+            std::vector<fs::path> discover(fs::path const& target);
+            void load(fs::path const& filename, Node& node);
+            void scanImports(fs::path const& filename, Node& node);
+            std::vector<fs::path> order(fs::path const& target);
+
+            ast::ModuleUnit* parse(fs::path const& filename, Node& node);
+            schema::Module const* compile(fs::path const& filename, ast::ModuleUnit& unit);
+            void retain(fs::path const& filename, ast::ModuleUnit& unit);
+            schema::Module const* findModule(fs::path const& filename) const;
+
+            // the syntax tree is consumed: literals and annotations are
+            // moved out of it into the schema
+            void build(ast::Declaration& decl);
+            void build(ast::NamespaceDecl& nsDecl);
+            void build(ast::StructDecl& structDecl);
+            void build(ast::AliasDecl& aliasDecl);
+            void build(ast::AttributeDecl& attrDecl);
+            void build(ast::UnionDecl& unionDecl);
+            void build(ast::EnumDecl& enumDecl);
+            void build(ast::ConstantDecl& constantDecl);
             void build(ast::ImportDecl const& impDecl);
+            void build(ast::CustomTagDecl const& customTagDecl);
 
             template <typename SchemaType>
-            void build(SchemaType& type, ast::Field const& field);
-            void build(schema::TypeEnum& type, ast::EnumItem const& item);
+            void build(SchemaType& type, ast::Field& field);
+            void build(schema::TypeEnum& type, ast::EnumItem& item);
 
             void createCoreModule();
+            Location builtinLocation(std::uint32_t line);
+            void collectDependencies(schema::Module const& mod, std::unordered_set<schema::Module const*>& visited);
 
             schema::Type const* makeAvailable(schema::Type const* type);
 
-            void makeAvailableRecurse(schema::Type const& type);
-            void makeAvailableRecurse(schema::Field const& field);
-            void makeAvailableRecurse(schema::Annotation const& annotation);
-            void makeAvailableRecurse(schema::Value const& value);
-
             schema::Type const* resolveType(ast::TypeRef const& ref, schema::Type const* scope = nullptr);
 
+            Resolve findLocal(QualIdSpan qualId, schema::SymbolTable::Entry const& entry);
             Resolve findLocal(QualIdSpan qualId, schema::Namespace const* scope);
             Resolve findLocal(QualIdSpan qualId, schema::Type const* scope);
             Resolve findGlobal(QualIdSpan qualId, schema::Namespace const* scope);
-            Resolve findGlobal(QualIdSpan qualId, schema::Type const* scope);
             Resolve findGlobal(QualIdSpan qualId, schema::Module const* scope);
             Resolve resolve(QualIdSpan qualId, schema::Type const* scope = nullptr);
 
@@ -158,59 +240,173 @@ namespace sapc {
 
             schema::Type const* createArrayType(schema::Type const* of, std::optional<long long> arraySize, Location const& loc);
             schema::Type const* createPointerType(schema::Type const* to, Location const& loc);
-            schema::Type const* createSpecializedType(schema::Type const* gen, std::vector<schema::Type const*> const& typeArgs, Location const& loc);
+            schema::Type const* createSpecializedType(schema::Type const* gen, std::vector<schema::Type const*> const& typeArgs, Location const& loc, Instantiation const* from = nullptr);
+            schema::Type const* addDerived(schema::Type const* type);
 
-            schema::Value translate(ast::Literal const& lit);
-            std::unique_ptr<schema::Annotation> translate(ast::Annotation const& anno);
-            void translate(std::vector<std::unique_ptr<schema::Annotation>>& target, std::vector<ast::Annotation> const& annotations);
+            void instantiate(Instantiation const& inst);
+            schema::Type const* substitute(schema::Type const* type, Instantiation const& inst, Location const& loc);
+            static bool dependent(schema::Type const* type) noexcept;
 
-            std::string qualify(std::string_view name) const;
+            schema::Value translate(ast::Literal& lit);
+            schema::Annotation* translate(ast::Annotation& anno);
+            void translate(std::vector<schema::Annotation*>& target, std::vector<ast::Annotation>& annotations);
 
-            ast::ModuleUnit const* parseModule(ast::Identifier const& id, fs::path const& requestingFile);
-            ast::ModuleUnit const* parseModule(fs::path const& filename);
+            Symbol qualify(Symbol name) const;
+            Symbol qualify(Symbol scope, Symbol name) const;
 
-            void applyCustomTag(schema::Annotated& annotated, std::string_view tag);
+            ImportIndex::Resolution resolveImport(std::string_view moduleName, fs::path const& importer) const;
+            void checkSearchPaths();
+
+            void applyCustomTag(schema::Annotated& annotated, std::string tag);
+
+            static schema::SymbolTable const* symbolsOf(schema::Type const* type) noexcept;
         };
     }
 
     bool compile(Context& ctx, Log& log) {
         Compiler compiler{ ctx, log };
-        ctx.rootModule = compiler.compile(ctx.targetFile);
+        if (ctx.imports.setSearchPaths(ctx.searchPaths))
+            compiler.checkSearchPaths();
+
+        // modules compiled without instantiating their specializations can't
+        // be reused, and broken modules are built again by every compile; the
+        // modules importing either would point into the old build
+        std::vector<fs::path> rebuilt;
+        for (auto const& [filename, built] : ctx.builtModules)
+            if ((ctx.instantiate && !ctx.modulesInstantiated) || ctx.moduleMap.count(filename) == 0)
+                rebuilt.push_back(filename);
+        invalidate(ctx, std::move(rebuilt));
+        ctx.modulesInstantiated = ctx.instantiate;
+
+        // imports are discovered first, and then each module is parsed and
+        // compiled after everything it imports
+        for (auto const& filename : compiler.discover(ctx.targetFile)) {
+            if (log.shouldStop())
+                break;
+            auto& node = *compiler.nodes.at(filename);
+            if (auto* const unit = compiler.parse(filename, node); unit != nullptr)
+                compiler.compile(filename, *unit);
+        }
+        ctx.rootModule = compiler.findModule(ctx.targetFile);
+
+        // listing again is cheap, and leaves a listed module unchanged
+        if (auto const it = ctx.builtModules.find(ctx.targetFile); it != ctx.builtModules.end() && it->second.mod == ctx.rootModule)
+            ReachedTypes{ *it->second.mod }.list();
+
+        // modules may have been compiled by a previous target, so the
+        // dependencies are gathered from the import graph
+        ctx.dependencies.clear();
+        if (ctx.rootModule != nullptr) {
+            std::unordered_set<schema::Module const*> visited;
+            compiler.collectDependencies(*ctx.rootModule, visited);
+        }
+
         return ctx.rootModule != nullptr && log.countErrors == 0;
     }
 
-    void Compiler::build(ast::Declaration const& decl) {
+    size_t invalidateModified(Context& ctx) {
+        std::vector<fs::path> stale;
+
+        // sources in memory are invalidated when they are replaced
+        for (auto const& [filename, timestamp] : ctx.timestamps) {
+            if (ctx.sources.count(filename) != 0)
+                continue;
+            std::error_code ec;
+            if (fs::last_write_time(filename, ec) != timestamp || ec)
+                stale.push_back(filename);
+        }
+
+        // files added or removed may change where imports resolve
+        ctx.imports.refresh();
+
+        // failed parses may depend on custom tags from imports, so always retry them
+        for (auto const& [filename, unit] : ctx.astMap)
+            if (unit == nullptr)
+                stale.push_back(filename);
+
+        return invalidate(ctx, std::move(stale));
+    }
+
+    size_t invalidate(Context& ctx, std::vector<fs::path> stale) {
+        std::unordered_map<fs::path, std::vector<fs::path>, PathHash> importers;
+        for (auto const& [filename, imports] : ctx.importGraph)
+            for (auto const& imported : imports)
+                importers[imported.filename].push_back(filename);
+
+        // importers embed types and custom tags from their imports, so they are stale too
+        std::unordered_set<fs::path, PathHash> invalid;
+        while (!stale.empty()) {
+            auto filename = std::move(stale.back());
+            stale.pop_back();
+
+            if (!invalid.insert(filename).second)
+                continue;
+
+            if (auto it = importers.find(filename); it != importers.end())
+                stale.insert(stale.end(), it->second.begin(), it->second.end());
+        }
+
+        // the schema nodes of each module, the derived types built from
+        // them, and the text of its file are freed
+        std::unordered_set<schema::Module const*> released;
+        for (auto const& filename : invalid) {
+            if (auto const it = ctx.builtModules.find(filename); it != ctx.builtModules.end())
+                released.insert(it->second.mod);
+        }
+        ctx.derivedTypes.release(released);
+        if (released.count(ctx.rootModule) != 0)
+            ctx.rootModule = nullptr;
+
+        for (auto const& filename : invalid) {
+            ctx.astMap.erase(filename);
+            ctx.moduleMap.erase(filename);
+            ctx.builtModules.erase(filename);
+            ctx.timestamps.erase(filename);
+            ctx.importGraph.erase(filename);
+
+            auto& file = ctx.files.file(ctx.files.intern(filename));
+            file.text = std::string{};
+            file.lines.reset();
+        }
+
+        return invalid.size();
+    }
+
+    void Compiler::build(ast::Declaration& decl) {
         switch (decl.kind) {
         case ast::Declaration::Kind::Namespace:
-            return build(static_cast<ast::NamespaceDecl const&>(decl));
+            return build(static_cast<ast::NamespaceDecl&>(decl));
         case ast::Declaration::Kind::Struct:
-            return build(static_cast<ast::StructDecl const&>(decl));
+            return build(static_cast<ast::StructDecl&>(decl));
         case ast::Declaration::Kind::Alias:
-            return build(static_cast<ast::AliasDecl const&>(decl));
+            return build(static_cast<ast::AliasDecl&>(decl));
         case ast::Declaration::Kind::Union:
-            return build(static_cast<ast::UnionDecl const&>(decl));
+            return build(static_cast<ast::UnionDecl&>(decl));
         case ast::Declaration::Kind::Attribute:
-            return build(static_cast<ast::AttributeDecl const&>(decl));
+            return build(static_cast<ast::AttributeDecl&>(decl));
         case ast::Declaration::Kind::Enum:
-            return build(static_cast<ast::EnumDecl const&>(decl));
+            return build(static_cast<ast::EnumDecl&>(decl));
         case ast::Declaration::Kind::Constant:
-            return build(static_cast<ast::ConstantDecl const&>(decl));
+            return build(static_cast<ast::ConstantDecl&>(decl));
         case ast::Declaration::Kind::Import:
             return build(static_cast<ast::ImportDecl const&>(decl));
         case ast::Declaration::Kind::Module:
-            for (auto& anno : static_cast<ast::ModuleDecl const&>(decl).annotations)
-                state.back().mod->annotations.push_back(translate(anno));
+            translate(state.back().mod->annotations, static_cast<ast::ModuleDecl&>(decl).annotations);
             break;
         case ast::Declaration::Kind::CustomTag:
-            customTagMap.insert({ static_cast<ast::CustomTagDecl const&>(decl).name.id, static_cast<ast::CustomTagDecl const*>(&decl) });
-            break;
+            return build(static_cast<ast::CustomTagDecl const&>(decl));
         default:
             assert(false && "Unsupported declaration");
         }
     }
 
-    void Compiler::build(ast::NamespaceDecl const& nsDecl) {
-        schema::Namespace* ns = ctx.namespaces.emplace_back(std::make_unique<schema::Namespace>()).get();
+    void Compiler::build(ast::CustomTagDecl const& customTagDecl) {
+        // tags are applied to every declaration using them, so they are never consumed
+        state.back().customTags.insert({ customTagDecl.name.id.str(), &customTagDecl });
+    }
+
+    void Compiler::build(ast::NamespaceDecl& nsDecl) {
+        schema::Namespace* ns = state.back().arena->create<schema::Namespace>();
 
         ns->name = nsDecl.name.id;
         ns->qualifiedName = qualify(ns->name);
@@ -220,22 +416,23 @@ namespace sapc {
 
         state.back().mod->namespaces.push_back(ns);
         state.back().nsStack.back()->namespaces.push_back(ns);
+        state.back().nsStack.back()->symbols.add(ns->name, ns);
         state.back().nsStack.push_back(ns);
 
-        for (auto const& decl : nsDecl.decls)
+        for (auto* const decl : nsDecl.decls)
             build(*decl);
 
         state.back().nsStack.pop_back();
     }
 
-    void Compiler::build(ast::StructDecl const& structDecl) {
+    void Compiler::build(ast::StructDecl& structDecl) {
         assert(!state.empty());
         assert(!state.back().nsStack.empty());
         assert(state.back().mod != nullptr);
 
         auto& mod = *state.back().mod;
 
-        auto* const type = static_cast<schema::TypeAggregate*>(ctx.types.emplace_back(std::make_unique<schema::TypeAggregate>()).get());
+        auto* const type = state.back().arena->create<schema::TypeAggregate>();
         type->name = structDecl.name.id;
         type->qualifiedName = qualify(type->name);
         type->kind = schema::Type::Kind::Struct;
@@ -243,33 +440,40 @@ namespace sapc {
         type->location = structDecl.name.loc;
         if (structDecl.baseType != nullptr)
             type->baseType = requireType(*structDecl.baseType);
+
+        // inherited names are found through the base's symbols rather than
+        // copied, which would grow quadratically along a chain of bases
+        if (auto const* baseSymbols = symbolsOf(type->baseType); baseSymbols != nullptr)
+            type->symbols.inherited = baseSymbols->entries.empty() ? baseSymbols->inherited : baseSymbols;
         translate(type->annotations, structDecl.annotations);
 
         if (!structDecl.customTag.empty())
-            applyCustomTag(*type, structDecl.customTag);
+            applyCustomTag(*type, std::move(structDecl.customTag));
 
         // Build generics before fields, as fields might refer to a generic
         type->typeParams.reserve(structDecl.typeParams.size());
         for (ast::Identifier const& paramDecl : structDecl.typeParams) {
-            auto* const typeParam = static_cast<schema::Type*>(ctx.types.emplace_back(std::make_unique<schema::Type>()).get());
+            auto* const typeParam = state.back().arena->create<schema::Type>();
             typeParam->name = paramDecl.id;
-            typeParam->qualifiedName = type->qualifiedName + "." + paramDecl.id;
+            typeParam->qualifiedName = qualify(type->qualifiedName, paramDecl.id);
             typeParam->kind = schema::Type::Kind::TypeParam;
             typeParam->scope = type->scope;
             type->typeParams.push_back(typeParam);
+            type->symbols.add(typeParam->name, typeParam);
 
             mod.types.push_back(typeParam);
         }
 
         type->fields.reserve(structDecl.fields.size());
-        for (ast::Field const& field : structDecl.fields)
+        for (ast::Field& field : structDecl.fields)
             build(*type, field);
 
         mod.types.push_back(type);
         state.back().nsStack.back()->types.push_back(type);
+        state.back().nsStack.back()->symbols.add(type->name, type);
     }
 
-    void Compiler::build(ast::AliasDecl const& aliasDecl) {
+    void Compiler::build(ast::AliasDecl& aliasDecl) {
         assert(!state.empty());
         assert(!state.back().nsStack.empty());
         assert(state.back().mod != nullptr);
@@ -277,7 +481,7 @@ namespace sapc {
         auto& mod = *state.back().mod;
 
         if (aliasDecl.targetType != nullptr) {
-            auto* const type = static_cast<schema::TypeIndirect*>(ctx.types.emplace_back(std::make_unique<schema::TypeIndirect>()).get());
+            auto* const type = state.back().arena->create<schema::TypeIndirect>();
             type->name = aliasDecl.name.id;
             type->qualifiedName = qualify(type->name);
             type->kind = schema::Type::Kind::Alias;
@@ -286,15 +490,16 @@ namespace sapc {
             translate(type->annotations, aliasDecl.annotations);
 
             if (!aliasDecl.customTag.empty())
-                applyCustomTag(*type, aliasDecl.customTag);
+                applyCustomTag(*type, std::move(aliasDecl.customTag));
 
             type->refType = requireType(*aliasDecl.targetType, type);
 
             mod.types.push_back(type);
             state.back().nsStack.back()->types.push_back(type);
+            state.back().nsStack.back()->symbols.add(type->name, type);
         }
         else {
-            auto* const type = static_cast<schema::Type*>(ctx.types.emplace_back(std::make_unique<schema::Type>()).get());
+            auto* const type = state.back().arena->create<schema::Type>();
             type->name = aliasDecl.name.id;
             type->qualifiedName = qualify(type->name);
             type->kind = schema::Type::Kind::Simple;
@@ -303,21 +508,22 @@ namespace sapc {
             translate(type->annotations, aliasDecl.annotations);
 
             if (!aliasDecl.customTag.empty())
-                applyCustomTag(*type, aliasDecl.customTag);
+                applyCustomTag(*type, std::move(aliasDecl.customTag));
 
             mod.types.push_back(type);
             state.back().nsStack.back()->types.push_back(type);
+            state.back().nsStack.back()->symbols.add(type->name, type);
         }
     }
 
-    void Compiler::build(ast::AttributeDecl const& attrDecl) {
+    void Compiler::build(ast::AttributeDecl& attrDecl) {
         assert(!state.empty());
         assert(!state.back().nsStack.empty());
         assert(state.back().mod != nullptr);
 
         auto& mod = *state.back().mod;
 
-        auto* const type = static_cast<schema::TypeAggregate*>(ctx.types.emplace_back(std::make_unique<schema::TypeAggregate>()).get());
+        auto* const type = state.back().arena->create<schema::TypeAggregate>();
         type->name = attrDecl.name.id;
         type->qualifiedName = qualify(type->name);
         type->kind = schema::Type::Kind::Attribute;
@@ -326,47 +532,51 @@ namespace sapc {
         translate(type->annotations, attrDecl.annotations);
 
         type->fields.reserve(attrDecl.fields.size());
-        for (ast::Field const& field : attrDecl.fields)
+        for (ast::Field& field : attrDecl.fields)
             build(*type, field);
 
         mod.types.push_back(type);
         state.back().nsStack.back()->types.push_back(type);
+        state.back().nsStack.back()->symbols.add(type->name, type);
     }
 
-    void Compiler::build(ast::EnumDecl const& enumDecl) {
+    void Compiler::build(ast::EnumDecl& enumDecl) {
         assert(!state.empty());
         assert(!state.back().nsStack.empty());
         assert(state.back().mod != nullptr);
 
         auto& mod = *state.back().mod;
 
-        auto* const type = static_cast<schema::TypeEnum*>(ctx.types.emplace_back(std::make_unique<schema::TypeEnum>()).get());
+        auto* const type = state.back().arena->create<schema::TypeEnum>();
         type->name = enumDecl.name.id;
         type->qualifiedName = qualify(type->name);
         type->kind = schema::Type::Kind::Enum;
         type->scope = state.back().nsStack.back();
         type->location = enumDecl.name.loc;
+        if (enumDecl.baseType != nullptr)
+            type->baseType = requireType(*enumDecl.baseType);
         translate(type->annotations, enumDecl.annotations);
 
         if (!enumDecl.customTag.empty())
-            applyCustomTag(*type, enumDecl.customTag);
+            applyCustomTag(*type, std::move(enumDecl.customTag));
 
         type->items.reserve(enumDecl.items.size());
-        for (ast::EnumItem const& item : enumDecl.items)
+        for (ast::EnumItem& item : enumDecl.items)
             build(*type, item);
 
         mod.types.push_back(type);
         state.back().nsStack.back()->types.push_back(type);
+        state.back().nsStack.back()->symbols.add(type->name, type);
     }
 
-    void Compiler::build(ast::UnionDecl const& unionDecl) {
+    void Compiler::build(ast::UnionDecl& unionDecl) {
         assert(!state.empty());
         assert(!state.back().nsStack.empty());
         assert(state.back().mod != nullptr);
 
         auto& mod = *state.back().mod;
 
-        auto* const type = static_cast<schema::TypeAggregate*>(ctx.types.emplace_back(std::make_unique<schema::TypeAggregate>()).get());
+        auto* const type = state.back().arena->create<schema::TypeAggregate>();
         type->name = unionDecl.name.id;
         type->qualifiedName = qualify(type->name);
         type->kind = schema::Type::Kind::Union;
@@ -375,14 +585,14 @@ namespace sapc {
         translate(type->annotations, unionDecl.annotations);
 
         if (!unionDecl.customTag.empty())
-            applyCustomTag(*type, unionDecl.customTag);
+            applyCustomTag(*type, std::move(unionDecl.customTag));
 
         // Build generics before fields, as fields might refer to a generic
         type->typeParams.reserve(unionDecl.typeParams.size());
         for (ast::Identifier const& paramDecl : unionDecl.typeParams) {
-            auto* const typeParam = static_cast<schema::Type*>(ctx.types.emplace_back(std::make_unique<schema::Type>()).get());
+            auto* const typeParam = state.back().arena->create<schema::Type>();
             typeParam->name = paramDecl.id;
-            typeParam->qualifiedName = type->qualifiedName + "." + paramDecl.id;
+            typeParam->qualifiedName = qualify(type->qualifiedName, paramDecl.id);
             typeParam->kind = schema::Type::Kind::TypeParam;
             typeParam->scope = type->scope;
             type->typeParams.push_back(typeParam);
@@ -391,21 +601,22 @@ namespace sapc {
         }
 
         type->fields.reserve(unionDecl.fields.size());
-        for (ast::Field const& field : unionDecl.fields)
+        for (ast::Field& field : unionDecl.fields)
             build(*type, field);
 
         mod.types.push_back(type);
         state.back().nsStack.back()->types.push_back(type);
+        state.back().nsStack.back()->symbols.add(type->name, type);
     }
 
-    void Compiler::build(ast::ConstantDecl const& constantDecl) {
+    void Compiler::build(ast::ConstantDecl& constantDecl) {
         assert(!state.empty());
         assert(!state.back().nsStack.empty());
         assert(state.back().mod != nullptr);
 
         auto& mod = *state.back().mod;
 
-        auto* constant = ctx.constants.emplace_back(std::make_unique<schema::Constant>()).get();
+        auto* constant = state.back().arena->create<schema::Constant>();
         constant->name = constantDecl.name.id;
         constant->qualifiedName = qualify(constant->name);
         constant->location = constantDecl.name.loc;
@@ -414,15 +625,16 @@ namespace sapc {
         constant->value = translate(constantDecl.value);
 
         if (!constantDecl.customTag.empty())
-            applyCustomTag(*constant, constantDecl.customTag);
+            applyCustomTag(*constant, std::move(constantDecl.customTag));
 
         mod.constants.push_back(constant);
         state.back().nsStack.back()->constants.push_back(constant);
+        state.back().nsStack.back()->symbols.add(constant->name, constant);
     }
 
     template <typename SchemaType>
-    void Compiler::build(SchemaType& type, ast::Field const& fieldDecl) {
-        auto& field = type.fields.emplace_back(std::make_unique<schema::Field>());
+    void Compiler::build(SchemaType& type, ast::Field& fieldDecl) {
+        auto* const field = type.fields.emplace_back(state.back().arena->create<schema::Field>());
         field->name = fieldDecl.name.id;
         field->location = fieldDecl.name.loc;
         field->type = requireType(*fieldDecl.type, &type);
@@ -431,11 +643,12 @@ namespace sapc {
             field->defaultValue = translate(*fieldDecl.init);
     }
 
-    void Compiler::build(schema::TypeEnum& type, ast::EnumItem const& itemDecl) {
-        auto* const item = type.items.emplace_back(std::make_unique<schema::EnumItem>()).get();
+    void Compiler::build(schema::TypeEnum& type, ast::EnumItem& itemDecl) {
+        auto* const item = type.items.emplace_back(state.back().arena->create<schema::EnumItem>());
         item->name = itemDecl.name.id;
         item->location = itemDecl.name.loc;
         item->parent = &type;
+        type.symbols.add(item->name, item);
         item->value = itemDecl.value;
         translate(item->annotations, itemDecl.annotations);
     }
@@ -446,55 +659,336 @@ namespace sapc {
 
         auto& mod = *state.back().mod;
 
-        auto const parent = state.back().unit->filename.parent_path();
-        auto const basename = fs::path{ impDecl.target.id }.replace_extension(".sap");
-        auto const filename = resolveFile(basename, parent, ctx.searchPaths);
-        if (filename.empty()) {
-            log.error(impDecl.target.loc, impDecl.target.id, ": module not found");
+        // missing modules and import cycles were reported by discovery
+        auto const [filename, shadowed] = resolveImport(impDecl.target.id.str(), mod.filename);
+        if (filename.empty())
             return;
+        for (auto const& hidden : shadowed) {
+            log.warn(Code::ImportHidden, impDecl.target.loc, "module `", impDecl.target.id, "' resolves to `", filename.string(), "', hiding `", hidden.string(), "'");
+            log.info(Code::HiddenFile, Location{ ctx.files.intern(hidden) }, "hidden by an earlier search path");
         }
 
-        auto it = ctx.moduleMap.find(filename);
-        if (it != ctx.moduleMap.end())
+        // custom tags from the import may be used by this module, and they
+        // won't have been seen yet if the import was compiled for an earlier target
+        if (auto it = ctx.astMap.find(filename); it != ctx.astMap.end() && it->second != nullptr)
+            for (auto const* decl : it->second->decls)
+                if (decl->kind == ast::Declaration::Kind::CustomTag)
+                    build(*static_cast<ast::CustomTagDecl const*>(decl));
+
+        // imports are compiled before their importers, unless they failed to
+        // parse or are part of a cycle
+        auto const* const imp = findModule(filename);
+        if (imp == nullptr)
             return;
 
-        if (auto const* imp = compile(filename); imp != nullptr)
-            mod.imports.push_back({ imp, impDecl.target.loc });
+        mod.imports.push_back({ imp, impDecl.target.loc });
+
+        // index the exports once, so lookups don't depend on the number of imports
+        auto& importedSymbols = state.back().importedSymbols;
+        for (auto const& [name, entry] : imp->root->symbols.entries)
+            importedSymbols[name].push_back(&entry);
     }
 
-    schema::Module const* Compiler::compile(fs::path const& filename) {
-        ctx.dependencies.push_back(filename);
+    std::vector<fs::path> Compiler::discover(fs::path const& target) {
+        // Loading and tokenizing only depend on the file contents, so the
+        // whole import graph is found, loaded, and tokenized on worker
+        // threads; imports are found by scanning the tokens for import
+        // declarations. Parsing and compilation then proceed in dependency
+        // order on this thread.
+        Stats::Scope scope(ctx.stats, "discover");
+        ThreadPool pool(ctx.jobs);
+        std::mutex mutex;
+
+        std::function<void(fs::path const&)> enqueue = [&](fs::path const& filename) {
+            Node* node = nullptr;
+            {
+                std::lock_guard lock(mutex);
+                if (nodes.count(filename) != 0)
+                    return;
+                node = nodes.emplace(filename, std::make_unique<Node>()).first->second.get();
+            }
 
-        auto const* const unit = parseModule(filename);
-        if (!unit)
-            return nullptr;
+            pool.submit([this, node, filename, &enqueue] {
+                scanImports(filename, *node);
+                for (auto const& imp : node->imports)
+                    if (!imp.filename.empty())
+                        enqueue(imp.filename);
+            });
+        };
+
+        enqueue(target);
+        pool.wait();
+
+        return order(target);
+    }
+
+    void Compiler::load(fs::path const& filename, Node& node) {
+        Stats::Scope scope(ctx.stats, "load", filename);
+        node.log.files = &ctx.files;
+
+        // the text is kept in the file table, where it backs the tokens and later diagnostics
+        node.file = ctx.files.intern(filename);
+        auto& source = ctx.files.file(node.file);
+        source.lines.reset();
+
+        if (auto const it = ctx.sources.find(filename); it != ctx.sources.end())
+            source.text = it->second;
+        else {
+            // stamp before loading, so a concurrent edit is seen as a change
+            std::error_code ec;
+            node.timestamp = fs::last_write_time(filename, ec);
+
+            if (!loadText(filename, source.text))
+                return;
+        }
+        node.opened = true;
+
+        Stats::Scope tokenizeScope(ctx.stats, "tokenize", filename);
+        node.tokenized = tokenize(source.text, node.file, node.tokens, node.log);
+    }
+
+    void Compiler::scanImports(fs::path const& filename, Node& node) {
+        // a module parsed by an earlier target lists its imports in its
+        // syntax tree, unless it failed to compile and must be parsed again
+        if (auto const it = ctx.astMap.find(filename); it != ctx.astMap.end() && (it->second == nullptr || !it->second->lowered || ctx.moduleMap.count(filename) != 0)) {
+            node.parsed = true;
+            if (it->second != nullptr)
+                for (auto const* decl : it->second->decls)
+                    if (decl->kind == ast::Declaration::Kind::Import) {
+                        auto const& target = static_cast<ast::ImportDecl const*>(decl)->target;
+                        node.imports.push_back({ target.id, target.loc, resolveImport(target.id.str(), filename).filename });
+                    }
+            return;
+        }
+
+        load(filename, node);
+        if (!node.tokenized)
+            return;
+
+        // any import declaration that fails to parse is reported by the grammar
+        auto const& tokens = node.tokens;
+        for (size_t index = 0; index + 1 < tokens.size(); ++index) {
+            if (tokens[index].type != TokenType::KeywordImport || tokens[index + 1].type != TokenType::Identifier)
+                continue;
+
+            auto const& name = tokens[index + 1];
+            node.imports.push_back({ ctx.symbols.intern(name.dataString), Location{ node.file, name.offset, name.offset + name.length }, resolveImport(name.dataString, filename).filename });
+        }
+    }
+
+    std::vector<fs::path> Compiler::order(fs::path const& target) {
+        // a depth-first walk, kept on an explicit stack so that long import
+        // chains can't overflow the native one; files are listed after
+        // everything they import
+        struct Frame {
+            fs::path const* filename = nullptr;
+            Node* node = nullptr;
+            size_t next = 0;
+        };
+
+        enum class Mark { Active, Done };
+        std::unordered_map<fs::path const*, Mark> marks;
+        std::vector<Frame> stack;
+        std::vector<fs::path> sorted;
+        sorted.reserve(nodes.size());
+
+        auto const push = [&](fs::path const& filename) {
+            auto const it = nodes.find(filename);
+            marks[&it->first] = Mark::Active;
+            stack.push_back({ &it->first, it->second.get() });
+        };
+
+        push(target);
+        while (!stack.empty()) {
+            auto& frame = stack.back();
+            if (frame.next == frame.node->imports.size()) {
+                marks[frame.filename] = Mark::Done;
+                sorted.push_back(*frame.filename);
+                stack.pop_back();
+                continue;
+            }
+
+            auto& imp = frame.node->imports[frame.next++];
+            if (imp.filename.empty()) {
+                log.error(Code::ModuleNotFound, imp.location, imp.name, ": module not found");
+                continue;
+            }
+
+            auto const key = &nodes.find(imp.filename)->first;
+            if (auto const mark = marks.find(key); mark == marks.end())
+                push(imp.filename);
+            else if (mark->second == Mark::Active) {
+                // the cycle runs from the import's target down the stack to this file
+                imp.cyclic = true;
+                std::string cycle;
+                for (auto it = std::find_if(stack.begin(), stack.end(), [key](Frame const& f) { return f.filename == key; }); it != stack.end(); ++it) {
+                    cycle += it->filename->stem().string();
+                    cycle += " -> ";
+                }
+                cycle += key->stem().string();
+                log.error(Code::ImportCycle, imp.location, "module `", imp.name, "' is imported in a cycle: ", cycle);
+            }
+        }
+
+        // discovery's worker threads saw every file; record what each imports
+        for (auto& [filename, node] : nodes) {
+            auto& graph = ctx.importGraph[filename];
+            graph.clear();
+            for (auto const& imp : node->imports) {
+                auto const same = [&imp](Context::ImportedFile const& imported) { return imported.filename == imp.filename; };
+                if (!imp.filename.empty() && std::none_of(graph.begin(), graph.end(), same))
+                    graph.push_back({ imp.name, imp.filename });
+            }
+        }
+
+        return sorted;
+    }
+
+    ast::ModuleUnit* Compiler::parse(fs::path const& filename, Node& node) {
+        if (node.parsed) {
+            auto* const unit = ctx.astMap.at(filename).get();
+
+            // parse errors were reported by the target that first loaded the file
+            if (unit == nullptr)
+                log.error(Code::ParseFailed, Location{ ctx.files.intern(filename) }, "failed to parse module");
+            return unit;
+        }
+
+        ctx.timestamps[filename] = node.timestamp;
+
+        std::unique_ptr<ast::ModuleUnit> moduleAst;
+        if (!node.opened)
+            log.error(Code::OpenFailed, Location{ node.file }, "failed to open input");
+        else {
+            log.merge(std::move(node.log));
+            if (node.tokenized) {
+                // imports were parsed first; the tags of those that failed are unknown
+                ImportedTags importedTags;
+                for (auto const& imp : node.imports) {
+                    if (imp.filename.empty() || imp.cyclic)
+                        continue;
+                    auto const it = ctx.astMap.find(imp.filename);
+                    if (it == ctx.astMap.end() || it->second == nullptr)
+                        continue;
+                    auto& tags = importedTags[imp.name];
+                    for (auto const* decl : it->second->decls)
+                        if (decl->kind == ast::Declaration::Kind::CustomTag)
+                            tags.push_back(static_cast<ast::CustomTagDecl const*>(decl));
+                }
+
+                Stats::Scope scope(ctx.stats, "grammar", filename);
+                moduleAst = sapc::parse(filename, node.file, node.tokens, importedTags, ctx.symbols, log);
+            }
+        }
+        node.tokens = {};
+
+        auto* const unit = moduleAst.get();
+        ctx.astMap[filename] = std::move(moduleAst);
+        return unit;
+    }
+
+    schema::Module const* Compiler::findModule(fs::path const& filename) const {
+        if (auto const it = compiled.find(filename); it != compiled.end())
+            return it->second;
+        if (auto const it = ctx.moduleMap.find(filename); it != ctx.moduleMap.end())
+            return it->second;
+        return nullptr;
+    }
+
+    schema::Module const* Compiler::compile(fs::path const& filename, ast::ModuleUnit& unit) {
+        if (auto it = ctx.moduleMap.find(filename); it != ctx.moduleMap.end())
+            return it->second;
+
+        Stats::Scope scope(ctx.stats, "compile", filename);
+        auto const startErrors = log.countErrors;
 
         createCoreModule();
 
-        ctx.modules.push_back(std::make_unique<schema::Module>());
-        ctx.namespaces.push_back(std::make_unique<schema::Namespace>());
-        auto* const ns = ctx.namespaces.back().get();
-        auto* const mod = ctx.modules.back().get();
-        mod->name = unit->name.id;
-        mod->location = unit->name.loc;
+        auto& built = ctx.builtModules[filename];
+        assert(built.arena == nullptr);
+        built.arena = std::make_unique<Arena>();
+
+        auto* const ns = built.arena->create<schema::Namespace>();
+        auto* const mod = built.arena->create<schema::Module>();
+        built.mod = mod;
+        mod->name = unit.name.id;
+        mod->location = unit.name.loc;
+        mod->filename = std::move(unit.filename);
         mod->root = ns;
         ns->owner = mod;
 
-        state.push_back(State{ unit, mod });
-        state.back().nsStack.push_back(ctx.namespaces.back().get());
+        state.push_back(State{ &unit, mod, built.arena.get() });
+        state.back().nsStack.push_back(ns);
 
-        for (auto const& decl : state.back().unit->decls)
+        for (auto* const decl : state.back().unit->decls) {
+            if (log.shouldStop())
+                break;
             build(*decl);
+        }
+
+        // the module's generics are complete now; instantiating may queue more
+        for (size_t index = 0; index != pending.size() && !log.shouldStop(); ++index)
+            instantiate(Instantiation{ pending[index] });
+        pending.clear();
 
         state.pop_back();
 
+        if (ctx.stats != nullptr)
+            ctx.stats->countModule(*mod);
+
+        // only modules that compiled cleanly may be reused; a broken
+        // module is parsed and built again so that each target reports its
+        // errors, as building consumed its syntax tree
+        if (log.countErrors == startErrors)
+            ctx.moduleMap.insert({ filename, mod });
+        compiled.insert({ filename, mod });
+        retain(filename, unit);
+
         return mod;
     }
 
+    void Compiler::retain(fs::path const& filename, ast::ModuleUnit& unit) {
+        // importers only need the module's imports and custom tags, which
+        // are moved into a small tree of their own so that the rest is freed
+        auto kept = std::make_unique<ast::ModuleUnit>();
+        kept->name = unit.name;
+        kept->lowered = true;
+        for (auto* const decl : unit.decls) {
+            if (decl->kind == ast::Declaration::Kind::Import)
+                kept->decls.push_back(kept->arena.create<ast::ImportDecl>(std::move(*static_cast<ast::ImportDecl*>(decl))));
+            else if (decl->kind == ast::Declaration::Kind::CustomTag)
+                kept->decls.push_back(kept->arena.create<ast::CustomTagDecl>(std::move(*static_cast<ast::CustomTagDecl*>(decl))));
+        }
+
+        ctx.astMap[filename] = std::move(kept);
+    }
+
+    void Compiler::collectDependencies(schema::Module const& mod, std::unordered_set<schema::Module const*>& visited) {
+        if (!visited.insert(&mod).second)
+            return;
+
+        ctx.dependencies.push_back(mod.filename);
+
+        for (auto const& imp : mod.imports)
+            collectDependencies(*imp.mod, visited);
+    }
+
     void Compiler::createCoreModule() {
         if (coreModule != nullptr)
             return;
 
+        // the core module is shared by every target compiled with a context
+        if (ctx.coreModule != nullptr) {
+            coreModule = ctx.coreModule;
+            for (auto const* type : coreModule->types) {
+                if (type->name == typeIdName)
+                    typeIdType = type;
+                else if (type->name == customTagName)
+                    customTagAttr = static_cast<schema::TypeAggregate const*>(type);
+            }
+            return;
+        }
+
         // add built-in types
         static constexpr std::string_view builtins[] = {
             "string"sv, // the first type must be string
@@ -504,121 +998,167 @@ namespace sapc {
             "float"sv,
         };
 
-        schema::Namespace* ns = ctx.namespaces.emplace_back(std::make_unique<schema::Namespace>()).get();
-        schema::Module* mod = ctx.modules.emplace_back(std::make_unique<schema::Module>()).get();
+        schema::Namespace* ns = ctx.arena.create<schema::Namespace>();
+        schema::Module* mod = ctx.arena.create<schema::Module>();
         mod->root = ns;
         coreModule = mod;
-        mod->name = "$core";
+        ctx.coreModule = mod;
+        mod->name = ctx.symbols.intern("$core");
         ns->owner = mod;
 
         for (auto const& builtin : builtins) {
-            auto* const type = ctx.types.emplace_back(std::make_unique<schema::Type>()).get();
+            auto* const type = ctx.arena.create<schema::Type>();
             mod->types.push_back(type);
             ns->types.push_back(type);
 
             type->kind = schema::Type::Kind::Simple;
-            type->name = builtin;
-            type->qualifiedName = builtin;
+            type->name = ctx.symbols.intern(builtin);
+            type->qualifiedName = type->name;
             type->scope = ns;
-            type->location = { std::filesystem::absolute(__FILE__), {__LINE__ } };
+            type->location = builtinLocation(__LINE__);
+            ns->symbols.add(type->name, type);
         }
 
         {
-            auto* const type = ctx.types.emplace_back(std::make_unique<schema::Type>()).get();
+            auto* const type = ctx.arena.create<schema::Type>();
             mod->types.push_back(type);
             ns->types.push_back(type);
             typeIdType = type;
 
             type->kind = schema::Type::Kind::TypeId;
-            type->name = typeIdName;
-            type->qualifiedName = typeIdName;
+            type->name = ctx.symbols.intern(typeIdName);
+            type->qualifiedName = type->name;
             type->scope = ns;
-            type->location = { std::filesystem::absolute(__FILE__), {__LINE__ } };
+            type->location = builtinLocation(__LINE__);
+            ns->symbols.add(type->name, type);
         }
 
         {
-            auto* const type = static_cast<schema::TypeAggregate*>(ctx.types.emplace_back(std::make_unique<schema::TypeAggregate>()).get());
+            auto* const type = ctx.arena.create<schema::TypeAggregate>();
             mod->types.push_back(type);
             ns->types.push_back(type);
             customTagAttr = type;
 
             type->kind = schema::Type::Kind::Attribute;
-            type->name = customTagName;
-            type->qualifiedName = customTagName;
+            type->name = ctx.symbols.intern(customTagName);
+            type->qualifiedName = type->name;
             type->scope = ns;
-            type->location = { std::filesystem::absolute(__FILE__), {__LINE__ } };
+            type->location = builtinLocation(__LINE__);
+            ns->symbols.add(type->name, type);
 
-            auto* const field = type->fields.emplace_back(std::make_unique<schema::Field>()).get();
-            field->name = "tag";
+            auto* const field = type->fields.emplace_back(ctx.arena.create<schema::Field>());
+            field->name = ctx.symbols.intern("tag");
             field->type = ns->types.front(); // the first type is always string
-            field->location = { std::filesystem::absolute(__FILE__), {__LINE__ } };
+            field->location = builtinLocation(__LINE__);
         }
     }
 
-    schema::Type const* Compiler::makeAvailable(schema::Type const* type) {
-        if (type != nullptr)
-            makeAvailableRecurse(*type);
-        return type;
+    Location Compiler::builtinLocation(std::uint32_t line) {
+        // built-in declarations point at this file, identified by line alone
+        auto const file = ctx.files.intern(std::filesystem::absolute(__FILE__));
+        ctx.files.file(file).lineOffsets = true;
+        return Location{ file, line, line };
     }
 
-    void Compiler::makeAvailableRecurse(schema::Type const& type) {
-        schema::Module* const mod = state.back().mod;
+    void ReachedTypes::list() {
+        // the module's own types are listed where they are declared
+        listed.reserve(mod.types.size());
+        for (auto const* type : mod.types) {
+            if (type->scope->owner != &mod)
+                walk(type);
+            else if (seen.insert(type).second)
+                listed.push_back(type);
+        }
+        mod.types = std::move(listed);
+    }
 
-        if (type.scope->owner == mod)
-            return;
+    void ReachedTypes::walk(schema::Type const* type) {
+        unvisited.push_back(type);
+        while (!unvisited.empty()) {
+            auto const* const next = unvisited.back();
+            unvisited.pop_back();
 
-        auto const rs = state.back().importedTypes.insert(&type);
-        if (!rs.second)
-            return;
+            if (next->scope->owner == &mod || !seen.insert(next).second)
+                continue;
+            listed.push_back(next);
 
-        // add the type to the module
-        mod->types.push_back(&type);
+            auto const reached = unvisited.size();
+            reach(*next);
+            std::reverse(unvisited.begin() + reached, unvisited.end());
+        }
+    }
 
+    void ReachedTypes::reach(schema::Type const& type) {
         for (auto const& anno : type.annotations)
-            makeAvailableRecurse(*anno);
+            reach(*anno);
 
         if (type.kind == schema::Type::Kind::Struct || type.kind == schema::Type::Kind::Attribute || type.kind == schema::Type::Kind::Union) {
             auto const& typeAggr = static_cast<schema::TypeAggregate const&>(type);
 
-            makeAvailable(typeAggr.baseType);
+            if (typeAggr.baseType != nullptr)
+                unvisited.push_back(typeAggr.baseType);
 
             for (auto const& field : typeAggr.fields)
-                makeAvailableRecurse(*field);
+                reach(*field);
 
             for (auto const* typeParam : typeAggr.typeParams)
-                makeAvailableRecurse(*typeParam);
+                unvisited.push_back(typeParam);
+        }
+        else if (type.kind == schema::Type::Kind::Enum) {
+            if (auto const* const base = static_cast<schema::TypeEnum const&>(type).baseType; base != nullptr)
+                unvisited.push_back(base);
         }
         else if (type.kind == schema::Type::Kind::Alias || type.kind == schema::Type::Kind::Pointer || type.kind == schema::Type::Kind::Array || type.kind == schema::Type::Kind::Specialized) {
             auto const& typeInd = static_cast<schema::TypeIndirect const&>(type);
 
-            makeAvailable(typeInd.refType);
+            if (typeInd.refType != nullptr)
+                unvisited.push_back(typeInd.refType);
 
             for (auto const* typeArg : typeInd.typeArgs)
-                makeAvailableRecurse(*typeArg);
+                unvisited.push_back(typeArg);
+
+            // instantiated fields may use types that the generic itself doesn't
+            for (auto const* field : typeInd.fields)
+                if (field->type != nullptr)
+                    unvisited.push_back(field->type);
         }
     }
 
-    void Compiler::makeAvailableRecurse(schema::Field const& field) {
-        makeAvailableRecurse(*field.type);
+    // types that failed to resolve are left null in schema nodes of broken modules
+    void ReachedTypes::reach(schema::Field const& field) {
+        if (field.type != nullptr)
+            unvisited.push_back(field.type);
         if (field.defaultValue)
-            makeAvailableRecurse(*field.defaultValue);
+            reach(*field.defaultValue);
         for (auto const& anno : field.annotations)
-            makeAvailableRecurse(*anno);
+            reach(*anno);
     }
 
-    void Compiler::makeAvailableRecurse(schema::Annotation const& annotation) {
-        makeAvailableRecurse(*annotation.type);
+    void ReachedTypes::reach(schema::Annotation const& annotation) {
+        if (annotation.type != nullptr)
+            unvisited.push_back(annotation.type);
         for (auto const& arg : annotation.args)
-            makeAvailableRecurse(arg);
+            reach(arg);
     }
 
-    void Compiler::makeAvailableRecurse(schema::Value const& value) {
+    void ReachedTypes::reach(schema::Value const& value) {
         std::visit([this](auto const& value) {
             if constexpr (std::is_same_v<schema::Type const*, std::remove_cv_t<decltype(value)>>)
-                makeAvailable(value);
+                if (value != nullptr)
+                    unvisited.push_back(value);
             }, value.data);
     }
 
+    // only the imported types used directly are listed while compiling; the
+    // types that they reach are listed once the module is compiled as a target
+    schema::Type const* Compiler::makeAvailable(schema::Type const* type) {
+        schema::Module* const mod = state.back().mod;
+
+        if (type != nullptr && type->scope->owner != mod && state.back().importedTypes.insert(type).second)
+            mod->types.push_back(type);
+        return type;
+    }
+
     schema::Type const* Compiler::resolveType(ast::TypeRef const& ref, schema::Type const* scope) {
         switch (ref.kind) {
         case ast::TypeRef::Kind::TypeName:
@@ -662,81 +1202,66 @@ namespace sapc {
         if (qualId.size() != 1)
             return {};
 
-        if (scope->kind == schema::Type::Kind::Enum) {
-            auto const& typeEnum = *static_cast<schema::TypeEnum const*>(scope);
-            for (auto const& item : typeEnum.items)
-                if (item->name == qualId.front().id)
-                    return Resolve{ item.get() };
-        }
-        else if (scope->kind == schema::Type::Kind::Struct) {
-            auto const& typeAggr = *static_cast<schema::TypeAggregate const*>(scope);
-            if (typeAggr.baseType != nullptr)
-                if (auto const rs = findLocal(qualId, typeAggr.baseType); rs.kind != Resolve::Kind::Empty)
-                    return rs;
-            for (auto const* typeParam : typeAggr.typeParams)
-                if (typeParam->name == qualId.front().id)
-                    return Resolve{ typeParam };
+        // the symbols of a base type take precedence over those of the types derived from it
+        Resolve rs;
+        for (auto const* symbols = symbolsOf(scope); symbols != nullptr; symbols = symbols->inherited) {
+            if (auto const* entry = symbols->find(qualId.front().id); entry != nullptr) {
+                if (entry->enumItem != nullptr)
+                    rs = Resolve{ entry->enumItem };
+                else if (entry->type != nullptr)
+                    rs = Resolve{ entry->type };
+            }
         }
 
-        return {};
+        return rs;
     }
 
-    Resolve Compiler::findLocal(QualIdSpan qualId, schema::Namespace const* scope) {
+    Resolve Compiler::findLocal(QualIdSpan qualId, schema::SymbolTable::Entry const& entry) {
         assert(!qualId.empty());
-        assert(scope != nullptr);
 
         if (qualId.size() == 1) {
-            for (auto const* ns : scope->namespaces)
-                if (ns->name == qualId.front().id)
-                    return Resolve{ ns };
-
-            for (auto const* type : scope->types)
-                if (type->name == qualId.front().id)
-                    return Resolve{ makeAvailable(type) };
-
-            for (auto const* constant : scope->constants)
-                if (constant->name == qualId.front().id)
-                    return Resolve{ constant };
+            if (!entry.namespaces.empty())
+                return Resolve{ entry.namespaces.front() };
+            if (entry.type != nullptr)
+                return Resolve{ makeAvailable(entry.type) };
+            if (entry.constant != nullptr)
+                return Resolve{ entry.constant };
+            return {};
         }
-        else {
-            for (auto const* ns : scope->namespaces)
-                if (ns->name == qualId.front().id)
-                    if (auto const rs = findLocal(qualId.skip(1), ns))
-                        return rs;
 
-            for (auto const* scopeType : scope->types)
-                if (scopeType->name == qualId.front().id)
-                    if (auto const rs = findLocal(qualId.skip(1), scopeType))
-                        return makeAvailable(scopeType), rs;
-        }
+        for (auto const* ns : entry.namespaces)
+            if (auto const rs = findLocal(qualId.skip(1), ns))
+                return rs;
+
+        if (entry.type != nullptr)
+            if (auto const rs = findLocal(qualId.skip(1), entry.type))
+                return makeAvailable(entry.type), rs;
 
         return {};
     }
 
-    Resolve Compiler::findGlobal(QualIdSpan qualId, schema::Namespace const* scope) {
+    Resolve Compiler::findLocal(QualIdSpan qualId, schema::Namespace const* scope) {
         assert(!qualId.empty());
         assert(scope != nullptr);
 
-        if (auto const rs = findLocal(qualId, scope))
-            return rs;
+        if (auto const* entry = scope->symbols.find(qualId.front().id); entry != nullptr)
+            return findLocal(qualId, *entry);
 
-        if (scope->parent != nullptr)
-            return findGlobal(qualId, scope->parent);
-        else
-            return findGlobal(qualId, scope->owner);
+        return {};
     }
 
-    Resolve Compiler::findGlobal(QualIdSpan qualId, schema::Type const* scope) {
+    Resolve Compiler::findGlobal(QualIdSpan qualId, schema::Namespace const* scope) {
         assert(!qualId.empty());
         assert(scope != nullptr);
 
-        if (auto const rs = findLocal(qualId, scope))
-            return rs;
-
-        if (scope->scope != nullptr)
-            return findGlobal(qualId, scope->scope);
+        for (;;) {
+            if (auto const rs = findLocal(qualId, scope))
+                return rs;
 
-        return {};
+            if (scope->parent == nullptr)
+                return findGlobal(qualId, scope->owner);
+            scope = scope->parent;
+        }
     }
 
     Resolve Compiler::findGlobal(QualIdSpan qualId, schema::Module const* scope) {
@@ -746,9 +1271,18 @@ namespace sapc {
         if (auto const rs = findLocal(qualId, scope->root))
             return rs;
 
-        for (auto const& imp : scope->imports)
-            if (auto const rs = findLocal(qualId, imp.mod->root))
-                return rs;
+        if (scope == state.back().mod) {
+            auto const& importedSymbols = state.back().importedSymbols;
+            if (auto const it = importedSymbols.find(qualId.front().id); it != importedSymbols.end())
+                for (auto const* entry : it->second)
+                    if (auto const rs = findLocal(qualId, *entry))
+                        return rs;
+        }
+        else {
+            for (auto const& imp : scope->imports)
+                if (auto const rs = findLocal(qualId, imp.mod->root))
+                    return rs;
+        }
 
         if (coreModule != nullptr)
             if (auto const rs = findLocal(qualId, coreModule->root))
@@ -758,18 +1292,32 @@ namespace sapc {
     }
 
     Resolve Compiler::resolve(QualIdSpan qualId, schema::Type const* scope) {
-        auto it = state.back().resolveCache.find(qualId);
-        if (it != state.back().resolveCache.end())
-            return it->second;
+        // names local to a type, such as its type parameters, shadow those of
+        // its namespace and aren't cached, as no other type shares them
+        if (scope != nullptr) {
+            if (auto const rs = findLocal(qualId, scope); rs.kind == Resolve::Kind::Type)
+                return Resolve{ makeAvailable(rs.data.type) };
+            else if (rs)
+                return rs;
+        }
 
-        Resolve rs;
-        if (scope != nullptr)
-            rs = findGlobal(qualId, scope);
-        else
-            rs = findGlobal(qualId, state.back().mod);
+        auto const* const ns = scope != nullptr ? scope->scope : state.back().mod->root;
+        if (ns == nullptr)
+            return {};
+
+        ResolveKey const key{ ns, qualId };
+        auto it = state.back().resolveCache.find(key);
+        if (it != state.back().resolveCache.end()) {
+            if (ctx.stats != nullptr)
+                ++ctx.stats->resolveHits;
+            return it->second;
+        }
+        if (ctx.stats != nullptr)
+            ++ctx.stats->resolveMisses;
 
+        auto const rs = findGlobal(qualId, ns);
         if (rs.kind != Resolve::Kind::Empty)
-            state.back().resolveCache.insert({ qualId, rs });
+            state.back().resolveCache.insert({ key, rs });
 
         if (rs.kind == Resolve::Kind::Type)
             return Resolve{ makeAvailable(rs.data.type) };
@@ -787,7 +1335,7 @@ namespace sapc {
         if (rs.kind == Resolve::Kind::Type)
             return rs.data.type;
 
-        log.error(qualId.front().loc, ": does not name a type");
+        log.error(Code::NotAType, qualId.front().loc, ": does not name a type");
         return nullptr;
     }
 
@@ -795,121 +1343,192 @@ namespace sapc {
         if (auto type = resolveType(ref, scope); type != nullptr)
             return type;
 
-        log.error(ref.loc, ref, ": type not found");
+        log.error(Code::TypeNotFound, ref.loc, ref, ": type not found");
         return nullptr;
     }
 
     schema::Type const* Compiler::createArrayType(schema::Type const* of, std::optional<long long> arraySize, Location const& loc) {
         assert(of != nullptr);
 
-        size_t arrayHash = (std::hash<std::string_view>{}(of->qualifiedName));
-        if (arraySize)
-            arrayHash = hash_combine(*arraySize, arrayHash);
+        auto& slot = ctx.derivedTypes.arrays[{ of, arraySize }];
+        if (slot != nullptr)
+            return makeAvailable(slot);
 
-        {
-            auto const it = arrayTypeMap.find(arrayHash);
-            if (it != arrayTypeMap.end())
-                return it->second;
-        }
-
-        auto& top = state.back();
+        auto* arr = ctx.derivedTypes.adopt(std::make_unique<schema::TypeIndirect>(), { of }, coreModule);
 
-        auto* arr = static_cast<schema::TypeIndirect*>(ctx.types.emplace_back(std::make_unique<schema::TypeIndirect>()).get());
-        top.mod->types.push_back(arr);
-
-        std::ostringstream arraySuffix;
-        arraySuffix << '[';
+        std::string suffix = "[";
         if (arraySize)
-            arraySuffix << *arraySize;
-        arraySuffix << ']';
+            suffix += std::to_string(*arraySize);
+        suffix += ']';
 
-        arr->name = of->name;
-        arr->name += arraySuffix.str();
-        arr->qualifiedName = of->qualifiedName;
-        arr->qualifiedName += arraySuffix.str();
+        arr->name = ctx.symbols.intern(std::string{ of->name.str() } + suffix);
+        arr->qualifiedName = ctx.symbols.intern(std::string{ of->qualifiedName.str() } + suffix);
         arr->refType = of;
         arr->arraySize = arraySize;
         arr->kind = schema::Type::Kind::Array;
         arr->scope = of->scope;
         arr->location = loc;
 
-        return arrayTypeMap.emplace(arrayHash, arr).first->second;
+        slot = arr;
+        return addDerived(arr);
     }
 
     schema::Type const* Compiler::createPointerType(schema::Type const* to, Location const& loc) {
         assert(to != nullptr);
 
-        {
-            auto const it = pointerTypeMap.find(to);
-            if (it != pointerTypeMap.end())
-                return it->second;
-        }
-
-        auto& top = state.back();
+        auto& slot = ctx.derivedTypes.pointers[to];
+        if (slot != nullptr)
+            return makeAvailable(slot);
 
-        auto* ptr = static_cast<schema::TypeIndirect*>(ctx.types.emplace_back(std::make_unique<schema::TypeIndirect>()).get());
-        top.mod->types.push_back(ptr);
+        auto* ptr = ctx.derivedTypes.adopt(std::make_unique<schema::TypeIndirect>(), { to }, coreModule);
 
-        ptr->name = to->name;
-        ptr->name += "*";
-        ptr->qualifiedName = to->qualifiedName;
-        ptr->qualifiedName += "*";
+        ptr->name = ctx.symbols.intern(std::string{ to->name.str() } + '*');
+        ptr->qualifiedName = ctx.symbols.intern(std::string{ to->qualifiedName.str() } + '*');
         ptr->refType = to;
         ptr->kind = schema::Type::Kind::Pointer;
         ptr->scope = to->scope;
         ptr->location = loc;
 
-        return pointerTypeMap.emplace(to, ptr).first->second;
+        slot = ptr;
+        return addDerived(ptr);
     }
 
-    schema::Type const* Compiler::createSpecializedType(schema::Type const* gen, std::vector<schema::Type const*> const& typeArgs, Location const& loc) {
+    schema::Type const* Compiler::createSpecializedType(schema::Type const* gen, std::vector<schema::Type const*> const& typeArgs, Location const& loc, Instantiation const* from) {
         assert(gen != nullptr);
 
-        size_t specHash = (std::hash<std::string_view>{}(gen->qualifiedName));
-        for (auto const* typeArg : typeArgs)
-            specHash = hash_combine(typeArg->qualifiedName, specHash);
+        auto& slot = ctx.derivedTypes.specialized[{ gen, typeArgs }];
+        if (slot == nullptr) {
+            std::vector<schema::Type const*> components{ gen };
+            components.insert(components.end(), typeArgs.begin(), typeArgs.end());
+            auto* spec = ctx.derivedTypes.adopt(std::make_unique<schema::TypeIndirect>(), components, coreModule);
+
+            // the arguments are separated so that distinct specializations never share a name
+            std::string genSuffix = "<";
+            for (auto const* typeArg : typeArgs) {
+                if (genSuffix.size() != 1)
+                    genSuffix += ", ";
+                genSuffix += typeArg->qualifiedName.str();
+            }
+            genSuffix += '>';
+
+            spec->name = ctx.symbols.intern(std::string{ gen->name.str() } + genSuffix);
+            spec->qualifiedName = ctx.symbols.intern(std::string{ gen->qualifiedName.str() } + genSuffix);
+            spec->refType = gen;
+            spec->kind = schema::Type::Kind::Specialized;
+            spec->scope = gen->scope;
+            spec->location = loc;
+            spec->typeArgs = typeArgs;
+
+            slot = spec;
+            addDerived(spec);
+        }
 
-        {
-            auto const it = specializedTypeMap.find(specHash);
-            if (it != specializedTypeMap.end())
-                return it->second;
+        // specializations are created once per context, but instantiated on
+        // first use with instantiate set; those given the type parameters of
+        // another generic are only instantiated through that generic's uses
+        if (ctx.instantiate && ctx.derivedTypes.instantiated.count(slot) == 0 && !dependent(slot)) {
+            auto const depth = from != nullptr ? from->depth + 1 : 0;
+            if (depth <= ctx.maxInstantiationDepth)
+                pending.push_back({ slot, depth, from != nullptr ? from->origin : loc });
+            else {
+                log.error(Code::InstantiationDepth, loc, slot->qualifiedName, ": specializations are instantiated more than ", ctx.maxInstantiationDepth, " levels deep");
+                log.info(Code::InstantiatedFrom, from->origin, "instantiated from here");
+            }
         }
 
-        auto& top = state.back();
+        return makeAvailable(slot);
+    }
+
+    void Compiler::instantiate(Instantiation const& inst) {
+        auto& spec = *inst.spec;
+        if (!ctx.derivedTypes.instantiated.insert(&spec).second)
+            return;
+
+        // other kinds of types given type arguments are reported by validation
+        auto const kind = spec.refType->kind;
+        if (kind != schema::Type::Kind::Struct && kind != schema::Type::Kind::Union)
+            return;
 
-        auto* spec = static_cast<schema::TypeIndirect*>(ctx.types.emplace_back(std::make_unique<schema::TypeIndirect>()).get());
-        top.mod->types.push_back(spec);
+        auto const& generic = static_cast<schema::TypeAggregate const&>(*spec.refType);
+        spec.fields.reserve(generic.fields.size());
+        for (auto const* field : generic.fields) {
+            auto* const instance = spec.fields.emplace_back(ctx.derivedTypes.adopt(spec, std::make_unique<schema::Field>(*field)));
+            instance->type = substitute(field->type, inst, field->location);
+        }
+    }
 
-        std::string genSuffix = "<";
-        for (auto const* typeArg : typeArgs)
-            genSuffix += typeArg->qualifiedName;
-        genSuffix += '>';
+    schema::Type const* Compiler::substitute(schema::Type const* type, Instantiation const& inst, Location const& loc) {
+        if (type == nullptr)
+            return nullptr;
 
-        spec->name = gen->name;
-        spec->name += genSuffix;
-        spec->qualifiedName = gen->qualifiedName;
-        spec->qualifiedName += genSuffix;
-        spec->refType = gen;
-        spec->kind = schema::Type::Kind::Specialized;
-        spec->scope = gen->scope;
-        spec->location = loc;
+        auto const& spec = *inst.spec;
+        switch (type->kind) {
+        case schema::Type::Kind::TypeParam: {
+            auto const& params = static_cast<schema::TypeAggregate const&>(*spec.refType).typeParams;
+            for (size_t index = 0; index != params.size() && index != spec.typeArgs.size(); ++index)
+                if (params[index] == type)
+                    return spec.typeArgs[index];
+            return type;
+        }
+        case schema::Type::Kind::Array:
+        case schema::Type::Kind::Pointer: {
+            auto const& typeInd = static_cast<schema::TypeIndirect const&>(*type);
+            auto const* const refType = substitute(typeInd.refType, inst, loc);
+            if (refType == typeInd.refType)
+                return type;
+            return type->kind == schema::Type::Kind::Array ? createArrayType(refType, typeInd.arraySize, loc) : createPointerType(refType, loc);
+        }
+        case schema::Type::Kind::Specialized: {
+            auto const& typeInd = static_cast<schema::TypeIndirect const&>(*type);
+            std::vector<schema::Type const*> typeArgs;
+            typeArgs.reserve(typeInd.typeArgs.size());
+            for (auto const* typeArg : typeInd.typeArgs)
+                typeArgs.push_back(substitute(typeArg, inst, loc));
+            if (typeArgs == typeInd.typeArgs)
+                return type;
+            return createSpecializedType(typeInd.refType, typeArgs, loc, &inst);
+        }
+        default:
+            return type;
+        }
+    }
 
-        spec->typeArgs.reserve(typeArgs.size());
-        for (auto const* typeArg : typeArgs)
-            spec->typeArgs.push_back(typeArg);
+    bool Compiler::dependent(schema::Type const* type) noexcept {
+        if (type == nullptr)
+            return false;
+
+        switch (type->kind) {
+        case schema::Type::Kind::TypeParam:
+            return true;
+        case schema::Type::Kind::Array:
+        case schema::Type::Kind::Pointer:
+            return dependent(static_cast<schema::TypeIndirect const*>(type)->refType);
+        case schema::Type::Kind::Specialized:
+            for (auto const* typeArg : static_cast<schema::TypeIndirect const*>(type)->typeArgs)
+                if (dependent(typeArg))
+                    return true;
+            return false;
+        default:
+            return false;
+        }
+    }
 
-        return specializedTypeMap.emplace(specHash, spec).first->second;
+    schema::Type const* Compiler::addDerived(schema::Type const* type) {
+        // a type derived from an import is listed by every module that uses it, like the import itself
+        if (type->scope->owner == state.back().mod)
+            state.back().mod->types.push_back(type);
+        return makeAvailable(type);
     }
 
-    schema::Value Compiler::translate(ast::Literal const& lit) {
+    schema::Value Compiler::translate(ast::Literal& lit) {
         schema::Value value;
         value.location = lit.loc;
-        std::visit([&value, &lit, this](auto const& val) {
+        std::visit([&value, &lit, this](auto& val) {
             using T = std::remove_cv_t<std::remove_reference_t<decltype(val)>>;
             if constexpr (std::is_same_v<T, ast::QualifiedId>) {
                 auto const rs = resolve(val);
                 if (rs.kind == Resolve::Kind::Empty)
-                    log.error(lit.loc, val, ": not found");
+                    log.error(Code::NameNotFound, lit.loc, val, ": not found");
                 else if (rs.kind == Resolve::Kind::Type)
                     value.data = rs.data.type;
                 else if (rs.kind == Resolve::Kind::EnumItem)
@@ -917,47 +1536,48 @@ namespace sapc {
                 else if (rs.kind == Resolve::Kind::Constant)
                     value = rs.data.constant->value;
                 else if (rs.kind == Resolve::Kind::Namespace) {
-                    log.error(lit.loc, val, ": names a namespace, must name a type, constant, or enumeration");
-                    log.info(rs.data.ns->location, rs.data.ns->name, ": namespace declared here");
+                    log.error(Code::NamespaceValue, lit.loc, val, ": names a namespace, must name a type, constant, or enumeration");
+                    log.info(Code::DeclaredHere, rs.data.ns->location, rs.data.ns->name, ": namespace declared here");
                 }
                 else
                     assert(false && "Unknown resolve result");
             }
             else if constexpr (std::is_same_v<T, std::vector<ast::Literal>>) {
                 auto arr = std::vector<schema::Value>();
-                for (auto const& elem : val)
+                arr.reserve(val.size());
+                for (auto& elem : val)
                     arr.push_back(translate(elem));
                 value.data = std::move(arr);
             }
             else {
-                value.data = val;
+                value.data = std::move(val);
             }
             }, lit.data);
         return value;
     }
 
-    std::unique_ptr<schema::Annotation> Compiler::translate(ast::Annotation const& anno) {
-        auto result = std::make_unique<schema::Annotation>();
+    schema::Annotation* Compiler::translate(ast::Annotation& anno) {
+        auto* const result = state.back().arena->create<schema::Annotation>();
 
         result->type = requireType(anno.name);
         result->location = anno.name.components.front().loc;
         result->location.merge(anno.name.components.back().loc);
 
         if (result->type == nullptr) {
-            log.error(result->location, anno.name, ": attribute not found");
+            log.error(Code::AttributeNotFound, result->location, anno.name, ": attribute not found");
             return result;
         }
         if (result->type->kind != schema::Type::Kind::Attribute) {
-            log.error(result->location, anno.name, ": annotation type is not an attribute");
-            log.info(result->type->location, result->type->name, ": type declared here");
+            log.error(Code::NotAnAttribute, result->location, anno.name, ": annotation type is not an attribute");
+            log.info(Code::DeclaredHere, result->type->location, result->type->name, ": type declared here");
             return result;
         }
 
         auto const& attrType = static_cast<schema::TypeAggregate const&>(*result->type);
 
         if (anno.args.size() > attrType.fields.size()) {
-            log.error(result->location, "too many arguments for attribute ", attrType.name, "; got ", anno.args.size(), ", expected ", attrType.fields.size());
-            log.info(attrType.location, attrType.name, ": attribute declared here");
+            log.error(Code::TooManyArguments, result->location, "too many arguments for attribute ", attrType.name, "; got ", anno.args.size(), ", expected ", attrType.fields.size());
+            log.info(Code::DeclaredHere, attrType.location, attrType.name, ": attribute declared here");
             return result;
         }
 
@@ -967,7 +1587,7 @@ namespace sapc {
             else if (attrType.fields[index]->defaultValue)
                 result->args.push_back(*attrType.fields[index]->defaultValue);
             else {
-                log.error(result->location, "missing parameter ", attrType.fields[index]->name);
+                log.error(Code::MissingArgument, result->location, "missing parameter ", attrType.fields[index]->name);
                 result->args.emplace_back();
             }
         }
@@ -976,12 +1596,12 @@ namespace sapc {
         return result;
     }
 
-    void Compiler::translate(std::vector<std::unique_ptr<schema::Annotation>>& target, std::vector<ast::Annotation> const& annotations) {
-        for (auto const& anno : annotations)
+    void Compiler::translate(std::vector<schema::Annotation*>& target, std::vector<ast::Annotation>& annotations) {
+        for (auto& anno : annotations)
             target.push_back(translate(anno));
     }
 
-    std::string Compiler::qualify(std::string_view name) const {
+    Symbol Compiler::qualify(Symbol name) const {
         assert(!state.empty());
         assert(!state.back().nsStack.empty());
 
@@ -989,57 +1609,65 @@ namespace sapc {
         assert(scope != nullptr);
 
         if (scope->name.empty())
-            return std::string{ name };
+            return name;
 
-        std::string qualified = scope->qualifiedName;
-        qualified += '.';
-        qualified += name;
-        return qualified;
+        return qualify(scope->qualifiedName, name);
     }
 
-    ast::ModuleUnit const* Compiler::parseModule(ast::Identifier const& id, fs::path const& requestingFile) {
-        auto const parent = requestingFile.parent_path();
-        auto const basename = fs::path{ id.id }.replace_extension(".sap");
-        auto const filename = resolveFile(basename, parent, ctx.searchPaths);
-        if (filename.empty()) {
-            log.error(id.loc, id.id, ": module not found");
-            return nullptr;
-        }
-
-        return parseModule(filename);
+    Symbol Compiler::qualify(Symbol scope, Symbol name) const {
+        std::string qualified;
+        qualified.reserve(scope.size() + 1 + name.size());
+        qualified += scope.str();
+        qualified += '.';
+        qualified += name.str();
+        return ctx.symbols.intern(qualified);
     }
 
-    ast::ModuleUnit const* Compiler::parseModule(fs::path const& filename) {
-        if (auto it = ctx.astMap.find(filename); it != ctx.astMap.end())
-            return it->second;
-
-        auto moduleAst = parse(filename, [this](auto const& id, auto const& requestingFile) {
-            return this->parseModule(id, requestingFile);
-            }, log);
-        auto const* const mod = moduleAst.get();
-
-        ctx.astMap.insert({ filename, mod });
-
-        if (mod == nullptr)
-            return nullptr;
-
-        ctx.asts.push_back(std::move(moduleAst));
+    ImportIndex::Resolution Compiler::resolveImport(std::string_view moduleName, fs::path const& importer) const {
+        if (ctx.resolver)
+            return { ctx.resolver(moduleName, importer) };
+        return ctx.imports.resolve(moduleName, importer, ctx.stats);
+    }
 
-        return mod;
+    // warns about search paths that can't affect where imports resolve
+    void Compiler::checkSearchPaths() {
+        Location const target{ ctx.files.intern(ctx.targetFile) };
+
+        std::unordered_set<fs::path, PathHash> seen;
+        for (auto const& path : ctx.searchPaths) {
+            std::error_code ec;
+            if (!fs::is_directory(path, ec))
+                log.warn(Code::SearchPathNotDirectory, target, "search path `", path.string(), "' is not a directory");
+            else if (!seen.insert(fs::absolute(path / "", ec).lexically_normal()).second)
+                log.warn(Code::SearchPathRepeated, target, "search path `", path.string(), "' is listed more than once");
+        }
     }
 
-    void Compiler::applyCustomTag(schema::Annotated& annotated, std::string_view tag) {
-        auto it = customTagMap.find(tag);
-        assert(it != customTagMap.end());
+    void Compiler::applyCustomTag(schema::Annotated& annotated, std::string tag) {
+        auto const& customTags = state.back().customTags;
+        auto it = customTags.find(tag);
+        assert(it != customTags.end());
 
-        translate(annotated.annotations, it->second->annotations);
+        // the tag's annotations are shared by every use, so each gets a copy to consume
+        auto& annotations = state.back().tagAnnotations.emplace_back(it->second->annotations);
+        translate(annotated.annotations, annotations);
 
-        auto& tagAnno = *annotated.annotations.emplace_back(std::make_unique<schema::Annotation>());
+        auto& tagAnno = *annotated.annotations.emplace_back(state.back().arena->create<schema::Annotation>());
         tagAnno.type = makeAvailable(customTagAttr);
-        tagAnno.location = { std::filesystem::absolute(__FILE__), {__LINE__ } };
+        tagAnno.location = builtinLocation(__LINE__);
 
         auto& tagValue = tagAnno.args.emplace_back();
-        tagValue.data = std::string(tag);
-        tagValue.location = { std::filesystem::absolute(__FILE__), {__LINE__ } };
+        tagValue.data = std::move(tag);
+        tagValue.location = builtinLocation(__LINE__);
+    }
+
+    schema::SymbolTable const* Compiler::symbolsOf(schema::Type const* type) noexcept {
+        if (type == nullptr)
+            return nullptr;
+        if (type->kind == schema::Type::Kind::Enum)
+            return &static_cast<schema::TypeEnum const*>(type)->symbols;
+        if (type->kind == schema::Type::Kind::Struct)
+            return &static_cast<schema::TypeAggregate const*>(type)->symbols;
+        return nullptr;
     }
 }
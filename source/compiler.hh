@@ -13,4 +13,12 @@ namespace sapc {
     struct Context;
 
     bool compile(Context& ctx, Log& log);
+
+    // Discards cached modules whose files changed since they were loaded,
+    // along with every module importing them; returns the number discarded
+    size_t invalidateModified(Context& ctx);
+
+    // Discards the cached modules of the given files and of every module
+    // importing them; returns the number discarded
+    size_t invalidate(Context& ctx, std::vector<std::filesystem::path> stale);
 }
@@ -4,9 +4,17 @@
 
 #pragma once
 
+#include "arena.hh"
 #include "file_util.hh"
+#include "import_index.hh"
+#include "sapc/location.hh"
+#include "symbol_pool.hh"
+#include "type_cache.hh"
 
+#include <functional>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -22,20 +30,69 @@ namespace sapc {
         struct Type;
     }
 
+    struct Stats;
+
     struct Context {
         std::filesystem::path targetFile;
         std::vector<std::filesystem::path> searchPaths;
         std::vector<std::filesystem::path> dependencies;
+        unsigned jobs = 0; // worker threads; 0 uses the hardware concurrency
+        Stats* stats = nullptr; // collects timings and counters when set
+
+        // Specialized types are instantiated, listing the fields of their
+        // generic with the type arguments substituted; those fields may need
+        // further specializations, which are instantiated up to the depth
+        bool instantiate = false;
+        unsigned maxInstantiationDepth = 64;
+
+        // Locates the file of an imported module, or returns an empty path; when
+        // not set, the importer's directory and then the search paths are probed.
+        // May be called from loader threads when more than one job is used.
+        std::function<std::filesystem::path(std::string_view moduleName, std::filesystem::path const& importer)> resolver;
+
+        // listings of the directories searched for imports, used when there is no resolver
+        ImportIndex imports;
+
+        // contents of files supplied from memory, which are never read from disk
+        std::unordered_map<std::filesystem::path, std::string, PathHash> sources;
+
+        FileTable files;
 
-        std::vector<std::unique_ptr<ast::ModuleUnit>> asts;
-        std::vector<std::unique_ptr<schema::Module>> modules;
-        std::vector<std::unique_ptr<schema::Type>> types;
-        std::vector<std::unique_ptr<schema::Constant>> constants;
-        std::vector<std::unique_ptr<schema::Namespace>> namespaces;
+        // the names of every module, released with the context
+        SymbolPool symbols;
 
-        std::unordered_map<std::filesystem::path, ast::ModuleUnit const*, PathHash> astMap;
+        // the schema nodes of the core module, which lives as long as the context
+        Arena arena;
+
+        // the schema nodes of every module built, whether it compiled cleanly
+        // or not, which are freed when the module is invalidated
+        struct BuiltModule {
+            schema::Module* mod = nullptr;
+            std::unique_ptr<Arena> arena;
+        };
+        std::unordered_map<std::filesystem::path, BuiltModule, PathHash> builtModules;
+
+        // the syntax tree of each file parsed, or null if it failed to parse;
+        // once its module is compiled, only its imports and custom tags are kept
+        std::unordered_map<std::filesystem::path, std::unique_ptr<ast::ModuleUnit>, PathHash> astMap;
         std::unordered_map<std::filesystem::path, schema::Module const*, PathHash> moduleMap;
 
+        // arrays, pointers, and specializations shared by every module, and
+        // freed along with any module they are built from
+        TypeCache derivedTypes;
+        bool modulesInstantiated = false; // the modules kept were compiled with instantiate set
+
+        // an import as declared, and the file it resolved to
+        struct ImportedFile {
+            Symbol name;
+            std::filesystem::path filename;
+        };
+
+        // used to find stale modules when a context is reused
+        std::unordered_map<std::filesystem::path, std::filesystem::file_time_type, PathHash> timestamps;
+        std::unordered_map<std::filesystem::path, std::vector<ImportedFile>, PathHash> importGraph;
+
+        schema::Module const* coreModule = nullptr;
         schema::Module const* rootModule = nullptr;
     };
 }
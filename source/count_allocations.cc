@@ -0,0 +1,20 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "stats.hh"
+
+#include <cstdlib>
+#include <new>
+
+// Replaced in the executables only, so that --stats can report how often
+// each phase allocates without the library taking over a host's allocator
+void* operator new(std::size_t size) {
+    sapc::Stats::countAllocation(size);
+    if (void* const ptr = std::malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
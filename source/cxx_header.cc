@@ -0,0 +1,246 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "cxx_header.hh"
+#include "cxx_names.hh"
+#include "sapc/schema.hh"
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sapc {
+    using namespace std::literals;
+    using namespace sapc::cxx;
+
+    namespace {
+        struct HeaderWriter {
+            std::ostream& os;
+            schema::Module const& mod;
+            FileTable const& files;
+            std::optional<std::string> currentNamespace;
+
+            void write();
+            void banner(std::string_view text);
+            void enterNamespace(std::optional<std::string> const& ns);
+            void location(Location const& loc);
+            void annotations(std::string_view prefix, std::vector<schema::Annotation*> const& annotations);
+            void annotationGetter(schema::Type const& type);
+            void write(schema::Type const& type);
+            void write(schema::Constant const& constant);
+
+            bool exported(schema::Namespace const* scope) const { return scope->owner == &mod; }
+        };
+    }
+
+    void generateCxxHeader(std::ostream& os, schema::Module const& mod, FileTable const& files) {
+        HeaderWriter{ os, mod, files }.write();
+    }
+
+    void HeaderWriter::banner(std::string_view text) {
+        std::string const rule(text.size() + 4, '-');
+        os << "// " << rule << "\n//  " << text << "\n// " << rule << "\n\n";
+    }
+
+    void HeaderWriter::enterNamespace(std::optional<std::string> const& ns) {
+        if (currentNamespace == ns)
+            return;
+
+        if (currentNamespace)
+            os << "} // namespace " << *currentNamespace << "\n\n\n";
+        currentNamespace = ns;
+        if (currentNamespace)
+            os << "namespace " << *currentNamespace << " {\n";
+    }
+
+    void HeaderWriter::location(Location const& loc) {
+        auto const start = files.position(loc.file, loc.start);
+
+        os << "  // " << files.path(loc.file).string();
+        if (start.line > 0 && start.column != 0)
+            os << '(' << start.line << ',' << start.column << ')';
+        else if (start.line > 0)
+            os << '(' << start.line << ')';
+        os << '\n';
+    }
+
+    void HeaderWriter::annotations(std::string_view prefix, std::vector<schema::Annotation*> const& annotations) {
+        for (auto const* annotation : annotations) {
+            auto const& attribute = static_cast<schema::TypeAggregate const&>(*annotation->type);
+
+            os << prefix << "// annotation: " << attribute.qualifiedName << '(';
+            for (size_t index = 0; index != annotation->args.size(); ++index) {
+                if (index != 0)
+                    os << ',';
+                if (index < attribute.fields.size())
+                    os << attribute.fields[index]->name;
+                os << ':';
+                encode(os, annotation->args[index]);
+            }
+            os << ")\n";
+        }
+    }
+
+    void HeaderWriter::annotationGetter(schema::Type const& type) {
+        os << "    template <int N>\n";
+        os << "    static decltype(auto) get_annotation() {\n";
+        for (size_t index = 0; index != type.annotations.size(); ++index) {
+            auto const& annotation = *type.annotations[index];
+            auto const& attribute = static_cast<schema::TypeAggregate const&>(*annotation.type);
+            if (attribute.name == "$customtag"sv)
+                continue;
+
+            os << "      if constexpr(N == " << index << ") {\n";
+            os << "        static auto const anno = " << qualified(attribute) << "{\n";
+            for (size_t arg = 0; arg != annotation.args.size(); ++arg) {
+                os << "          ";
+                encode(os, annotation.args[arg]);
+                os << ", // ";
+                if (arg < attribute.fields.size())
+                    os << attribute.fields[arg]->name;
+                os << '\n';
+            }
+            os << "          };\n";
+            os << "          return anno;\n";
+            os << "      }\n";
+        }
+        os << "    }\n";
+    }
+
+    void HeaderWriter::write() {
+        auto const guard = includeGuard(mod.name.str());
+
+        banner("Generated file ** DO NOT EDIT **");
+
+        os << "// from: " << mod.filename.filename().string() << '\n';
+        os << "// with: sapc\n";
+
+        os << "\n#if !defined(" << guard << ")\n";
+        os << "#define " << guard << " 1\n";
+        os << "#pragma once\n";
+        os << "#include <any>\n";
+        os << "#include <array>\n";
+        os << "#include <memory>\n";
+        os << "#include <string>\n";
+        os << "#include <typeindex>\n";
+        os << "#include <vector>\n";
+        os << '\n';
+
+        banner("Module - "s + std::string{ mod.name.str() });
+        annotations(""sv, mod.annotations);
+        os << '\n';
+
+        banner("Imports");
+        for (auto const& imp : mod.imports)
+            os << "#include \"" << imp.mod->name << ".h\"\n";
+        os << '\n';
+
+        banner("Types");
+        for (auto const* type : mod.types)
+            write(*type);
+        enterNamespace(std::nullopt);
+
+        banner("Constants");
+        for (auto const* constant : mod.constants)
+            write(*constant);
+        enterNamespace(std::nullopt);
+
+        os << "#endif";
+    }
+
+    void HeaderWriter::write(schema::Type const& type) {
+        using Kind = schema::Type::Kind;
+
+        if (!exported(type.scope) || ignored(type.annotations))
+            return;
+
+        auto const ns = cxxNamespace(type.name, type.scope, type.annotations, &type.kind);
+        auto const name = cxxName(type.name, type.annotations);
+
+        auto const header = [&] {
+            enterNamespace(ns);
+            location(type.location);
+            annotations("  "sv, type.annotations);
+        };
+
+        if (type.kind == Kind::Enum) {
+            auto const& typeEnum = static_cast<schema::TypeEnum const&>(type);
+
+            header();
+            os << "  enum class " << name;
+            if (typeEnum.baseType != nullptr)
+                os << " : " << fieldType(*typeEnum.baseType);
+            os << " {\n";
+            for (auto const* item : typeEnum.items)
+                os << "    " << identifier(item->name.str()) << " = " << item->value << ",\n";
+            os << "  };\n\n";
+        }
+        else if (type.kind == Kind::Alias) {
+            auto const& typeInd = static_cast<schema::TypeIndirect const&>(type);
+            if (typeInd.refType == nullptr)
+                return;
+
+            header();
+            os << "  using " << name << " = " << fieldType(*typeInd.refType) << ";\n\n";
+        }
+        else if (type.kind == Kind::Struct || type.kind == Kind::Union || type.kind == Kind::Attribute) {
+            auto const& typeAggr = static_cast<schema::TypeAggregate const&>(type);
+            bool const isUnion = type.kind == Kind::Union;
+
+            header();
+
+            if (!typeAggr.typeParams.empty()) {
+                os << "  template <";
+                for (size_t index = 0; index != typeAggr.typeParams.size(); ++index)
+                    os << (index != 0 ? ", typename " : "typename ") << typeAggr.typeParams[index]->name;
+                os << ">\n";
+            }
+
+            os << (isUnion ? "  union " : "  struct ") << name;
+            if (typeAggr.baseType != nullptr)
+                os << " : " << qualified(*typeAggr.baseType);
+            os << " {\n";
+
+            if (!isUnion)
+                annotationGetter(type);
+
+            for (auto const* field : typeAggr.fields) {
+                if (ignored(field->annotations))
+                    continue;
+
+                annotations("    "sv, field->annotations);
+
+                // union members aren't declared, as they may not be trivial types
+                if (isUnion)
+                    continue;
+
+                os << "    " << fieldType(*field->type) << ' ' << cxxName(field->name, field->annotations);
+                if (field->defaultValue) {
+                    os << " = ";
+                    encode(os, *field->defaultValue);
+                }
+                os << ";\n";
+            }
+
+            os << "  };\n\n";
+        }
+    }
+
+    void HeaderWriter::write(schema::Constant const& constant) {
+        if (!exported(constant.scope) || ignored(constant.annotations))
+            return;
+
+        enterNamespace(cxxNamespace(constant.name, constant.scope, constant.annotations, nullptr));
+        location(constant.location);
+
+        auto const* const tag = stringArg(constant.annotations, "$customtag"sv);
+        bool const isConstexpr = tag != nullptr && *tag == "constexpr"sv;
+
+        os << "  static " << (isConstexpr ? "constexpr " : "const ") << fieldType(*constant.type) << ' ' << cxxName(constant.name, constant.annotations) << " = ";
+        encode(os, constant.value);
+        os << ";\n\n";
+    }
+}
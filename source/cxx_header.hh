@@ -0,0 +1,16 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "sapc/location.hh"
+#include "sapc/schema.hh"
+
+#include <iosfwd>
+
+namespace sapc {
+    // writes a C++ header declaring the module's types and constants; the
+    // cxxname, cxxnamespace, and ignore attributes customize the output
+    void generateCxxHeader(std::ostream& os, schema::Module const& mod, FileTable const& files);
+}
@@ -0,0 +1,230 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "cxx_names.hh"
+#include "sapc/schema.hh"
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace sapc::cxx {
+    using namespace std::literals;
+
+    namespace {
+        constexpr std::string_view cxxKeywords[] = {
+            "void"sv, "nullptr"sv,
+            "char"sv, "int"sv, "short"sv, "long"sv, "signed"sv, "unsigned"sv, "bool"sv,
+            "float"sv, "double"sv,
+            "if"sv, "do"sv, "while"sv, "switch"sv, "case"sv, "for"sv,
+            "struct"sv, "class"sv, "using"sv, "template"sv, "typename"sv, "typedef"sv, "const"sv,
+            "default"sv, "auto"sv, "namespace"sv, "sizeof"sv, "alignof"sv, "constexpr"sv, "constinit"sv, "consteval"sv,
+        };
+
+        struct BuiltinType {
+            std::string_view name;
+            std::string_view cxxName;
+        };
+
+        constexpr BuiltinType builtinTypes[] = {
+            { "string"sv, "std::string"sv },
+            { "bool"sv, "bool"sv },
+            { "byte"sv, "unsigned char"sv },
+            { "int"sv, "int"sv },
+            { "float"sv, "float"sv },
+        };
+
+        std::optional<std::string_view> builtinName(std::string_view name) {
+            for (auto const& builtin : builtinTypes)
+                if (builtin.name == name)
+                    return builtin.cxxName;
+            return std::nullopt;
+        }
+
+        bool truthy(schema::Value const& value) {
+            return std::visit([](auto const& val) -> bool {
+                using T = std::remove_cv_t<std::remove_reference_t<decltype(val)>>;
+                if constexpr (std::is_same_v<T, std::nullptr_t>)
+                    return false;
+                else if constexpr (std::is_same_v<T, bool>)
+                    return val;
+                else if constexpr (std::is_same_v<T, long long>)
+                    return val != 0;
+                else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::vector<schema::Value>>)
+                    return !val.empty();
+                else
+                    return val != nullptr;
+                }, value.data);
+        }
+    }
+
+    std::string identifier(std::string_view name) {
+        std::string id;
+        id.reserve(name.size() + 1);
+        for (char const ch : name) {
+            bool const legal = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_';
+            id.push_back(legal ? ch : '_');
+        }
+
+        if (id.empty() || (id.front() >= '0' && id.front() <= '9'))
+            id.push_back('_');
+        for (auto const keyword : cxxKeywords)
+            if (id == keyword)
+                id.push_back('_');
+        return id;
+    }
+
+    schema::Annotation const* findAnnotation(std::vector<schema::Annotation*> const& annotations, std::string_view type) {
+        for (auto const* annotation : annotations)
+            if (annotation->type->qualifiedName == type)
+                return annotation;
+        return nullptr;
+    }
+
+    schema::Value const* annotationArg(std::vector<schema::Annotation*> const& annotations, std::string_view type, size_t index) {
+        auto const* const annotation = findAnnotation(annotations, type);
+        return annotation != nullptr && index < annotation->args.size() ? &annotation->args[index] : nullptr;
+    }
+
+    std::string const* stringArg(std::vector<schema::Annotation*> const& annotations, std::string_view type) {
+        auto const* const value = annotationArg(annotations, type);
+        return value != nullptr ? std::get_if<std::string>(&value->data) : nullptr;
+    }
+
+    bool ignored(std::vector<schema::Annotation*> const& annotations) {
+        auto const* const value = annotationArg(annotations, "ignore"sv);
+        return value != nullptr && truthy(*value);
+    }
+
+    std::string cxxName(Symbol name, std::vector<schema::Annotation*> const& annotations) {
+        if (auto const* const custom = stringArg(annotations, "cxxname"sv))
+            return *custom;
+        if (auto const builtin = builtinName(name.str()))
+            return std::string{ *builtin };
+        return identifier(name.str());
+    }
+
+    std::optional<std::string> cxxNamespace(Symbol name, schema::Namespace const* scope, std::vector<schema::Annotation*> const& annotations, schema::Type::Kind const* kind) {
+        if (auto const* const custom = stringArg(annotations, "cxxnamespace"sv))
+            return *custom;
+        if (kind != nullptr && *kind == schema::Type::Kind::TypeParam)
+            return std::nullopt;
+        if (builtinName(name.str()))
+            return std::nullopt;
+        if (annotationArg(annotations, "cxxname"sv) != nullptr)
+            return std::nullopt;
+
+        if (scope != nullptr && !scope->name.empty()) {
+            std::string ns = "st";
+            std::string_view remaining = scope->qualifiedName.str();
+            while (!remaining.empty()) {
+                auto const dot = remaining.find('.');
+                ns += "::";
+                ns += identifier(remaining.substr(0, dot));
+                remaining = dot == std::string_view::npos ? std::string_view{} : remaining.substr(dot + 1);
+            }
+            return ns;
+        }
+
+        if (kind != nullptr && *kind == schema::Type::Kind::Attribute)
+            return "st_attr"s;
+        return "st"s;
+    }
+
+    std::string qualified(schema::Type const& type) {
+        auto const ns = cxxNamespace(type.name, type.scope, type.annotations, &type.kind);
+        auto name = cxxName(type.name, type.annotations);
+        return ns ? *ns + "::" + name : name;
+    }
+
+    std::string fieldType(schema::Type const& type) {
+        using Kind = schema::Type::Kind;
+
+        if (type.kind == Kind::TypeId)
+            return "std::type_index";
+
+        if (type.kind == Kind::Array) {
+            auto const& typeInd = static_cast<schema::TypeIndirect const&>(type);
+            auto const elemType = fieldType(*typeInd.refType);
+            if (typeInd.arraySize)
+                return "std::array<" + elemType + ", " + std::to_string(*typeInd.arraySize) + ">";
+            return "std::vector<" + elemType + ">";
+        }
+
+        if (type.kind == Kind::Pointer) {
+            auto const& typeInd = static_cast<schema::TypeIndirect const&>(type);
+            return "std::unique_ptr<" + fieldType(*typeInd.refType) + ">";
+        }
+
+        if (type.kind == Kind::Specialized) {
+            auto const& typeInd = static_cast<schema::TypeIndirect const&>(type);
+            auto result = fieldType(*typeInd.refType) + "<";
+            for (size_t index = 0; index != typeInd.typeArgs.size(); ++index) {
+                if (index != 0)
+                    result += ", ";
+                result += fieldType(*typeInd.typeArgs[index]);
+            }
+            return result + ">";
+        }
+
+        return qualified(type);
+    }
+
+    std::string includeGuard(std::string_view moduleName, std::string_view suffix) {
+        auto guard = "INCLUDE_GUARD_SAPC_"s;
+        if (!suffix.empty()) {
+            guard += suffix;
+            guard += '_';
+        }
+        for (char const ch : identifier(moduleName))
+            guard.push_back(ch >= 'a' && ch <= 'z' ? static_cast<char>(ch - 'a' + 'A') : ch);
+        return guard;
+    }
+
+    void encodeString(std::ostream& os, std::string_view text) {
+        os << '"';
+        for (char const ch : text) {
+            switch (ch) {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\r': os << "\\r"; break;
+            case '\t': os << "\\t"; break;
+            default: os << ch; break;
+            }
+        }
+        os << '"';
+    }
+
+    void encode(std::ostream& os, schema::Value const& value) {
+        std::visit([&os](auto const& val) {
+            using T = std::remove_cv_t<std::remove_reference_t<decltype(val)>>;
+            if constexpr (std::is_same_v<T, std::nullptr_t>)
+                os << "nullptr";
+            else if constexpr (std::is_same_v<T, bool>)
+                os << (val ? "true" : "false");
+            else if constexpr (std::is_same_v<T, long long>)
+                os << val;
+            else if constexpr (std::is_same_v<T, std::string>)
+                encodeString(os, val);
+            else if constexpr (std::is_same_v<T, schema::Type const*>)
+                os << "typeid(" << identifier(val->qualifiedName.str()) << ')';
+            else if constexpr (std::is_same_v<T, schema::EnumItem const*>)
+                os << identifier(val->parent->name.str()) << "::" << identifier(val->name.str());
+            else if constexpr (std::is_same_v<T, std::vector<schema::Value>>) {
+                os << '{';
+                for (size_t index = 0; index != val.size(); ++index) {
+                    if (index != 0)
+                        os << ',';
+                    encode(os, val[index]);
+                }
+                os << '}';
+            }
+            }, value.data);
+    }
+}
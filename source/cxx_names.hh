@@ -0,0 +1,49 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "sapc/schema.hh"
+
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Naming and encoding rules shared by the C++ backends, so that generated
+// code always agrees on how a schema declaration is spelled in C++
+namespace sapc::cxx {
+    // sanitizes a name into a legal C++ identifier
+    std::string identifier(std::string_view name);
+
+    // the named attribute and its arguments, if the attribute is applied
+    schema::Annotation const* findAnnotation(std::vector<schema::Annotation*> const& annotations, std::string_view type);
+    schema::Value const* annotationArg(std::vector<schema::Annotation*> const& annotations, std::string_view type, size_t index = 0);
+    std::string const* stringArg(std::vector<schema::Annotation*> const& annotations, std::string_view type);
+
+    // true if the ignore attribute excludes the declaration from generated code
+    bool ignored(std::vector<schema::Annotation*> const& annotations);
+
+    // the C++ name of a declaration, honoring the cxxname attribute
+    std::string cxxName(Symbol name, std::vector<schema::Annotation*> const& annotations);
+
+    // the C++ namespace that a type or constant is declared in, honoring the
+    // cxxnamespace attribute; kind is null for constants
+    std::optional<std::string> cxxNamespace(Symbol name, schema::Namespace const* scope, std::vector<schema::Annotation*> const& annotations, schema::Type::Kind const* kind);
+
+    // fully qualified C++ name of a declared type
+    std::string qualified(schema::Type const& type);
+
+    // the C++ type used for a field or constant of the given type
+    std::string fieldType(schema::Type const& type);
+
+    // the include guard macro for a generated header
+    std::string includeGuard(std::string_view moduleName, std::string_view suffix = {});
+
+    void encodeString(std::ostream& os, std::string_view text);
+
+    // writes a value as a C++ initializer
+    void encode(std::ostream& os, schema::Value const& value);
+}
@@ -0,0 +1,335 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "cxx_reflect.hh"
+#include "cxx_names.hh"
+#include "sapc/schema.hh"
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace sapc {
+    using namespace std::literals;
+    using namespace sapc::cxx;
+
+    namespace {
+        // Declarations shared by every generated reflection header; the guard
+        // lets headers of several modules be included together
+        constexpr std::string_view commonDeclarations = R"(#if !defined(INCLUDE_GUARD_SAPC_REFLECT)
+#define INCLUDE_GUARD_SAPC_REFLECT 1
+namespace sapc_reflect {
+  template <typename T>
+  struct Array {
+    T const* data = nullptr;
+    std::size_t count = 0;
+
+    constexpr T const* begin() const noexcept { return data; }
+    constexpr T const* end() const noexcept { return data + count; }
+    constexpr std::size_t size() const noexcept { return count; }
+    constexpr bool empty() const noexcept { return count == 0; }
+    constexpr T const& operator[](std::size_t index) const noexcept { return data[index]; }
+  };
+
+  enum class Kind { Struct, Union, Enum, Attribute };
+
+  // text holds strings, qualified type names, enum items as type.item,
+  // and arrays as a C++ initializer
+  enum class ValueKind { None, Null, Bool, Integer, String, TypeName, Enum, Array };
+
+  struct Value {
+    ValueKind kind = ValueKind::None;
+    long long number = 0; // bools, integers, enum values, array lengths
+    char const* text = nullptr;
+  };
+
+  struct Argument {
+    char const* name = nullptr;
+    Value value;
+  };
+
+  struct Annotation {
+    char const* type = nullptr;
+    Array<Argument> args;
+  };
+
+  // offset and size are zero for fields of generic types and unions
+  struct Field {
+    char const* name = nullptr;
+    char const* type = nullptr;
+    std::size_t offset = 0;
+    std::size_t size = 0;
+    Value defaultValue;
+    Array<Annotation> annotations;
+  };
+
+  struct EnumItem {
+    char const* name = nullptr;
+    long long value = 0;
+  };
+
+  // size and align are zero for generic types
+  struct Type {
+    char const* name = nullptr;
+    char const* qualified = nullptr;
+    Kind kind = Kind::Struct;
+    std::size_t size = 0;
+    std::size_t align = 0;
+    char const* base = nullptr;
+    Array<Field> fields;
+    Array<EnumItem> items;
+    Array<Annotation> annotations;
+  };
+
+  struct Module {
+    char const* name = nullptr;
+    Array<Type> types;
+  };
+
+  // specialized with a static `type` member for every non-generic type
+  template <typename T>
+  struct reflect;
+}
+#endif
+)"sv;
+
+        struct Range {
+            size_t first = 0;
+            size_t count = 0;
+        };
+
+        // Each table is accumulated as text so that the records of every
+        // type land in one contiguous array per kind of record
+        struct Table {
+            std::string_view name;
+            std::ostringstream rows;
+            size_t count = 0;
+
+            Range add(std::string const& row) {
+                rows << "    " << row << ",\n";
+                return { count++, 1 };
+            }
+
+            std::string ref(Range range) const {
+                if (range.count == 0)
+                    return "{ nullptr, 0 }";
+                return "{ " + std::string{ name } + " + " + std::to_string(range.first) + ", " + std::to_string(range.count) + " }";
+            }
+        };
+
+        std::string literal(std::string_view text) {
+            std::ostringstream os;
+            encodeString(os, text);
+            return std::move(os).str();
+        }
+
+        std::string initializer(schema::Value const& value) {
+            std::ostringstream os;
+            encode(os, value);
+            return std::move(os).str();
+        }
+
+        std::string valueInfo(schema::Value const& value) {
+            return std::visit([&value](auto const& val) -> std::string {
+                using T = std::remove_cv_t<std::remove_reference_t<decltype(val)>>;
+                if constexpr (std::is_same_v<T, std::nullptr_t>)
+                    return "{ sapc_reflect::ValueKind::Null, 0, nullptr }";
+                else if constexpr (std::is_same_v<T, bool>)
+                    return val ? "{ sapc_reflect::ValueKind::Bool, 1, nullptr }" : "{ sapc_reflect::ValueKind::Bool, 0, nullptr }";
+                else if constexpr (std::is_same_v<T, long long>)
+                    return "{ sapc_reflect::ValueKind::Integer, " + std::to_string(val) + "LL, nullptr }";
+                else if constexpr (std::is_same_v<T, std::string>)
+                    return "{ sapc_reflect::ValueKind::String, 0, " + literal(val) + " }";
+                else if constexpr (std::is_same_v<T, schema::Type const*>)
+                    return "{ sapc_reflect::ValueKind::TypeName, 0, " + literal(val->qualifiedName.str()) + " }";
+                else if constexpr (std::is_same_v<T, schema::EnumItem const*>)
+                    return "{ sapc_reflect::ValueKind::Enum, " + std::to_string(val->value) + "LL, " + literal(std::string{ val->parent->qualifiedName.str() } + "." + std::string{ val->name.str() }) + " }";
+                else
+                    return "{ sapc_reflect::ValueKind::Array, " + std::to_string(val.size()) + ", " + literal(initializer(value)) + " }";
+                }, value.data);
+        }
+
+        char const* kindName(schema::Type::Kind kind) {
+            using Kind = schema::Type::Kind;
+            switch (kind) {
+            case Kind::Union: return "sapc_reflect::Kind::Union";
+            case Kind::Enum: return "sapc_reflect::Kind::Enum";
+            case Kind::Attribute: return "sapc_reflect::Kind::Attribute";
+            default: return "sapc_reflect::Kind::Struct";
+            }
+        }
+
+        struct ReflectionWriter {
+            std::ostream& os;
+            schema::Module const& mod;
+
+            Table arguments{ "arguments" };
+            Table annotations{ "annotations" };
+            Table fields{ "fields" };
+            Table items{ "items" };
+            Table types{ "types" };
+            std::vector<std::string> reflected; // C++ types given a reflect specialization
+
+            void write();
+            Range annotate(std::vector<schema::Annotation*> const& source);
+            void add(schema::Type const& type);
+        };
+    }
+
+    void generateCxxReflection(std::ostream& os, schema::Module const& mod) {
+        ReflectionWriter{ os, mod }.write();
+    }
+
+    Range ReflectionWriter::annotate(std::vector<schema::Annotation*> const& source) {
+        // the argument rows of every annotation precede the annotation rows
+        // that refer to them, so each list is built before it is added
+        std::vector<std::string> rows;
+        for (auto const* annotation : source) {
+            auto const& attribute = static_cast<schema::TypeAggregate const&>(*annotation->type);
+            if (attribute.name == "$customtag"sv)
+                continue;
+
+            Range args{ arguments.count, 0 };
+            for (size_t index = 0; index != annotation->args.size(); ++index) {
+                auto const name = index < attribute.fields.size() ? literal(attribute.fields[index]->name.str()) : "nullptr"s;
+                arguments.add("{ " + name + ", " + valueInfo(annotation->args[index]) + " }");
+                ++args.count;
+            }
+
+            rows.push_back("{ " + literal(attribute.qualifiedName.str()) + ", " + arguments.ref(args) + " }");
+        }
+
+        Range range{ annotations.count, rows.size() };
+        for (auto const& row : rows)
+            annotations.add(row);
+        return range;
+    }
+
+    void ReflectionWriter::add(schema::Type const& type) {
+        using Kind = schema::Type::Kind;
+
+        if (type.scope->owner != &mod || ignored(type.annotations))
+            return;
+        if (type.kind != Kind::Struct && type.kind != Kind::Union && type.kind != Kind::Enum && type.kind != Kind::Attribute)
+            return;
+
+        auto const cxxType = qualified(type);
+        auto const typeAnnotations = annotate(type.annotations);
+
+        std::string base = "nullptr";
+        bool generic = false;
+        Range fieldRange{ fields.count, 0 };
+        Range itemRange{ items.count, 0 };
+
+        if (type.kind == Kind::Enum) {
+            for (auto const* item : static_cast<schema::TypeEnum const&>(type).items) {
+                items.add("{ " + literal(item->name.str()) + ", " + std::to_string(item->value) + "LL }");
+                ++itemRange.count;
+            }
+        }
+        else {
+            auto const& typeAggr = static_cast<schema::TypeAggregate const&>(type);
+            generic = !typeAggr.typeParams.empty();
+            if (typeAggr.baseType != nullptr)
+                base = literal(typeAggr.baseType->qualifiedName.str());
+
+            // field annotations are added first so that the field rows stay contiguous
+            std::vector<std::string> rows;
+            for (auto const* field : typeAggr.fields) {
+                if (ignored(field->annotations))
+                    continue;
+
+                auto const fieldAnnotations = annotate(field->annotations);
+                auto const member = cxxName(field->name, field->annotations);
+                bool const laidOut = !generic && type.kind != Kind::Union;
+
+                std::string row = "{ " + literal(field->name.str()) + ", " + literal(field->type->qualifiedName.str()) + ", ";
+                row += laidOut ? "offsetof(" + cxxType + ", " + member + "), sizeof(static_cast<" + cxxType + "*>(nullptr)->" + member + "), " : "0, 0, "s;
+                row += field->defaultValue ? valueInfo(*field->defaultValue) : "{}"s;
+                row += ", " + annotations.ref(fieldAnnotations) + " }";
+                rows.push_back(std::move(row));
+            }
+
+            for (auto const& row : rows)
+                fields.add(row);
+            fieldRange.count = rows.size();
+        }
+
+        std::string row = "{ " + literal(type.name.str()) + ", " + literal(type.qualifiedName.str()) + ", " + kindName(type.kind) + ", ";
+        row += generic ? "0, 0, "s : "sizeof(" + cxxType + "), alignof(" + cxxType + "), ";
+        row += base + ", " + fields.ref(fieldRange) + ", " + items.ref(itemRange) + ", " + annotations.ref(typeAnnotations) + " }";
+        types.add(row);
+
+        reflected.push_back(generic ? std::string{} : cxxType);
+    }
+
+    void ReflectionWriter::write() {
+        for (auto const* type : mod.types)
+            add(*type);
+
+        auto const guard = includeGuard(mod.name.str(), "REFLECT");
+        auto const tables = "module_" + identifier(mod.name.str());
+
+        os << "// --------------------------------------\n";
+        os << "//  Generated file ** DO NOT EDIT **\n";
+        os << "// --------------------------------------\n\n";
+        os << "// from: " << mod.filename.filename().string() << '\n';
+        os << "// with: sapc\n";
+
+        os << "\n#if !defined(" << guard << ")\n";
+        os << "#define " << guard << " 1\n";
+        os << "#pragma once\n";
+        os << "#include \"" << mod.name << ".h\"\n";
+        os << "#include <cstddef>\n\n";
+
+        os << commonDeclarations << '\n';
+
+        // offsetof is conditionally supported for types that aren't standard
+        // layout, which includes any struct with a std::string member
+        os << "#if defined(__GNUC__)\n";
+        os << "#pragma GCC diagnostic push\n";
+        os << "#pragma GCC diagnostic ignored \"-Winvalid-offsetof\"\n";
+        os << "#endif\n\n";
+
+        os << "namespace sapc_reflect::" << tables << " {\n";
+        for (auto const* table : { &arguments, &annotations, &fields, &items, &types }) {
+            if (table->count == 0)
+                continue;
+
+            auto const recordType = table == &arguments ? "Argument"sv : table == &annotations ? "Annotation"sv : table == &fields ? "Field"sv : table == &items ? "EnumItem"sv : "Type"sv;
+            os << "  inline constexpr " << recordType << ' ' << table->name << "[] = {\n";
+            os << table->rows.str();
+            os << "  };\n\n";
+        }
+        os << "  inline constexpr sapc_reflect::Module module_info = { " << literal(mod.name.str()) << ", " << types.ref({ 0, types.count }) << " };\n";
+        os << "}\n\n";
+
+        os << "namespace sapc_reflect {\n";
+        bool first = true;
+        for (size_t index = 0; index != reflected.size(); ++index) {
+            if (reflected[index].empty())
+                continue;
+
+            if (!first)
+                os << '\n';
+            first = false;
+
+            os << "  template <>\n";
+            os << "  struct reflect<" << reflected[index] << "> {\n";
+            os << "    static constexpr Type const& type = " << tables << "::types[" << index << "];\n";
+            os << "  };\n";
+        }
+        os << "}\n\n";
+
+        os << "#if defined(__GNUC__)\n";
+        os << "#pragma GCC diagnostic pop\n";
+        os << "#endif\n\n";
+
+        os << "#endif";
+    }
+}
@@ -0,0 +1,16 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "sapc/location.hh"
+#include "sapc/schema.hh"
+
+#include <iosfwd>
+
+namespace sapc {
+    // writes a C++ header of constexpr reflection tables describing the
+    // declarations of the header generated by generateCxxHeader
+    void generateCxxReflection(std::ostream& os, schema::Module const& mod);
+}
@@ -0,0 +1,403 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "cxx_serialize.hh"
+#include "cxx_names.hh"
+#include "sapc/schema.hh"
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sapc {
+    using namespace std::literals;
+    using namespace sapc::cxx;
+
+    namespace {
+        // Declarations shared by every generated serializer header; the guard
+        // lets headers of several modules be included together
+        constexpr std::string_view commonDeclarations = R"(#if !defined(INCLUDE_GUARD_SAPC_SERIALIZE)
+#define INCLUDE_GUARD_SAPC_SERIALIZE 1
+// Values are encoded in host byte order: arithmetic types and enums as their
+// bytes, strings and vectors as a 32-bit count followed by their elements,
+// and pointers as a presence byte followed by the value. Specialize
+// Serializer before including a generated header to support other types;
+// a specialization's min_size() is the fewest bytes a value encodes to.
+namespace sapc_serialize {
+  struct Writer {
+    std::vector<unsigned char>& buffer;
+
+    void bytes(void const* data, std::size_t size) {
+      auto const* const first = static_cast<unsigned char const*>(data);
+      buffer.insert(buffer.end(), first, first + size);
+    }
+  };
+
+  // a failed read leaves the reader at its end, so that every later read
+  // fails; pointers and vectors nested deeper than maxDepth fail too, rather
+  // than overflowing the stack
+  struct Reader {
+    unsigned char const* cursor = nullptr;
+    unsigned char const* end = nullptr;
+    unsigned depth = 0; // pointers and vectors being read
+    unsigned maxDepth = 256;
+    std::size_t maxEmptyElements = 65536; // elements encoded in no bytes, which the input can't bound
+
+    std::size_t remaining() const noexcept { return static_cast<std::size_t>(end - cursor); }
+
+    bool fail() noexcept {
+      cursor = end;
+      return false;
+    }
+
+    bool bytes(void* data, std::size_t size) {
+      if (remaining() < size)
+        return fail();
+      if (size != 0)
+        std::memcpy(data, cursor, size);
+      cursor += size;
+      return true;
+    }
+
+    bool enter() noexcept {
+      if (depth == maxDepth)
+        return fail();
+      ++depth;
+      return true;
+    }
+    void leave() noexcept { --depth; }
+  };
+
+  template <typename T, typename = void>
+  struct Serializer;
+
+  template <typename T>
+  void write(Writer& out, T const& value) { Serializer<T>::write(out, value); }
+
+  template <typename T>
+  bool read(Reader& in, T& value) { return Serializer<T>::read(in, value); }
+
+  template <typename T>
+  std::size_t min_size() { return Serializer<T>::min_size(); }
+
+  template <typename T>
+  inline constexpr bool is_bulk_v = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+  template <typename T>
+  struct Serializer<T, std::enable_if_t<is_bulk_v<T>>> {
+    static void write(Writer& out, T const& value) { out.bytes(&value, sizeof(value)); }
+    static bool read(Reader& in, T& value) { return in.bytes(&value, sizeof(value)); }
+    static std::size_t min_size() { return sizeof(T); }
+  };
+
+  template <>
+  struct Serializer<bool> {
+    static void write(Writer& out, bool value) {
+      unsigned char const byte = value ? 1 : 0;
+      out.bytes(&byte, 1);
+    }
+    static bool read(Reader& in, bool& value) {
+      unsigned char byte = 0;
+      bool const ok = in.bytes(&byte, 1);
+      value = byte != 0;
+      return ok;
+    }
+    static std::size_t min_size() { return 1; }
+  };
+
+  template <typename T>
+  struct Serializer<T, std::enable_if_t<std::is_enum_v<T>>> {
+    using Base = std::underlying_type_t<T>;
+    static void write(Writer& out, T const& value) { sapc_serialize::write(out, static_cast<Base>(value)); }
+    static bool read(Reader& in, T& value) {
+      Base base = 0;
+      bool const ok = sapc_serialize::read(in, base);
+      value = static_cast<T>(base);
+      return ok;
+    }
+    static std::size_t min_size() { return sizeof(Base); }
+  };
+
+  // each element takes at least elementSize bytes, which bounds the allocation
+  inline bool read_count(Reader& in, std::size_t& count, std::size_t elementSize) {
+    std::uint32_t stored = 0;
+    bool const ok = in.bytes(&stored, sizeof(stored));
+    count = stored;
+    if (count > (elementSize != 0 ? in.remaining() / elementSize : in.maxEmptyElements)) {
+      count = 0;
+      return in.fail();
+    }
+    return ok;
+  }
+
+  inline void write_count(Writer& out, std::size_t count) {
+    auto const stored = static_cast<std::uint32_t>(count);
+    out.bytes(&stored, sizeof(stored));
+  }
+
+  template <>
+  struct Serializer<std::string> {
+    static void write(Writer& out, std::string const& value) {
+      write_count(out, value.size());
+      out.bytes(value.data(), value.size());
+    }
+    static bool read(Reader& in, std::string& value) {
+      std::size_t count = 0;
+      bool const ok = read_count(in, count, 1);
+      value.resize(count);
+      return ok && in.bytes(value.data(), count);
+    }
+    static std::size_t min_size() { return sizeof(std::uint32_t); }
+  };
+
+  template <typename T>
+  struct Serializer<std::vector<T>> {
+    static void write(Writer& out, std::vector<T> const& value) {
+      write_count(out, value.size());
+      if constexpr (is_bulk_v<T>)
+        out.bytes(value.data(), value.size() * sizeof(T));
+      else
+        for (auto const& elem : value)
+          sapc_serialize::write(out, elem);
+    }
+    static bool read(Reader& in, std::vector<T>& value) {
+      std::size_t count = 0;
+      bool ok = read_count(in, count, sapc_serialize::min_size<T>());
+      if constexpr (is_bulk_v<T>) {
+        value.resize(count);
+        ok &= in.bytes(value.data(), count * sizeof(T));
+      }
+      else {
+        if (!in.enter()) {
+          value.clear();
+          return false;
+        }
+        value.resize(count);
+        for (std::size_t index = 0; index != count; ++index) {
+          T elem{};
+          ok &= sapc_serialize::read(in, elem);
+          value[index] = std::move(elem);
+        }
+        in.leave();
+      }
+      return ok;
+    }
+    static std::size_t min_size() { return sizeof(std::uint32_t); }
+  };
+
+  template <typename T, std::size_t N>
+  struct Serializer<std::array<T, N>> {
+    static void write(Writer& out, std::array<T, N> const& value) {
+      if constexpr (is_bulk_v<T>)
+        out.bytes(value.data(), sizeof(value));
+      else
+        for (auto const& elem : value)
+          sapc_serialize::write(out, elem);
+    }
+    static bool read(Reader& in, std::array<T, N>& value) {
+      if constexpr (is_bulk_v<T>)
+        return in.bytes(value.data(), sizeof(value));
+      bool ok = true;
+      for (auto& elem : value)
+        ok &= sapc_serialize::read(in, elem);
+      return ok;
+    }
+    static std::size_t min_size() { return N * sapc_serialize::min_size<T>(); }
+  };
+
+  template <typename T>
+  struct Serializer<std::unique_ptr<T>> {
+    static void write(Writer& out, std::unique_ptr<T> const& value) {
+      sapc_serialize::write(out, value != nullptr);
+      if (value != nullptr)
+        sapc_serialize::write(out, *value);
+    }
+    static bool read(Reader& in, std::unique_ptr<T>& value) {
+      bool present = false;
+      bool const ok = sapc_serialize::read(in, present);
+      if (!ok || !present) {
+        value.reset();
+        return ok;
+      }
+      if (!in.enter()) {
+        value.reset();
+        return false;
+      }
+      value = std::make_unique<T>();
+      bool const read = sapc_serialize::read(in, *value);
+      in.leave();
+      return read;
+    }
+    static std::size_t min_size() { return 1; }
+  };
+}
+#endif
+)"sv;
+
+        struct Serialized {
+            std::string cxxType; // the specialized type, using the template parameters of generic types
+            std::string templateHead; // empty unless generic
+            schema::TypeAggregate const* type = nullptr;
+            bool bulk = false;
+        };
+
+        struct SerializerWriter {
+            std::ostream& os;
+            schema::Module const& mod;
+            bool bulkCopy = false;
+
+            std::vector<Serialized> structs;
+
+            void write();
+            void writeBodies(Serialized const& serialized);
+        };
+
+        bool serializedField(schema::Field const& field) {
+            return !ignored(field.annotations) && findAnnotation(field.annotations, "transient"sv) == nullptr &&
+                field.type->kind != schema::Type::Kind::TypeId;
+        }
+    }
+
+    void generateCxxSerializer(std::ostream& os, schema::Module const& mod, bool bulkCopy) {
+        SerializerWriter{ os, mod, bulkCopy }.write();
+    }
+
+    void SerializerWriter::writeBodies(Serialized const& serialized) {
+        auto const& type = *serialized.type;
+        auto const& cxxType = serialized.cxxType;
+        auto const prefix = serialized.templateHead.empty() ? "  inline "s : "  " + serialized.templateHead + "\n  inline ";
+
+        bool empty = type.baseType == nullptr;
+        for (auto const* field : type.fields)
+            empty = empty && !serializedField(*field);
+
+        os << prefix << "void Serializer<" << cxxType << ">::write(Writer& out, " << cxxType << " const& value) {\n";
+        if (serialized.bulk) {
+            os << "    if constexpr (std::is_trivially_copyable_v<" << cxxType << ">) {\n";
+            os << "      out.bytes(&value, sizeof(value));\n";
+            os << "      return;\n";
+            os << "    }\n";
+        }
+        if (type.baseType != nullptr)
+            os << "    sapc_serialize::write(out, static_cast<" << qualified(*type.baseType) << " const&>(value));\n";
+        for (auto const* field : type.fields)
+            if (serializedField(*field))
+                os << "    sapc_serialize::write(out, value." << cxxName(field->name, field->annotations) << ");\n";
+        if (empty)
+            os << "    (void)out; (void)value;\n";
+        os << "  }\n\n";
+
+        os << prefix << "bool Serializer<" << cxxType << ">::read(Reader& in, " << cxxType << "& value) {\n";
+        if (serialized.bulk) {
+            os << "    if constexpr (std::is_trivially_copyable_v<" << cxxType << ">)\n";
+            os << "      return in.bytes(&value, sizeof(value));\n";
+        }
+        os << "    bool ok = true;\n";
+        if (type.baseType != nullptr)
+            os << "    ok &= sapc_serialize::read(in, static_cast<" << qualified(*type.baseType) << "&>(value));\n";
+        for (auto const* field : type.fields)
+            if (serializedField(*field))
+                os << "    ok &= sapc_serialize::read(in, value." << cxxName(field->name, field->annotations) << ");\n";
+        if (empty)
+            os << "    (void)in; (void)value;\n";
+        os << "    return ok;\n";
+        os << "  }\n\n";
+
+        // a struct without fields encodes to nothing, so its vectors are bounded separately
+        os << prefix << "std::size_t Serializer<" << cxxType << ">::min_size() {\n";
+        if (serialized.bulk) {
+            os << "    if constexpr (std::is_trivially_copyable_v<" << cxxType << ">)\n";
+            os << "      return sizeof(" << cxxType << ");\n";
+        }
+        std::vector<std::string> sizes;
+        if (type.baseType != nullptr)
+            sizes.push_back(qualified(*type.baseType));
+        for (auto const* field : type.fields)
+            if (serializedField(*field))
+                sizes.push_back("decltype(" + cxxType + "::" + cxxName(field->name, field->annotations) + ")");
+        os << "    return ";
+        if (sizes.empty())
+            os << '0';
+        for (size_t index = 0; index != sizes.size(); ++index)
+            os << (index != 0 ? " +\n      " : "") << "sapc_serialize::min_size<" << sizes[index] << ">()";
+        os << ";\n";
+        os << "  }\n";
+    }
+
+    void SerializerWriter::write() {
+        for (auto const* type : mod.types) {
+            if (type->kind != schema::Type::Kind::Struct || type->scope->owner != &mod || ignored(type->annotations))
+                continue;
+
+            auto const& typeAggr = static_cast<schema::TypeAggregate const&>(*type);
+
+            Serialized serialized;
+            serialized.type = &typeAggr;
+            serialized.cxxType = qualified(typeAggr);
+            serialized.bulk = bulkCopy || findAnnotation(typeAggr.annotations, "bulkcopy"sv) != nullptr;
+
+            if (!typeAggr.typeParams.empty()) {
+                serialized.templateHead = "template <";
+                serialized.cxxType += '<';
+                for (size_t index = 0; index != typeAggr.typeParams.size(); ++index) {
+                    auto const param = typeAggr.typeParams[index]->name.str();
+                    serialized.templateHead += (index != 0 ? ", typename "s : "typename "s) + std::string{ param };
+                    serialized.cxxType += (index != 0 ? ", "s : ""s) + std::string{ param };
+                }
+                serialized.templateHead += '>';
+                serialized.cxxType += '>';
+            }
+
+            structs.push_back(std::move(serialized));
+        }
+
+        auto const guard = includeGuard(mod.name.str(), "SERIALIZE");
+
+        os << "// --------------------------------------\n";
+        os << "//  Generated file ** DO NOT EDIT **\n";
+        os << "// --------------------------------------\n\n";
+        os << "// from: " << mod.filename.filename().string() << '\n';
+        os << "// with: sapc\n";
+
+        os << "\n#if !defined(" << guard << ")\n";
+        os << "#define " << guard << " 1\n";
+        os << "#pragma once\n";
+        os << "#include \"" << mod.name << ".h\"\n";
+        for (auto const& imp : mod.imports)
+            os << "#include \"" << imp.mod->name << "_serialize.h\"\n";
+        os << "#include <array>\n";
+        os << "#include <cstddef>\n";
+        os << "#include <cstdint>\n";
+        os << "#include <cstring>\n";
+        os << "#include <memory>\n";
+        os << "#include <string>\n";
+        os << "#include <type_traits>\n";
+        os << "#include <vector>\n\n";
+
+        os << commonDeclarations << '\n';
+
+        os << "namespace sapc_serialize {\n";
+
+        // every specialization is declared before any is defined, so that
+        // structs may refer to structs declared after them
+        for (auto const& serialized : structs) {
+            os << "  " << (serialized.templateHead.empty() ? "template <>"s : serialized.templateHead) << '\n';
+            os << "  struct Serializer<" << serialized.cxxType << "> {\n";
+            os << "    static void write(Writer& out, " << serialized.cxxType << " const& value);\n";
+            os << "    static bool read(Reader& in, " << serialized.cxxType << "& value);\n";
+            os << "    static std::size_t min_size();\n";
+            os << "  };\n\n";
+        }
+
+        for (size_t index = 0; index != structs.size(); ++index) {
+            if (index != 0)
+                os << '\n';
+            writeBodies(structs[index]);
+        }
+
+        os << "}\n\n";
+        os << "#endif";
+    }
+}
@@ -0,0 +1,16 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "sapc/schema.hh"
+
+#include <iosfwd>
+
+namespace sapc {
+    // writes a C++ header of binary read and write functions for the structs
+    // of the header generated by generateCxxHeader; with bulkCopy, trivially
+    // copyable structs are copied with a single memcpy
+    void generateCxxSerializer(std::ostream& os, schema::Module const& mod, bool bulkCopy);
+}
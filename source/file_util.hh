@@ -7,7 +7,10 @@
 #include <filesystem>
 #include <fstream>
 #include <functional>
-#include <sstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
 #include <vector>
 
 namespace sapc {
@@ -19,34 +22,70 @@ namespace sapc {
     };
 
     inline bool loadText(std::filesystem::path const& filename, std::string& out_text) {
-        // open file and read contents
-        std::ifstream stream(filename);
+        // open file and read contents directly into the output in a single read
+        std::ifstream stream(filename, std::ios::binary | std::ios::ate);
         if (!stream)
             return false;
 
-        std::ostringstream buffer;
-        buffer << stream.rdbuf();
-        stream.close();
-        out_text = buffer.str();
-        return true;
+        auto const size = stream.tellg();
+        if (size < 0)
+            return false;
+        stream.seekg(0);
+
+        out_text.resize(static_cast<size_t>(size));
+        stream.read(out_text.data(), size);
+        out_text.resize(static_cast<size_t>(stream.gcount()));
+        return !stream.bad();
     }
 
-    inline std::filesystem::path resolveFile(std::filesystem::path target, std::filesystem::path const& base, std::vector<std::filesystem::path> const& search) {
-        if (target.is_absolute())
-            return target;
+    // a unique name in the directory of the target, so that renaming it
+    // into place replaces the target atomically
+    inline std::filesystem::path tempPath(std::filesystem::path const& target) {
+        auto temp = target;
+        temp += "." + std::to_string(std::random_device{}()) + ".tmp";
+        return temp;
+    }
+
+    // true if both files exist and hold the same bytes
+    inline bool sameContents(std::filesystem::path const& lhs, std::filesystem::path const& rhs) {
+        std::error_code ec;
+        auto const size = std::filesystem::file_size(lhs, ec);
+        if (ec || std::filesystem::file_size(rhs, ec) != size || ec)
+            return false;
+
+        std::ifstream lhsStream(lhs, std::ios::binary);
+        std::ifstream rhsStream(rhs, std::ios::binary);
+        if (!lhsStream || !rhsStream)
+            return false;
 
-        if (!base.empty()) {
-            auto tmp = base / target;
-            if (std::filesystem::exists(tmp))
-                return tmp;
+        char lhsBuffer[16384];
+        char rhsBuffer[16384];
+        for (;;) {
+            lhsStream.read(lhsBuffer, sizeof lhsBuffer);
+            rhsStream.read(rhsBuffer, sizeof rhsBuffer);
+            auto const count = lhsStream.gcount();
+            if (count != rhsStream.gcount() || std::string_view(lhsBuffer, static_cast<size_t>(count)) != std::string_view(rhsBuffer, static_cast<size_t>(count)))
+                return false;
+            if (count == 0 || !lhsStream)
+                return !lhsStream.bad() && !rhsStream.bad();
         }
+    }
 
-        for (auto const& path : search) {
-            auto tmp = path / target;
-            if (std::filesystem::exists(tmp))
-                return tmp;
+    // Moves a fully written temporary over the target, unless the target
+    // already holds the same bytes and always is false; an unchanged target
+    // keeps its timestamp, so build systems don't rebuild what depends on it
+    inline bool replaceFile(std::filesystem::path const& temp, std::filesystem::path const& target, bool always) {
+        std::error_code ec;
+        if (!always && sameContents(temp, target)) {
+            std::filesystem::remove(temp, ec);
+            return true;
         }
 
-        return {};
+        std::filesystem::rename(temp, target, ec);
+        if (ec) {
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+        return true;
     }
 }
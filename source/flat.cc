@@ -0,0 +1,565 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "sapc/flat.hh"
+
+#include <cassert>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+
+namespace sapc {
+    namespace {
+        using namespace flat;
+
+        // the records listed with FlattenOptions::only, and everything they reach
+        struct Selection {
+            std::unordered_set<schema::Type const*> types;
+            std::unordered_set<schema::Constant const*> constants;
+            std::unordered_set<schema::Namespace const*> namespaces;
+            std::vector<schema::Type const*> pending;
+
+            void select(schema::Module const& mod, std::vector<std::string> const& patterns, bool instantiated);
+
+            void keep(schema::Type const* type);
+            void keep(schema::Namespace const* ns);
+            void keep(std::vector<schema::Annotation*> const& annotations);
+            void keep(schema::Value const& value);
+            void keep(std::vector<schema::Field*> const& fields);
+            void reach(schema::Type const& type, bool instantiated);
+
+            bool has(schema::Type const* type) const { return types.count(type) != 0; }
+            bool has(schema::Constant const* constant) const { return constants.count(constant) != 0; }
+            bool has(schema::Namespace const* ns) const { return namespaces.count(ns) != 0; }
+        };
+
+        struct Flattener {
+            Module& out;
+            bool instantiated = false;
+            Selection const* selection = nullptr; // null to list everything
+
+            std::unordered_map<schema::Type const*, Index> typeIds;
+            std::unordered_map<schema::EnumItem const*, Index> itemIds;
+            std::unordered_map<schema::Constant const*, Index> constantIds;
+            std::unordered_map<schema::Namespace const*, Index> namespaceIds;
+
+            Index type(schema::Type const* type);
+            Index item(schema::EnumItem const* item);
+            Index constant(schema::Constant const* constant);
+            Index ns(schema::Namespace const* ns);
+            Index string(std::string text);
+
+            template <typename T, typename Record>
+            void reserve(std::vector<T const*> const& listed, std::unordered_map<T const*, Index>& ids, std::vector<Record>& records, Range& range);
+
+            void header(Index slot, schema::Type const& type);
+            void header(Index slot, schema::Constant const& constant);
+            void header(Index slot, schema::Namespace const& ns);
+
+            template <typename T, typename Func>
+            Range refs(std::vector<T> const& source, Func&& func);
+
+            Range annotate(std::vector<schema::Annotation*> const& source);
+            Range fields(std::vector<schema::Field*> const& source);
+            Index value(schema::Value const& source);
+            void fill(Index slot, schema::Value const& source);
+
+            void fill(Index slot, schema::Type const& type);
+            void fill(Index slot, schema::Constant const& constant);
+            void fill(Index slot, schema::Namespace const& ns);
+
+            void flatten(schema::Module const& mod);
+
+            template <typename T>
+            std::vector<T const*> const& listed(std::vector<T const*> const& all, std::vector<T const*>& kept) const;
+        };
+
+        Index count(size_t size) { return static_cast<Index>(size); }
+
+        bool isAggregate(schema::Type::Kind kind) {
+            return kind == schema::Type::Kind::Struct || kind == schema::Type::Kind::Union || kind == schema::Type::Kind::Attribute;
+        }
+
+        bool isIndirect(schema::Type::Kind kind) {
+            return kind == schema::Type::Kind::Array || kind == schema::Type::Kind::Pointer || kind == schema::Type::Kind::Alias || kind == schema::Type::Kind::Specialized;
+        }
+    }
+
+    flat::Module flatten(schema::Module const& mod, FlattenOptions const& options) {
+        flat::Module out;
+        if (options.only.empty()) {
+            Flattener{ out, options.instantiated }.flatten(mod);
+            return out;
+        }
+
+        Selection selection;
+        selection.select(mod, options.only, options.instantiated);
+        Flattener{ out, options.instantiated, &selection }.flatten(mod);
+        return out;
+    }
+
+    bool matchesPattern(std::string_view pattern, std::string_view name) noexcept {
+        // on a mismatch, the last star consumes one more character and the
+        // rest of the pattern is tried again from there
+        size_t pat = 0;
+        size_t pos = 0;
+        size_t star = std::string_view::npos;
+        size_t resume = 0;
+        while (pos != name.size()) {
+            if (pat != pattern.size() && pattern[pat] == '*') {
+                star = pat++;
+                resume = pos;
+            }
+            else if (pat != pattern.size() && pattern[pat] == name[pos]) {
+                ++pat;
+                ++pos;
+            }
+            else if (star != std::string_view::npos) {
+                pat = star + 1;
+                pos = ++resume;
+            }
+            else
+                return false;
+        }
+        while (pat != pattern.size() && pattern[pat] == '*')
+            ++pat;
+        return pat == pattern.size();
+    }
+
+    void Selection::select(schema::Module const& mod, std::vector<std::string> const& patterns, bool instantiated) {
+        auto const matches = [&patterns](Symbol qualifiedName) {
+            for (auto const& pattern : patterns)
+                if (matchesPattern(pattern, qualifiedName.str()))
+                    return true;
+            return false;
+        };
+
+        for (auto const* type : mod.types)
+            if (matches(type->qualifiedName))
+                keep(type);
+        for (auto const* constant : mod.constants) {
+            if (!matches(constant->qualifiedName) || !constants.insert(constant).second)
+                continue;
+            keep(constant->scope);
+            keep(constant->type);
+            keep(constant->value);
+            keep(constant->annotations);
+        }
+
+        // reached types are walked from a work list rather than recursively,
+        // as chains of references may be arbitrarily long
+        while (!pending.empty()) {
+            auto const* const type = pending.back();
+            pending.pop_back();
+            reach(*type, instantiated);
+        }
+    }
+
+    void Selection::keep(schema::Type const* type) {
+        if (type != nullptr && types.insert(type).second)
+            pending.push_back(type);
+    }
+
+    void Selection::keep(schema::Namespace const* ns) {
+        for (; ns != nullptr && namespaces.insert(ns).second; ns = ns->parent) {}
+    }
+
+    void Selection::keep(std::vector<schema::Annotation*> const& annotations) {
+        for (auto const* annotation : annotations) {
+            keep(annotation->type);
+            for (auto const& arg : annotation->args)
+                keep(arg);
+        }
+    }
+
+    void Selection::keep(schema::Value const& value) {
+        if (auto const* const type = std::get_if<schema::Type const*>(&value.data))
+            keep(*type);
+        else if (auto const* const item = std::get_if<schema::EnumItem const*>(&value.data))
+            keep((*item)->parent);
+        else if (auto const* const elements = std::get_if<std::vector<schema::Value>>(&value.data))
+            for (auto const& element : *elements)
+                keep(element);
+    }
+
+    void Selection::keep(std::vector<schema::Field*> const& fields) {
+        for (auto const* field : fields) {
+            keep(field->type);
+            if (field->defaultValue)
+                keep(*field->defaultValue);
+            keep(field->annotations);
+        }
+    }
+
+    void Selection::reach(schema::Type const& type, bool instantiated) {
+        keep(type.scope);
+        keep(type.annotations);
+
+        if (type.kind == schema::Type::Kind::Enum) {
+            auto const& typeEnum = static_cast<schema::TypeEnum const&>(type);
+            keep(typeEnum.baseType);
+            for (auto const* enumItem : typeEnum.items)
+                keep(enumItem->annotations);
+        }
+        else if (isAggregate(type.kind)) {
+            auto const& typeAggr = static_cast<schema::TypeAggregate const&>(type);
+            keep(typeAggr.baseType);
+            for (auto const* param : typeAggr.typeParams)
+                keep(param);
+            keep(typeAggr.fields);
+        }
+        else if (isIndirect(type.kind)) {
+            auto const& typeInd = static_cast<schema::TypeIndirect const&>(type);
+            keep(typeInd.refType);
+            for (auto const* arg : typeInd.typeArgs)
+                keep(arg);
+            if (instantiated)
+                keep(typeInd.fields);
+        }
+    }
+
+    // the records of a schema list that are listed, held in kept if selecting
+    template <typename T>
+    std::vector<T const*> const& Flattener::listed(std::vector<T const*> const& all, std::vector<T const*>& kept) const {
+        if (selection == nullptr)
+            return all;
+
+        kept.clear();
+        for (auto const* elem : all)
+            if (selection->has(elem))
+                kept.push_back(elem);
+        return kept;
+    }
+
+    // records that the module doesn't list are added on first reference
+    Index Flattener::type(schema::Type const* type) {
+        if (type == nullptr)
+            return none;
+
+        auto const [it, inserted] = typeIds.emplace(type, count(out.types.size()));
+        if (!inserted)
+            return it->second;
+
+        out.types.emplace_back();
+        header(it->second, *type);
+        return it->second;
+    }
+
+    Index Flattener::item(schema::EnumItem const* item) {
+        assert(item != nullptr);
+
+        auto const [it, inserted] = itemIds.emplace(item, count(out.enumItems.size()));
+        if (!inserted)
+            return it->second;
+
+        auto const slot = it->second;
+        out.enumItems.emplace_back();
+
+        EnumItem record;
+        record.name = item->name;
+        record.location = item->location;
+        record.value = item->value;
+        record.parent = type(item->parent);
+        out.enumItems[slot] = record;
+        return slot;
+    }
+
+    Index Flattener::constant(schema::Constant const* constant) {
+        assert(constant != nullptr);
+
+        auto const [it, inserted] = constantIds.emplace(constant, count(out.constants.size()));
+        if (!inserted)
+            return it->second;
+
+        out.constants.emplace_back();
+        header(it->second, *constant);
+        return it->second;
+    }
+
+    Index Flattener::ns(schema::Namespace const* ns) {
+        if (ns == nullptr)
+            return none;
+
+        auto const [it, inserted] = namespaceIds.emplace(ns, count(out.namespaces.size()));
+        if (!inserted)
+            return it->second;
+
+        out.namespaces.emplace_back();
+        header(it->second, *ns);
+        return it->second;
+    }
+
+    // the records vectors may grow while resolving the scope, so each record
+    // is only written once that is done
+    void Flattener::header(Index slot, schema::Type const& type) {
+        Type record;
+        record.kind = type.kind;
+        record.name = type.name;
+        record.qualifiedName = type.qualifiedName;
+        record.location = type.location;
+        record.scope = ns(type.scope);
+        out.types[slot] = record;
+    }
+
+    void Flattener::header(Index slot, schema::Constant const& constant) {
+        Constant record;
+        record.name = constant.name;
+        record.qualifiedName = constant.qualifiedName;
+        record.location = constant.location;
+        record.scope = ns(constant.scope);
+        out.constants[slot] = record;
+    }
+
+    void Flattener::header(Index slot, schema::Namespace const& ns) {
+        Namespace record;
+        record.name = ns.name;
+        record.qualifiedName = ns.qualifiedName;
+        record.location = ns.location;
+        if (ns.owner != nullptr)
+            record.module = ns.owner->name;
+        record.parent = this->ns(ns.parent);
+        out.namespaces[slot] = record;
+    }
+
+    template <typename T, typename Record>
+    void Flattener::reserve(std::vector<T const*> const& listed, std::unordered_map<T const*, Index>& ids, std::vector<Record>& records, Range& range) {
+        records.resize(listed.size());
+        ids.reserve(listed.size());
+        for (auto const* elem : listed)
+            ids.emplace(elem, count(ids.size()));
+        assert(ids.size() == listed.size() && "listed records must be unique");
+        range = { 0, count(listed.size()) };
+    }
+
+    Index Flattener::string(std::string text) {
+        out.strings.push_back(std::move(text));
+        return count(out.strings.size() - 1);
+    }
+
+    template <typename T, typename Func>
+    Range Flattener::refs(std::vector<T> const& source, Func&& func) {
+        Range range{ count(out.refs.size()), count(source.size()) };
+        for (auto const& elem : source)
+            out.refs.push_back(func(elem));
+        return range;
+    }
+
+    // nested values may append further annotations, so the run is reserved first
+    Range Flattener::annotate(std::vector<schema::Annotation*> const& source) {
+        Range range{ count(out.annotations.size()), count(source.size()) };
+        out.annotations.resize(out.annotations.size() + source.size());
+
+        for (Index index = 0; index != range.count; ++index) {
+            auto const& annotation = *source[index];
+
+            Annotation record;
+            record.type = type(annotation.type);
+            record.location = annotation.location;
+
+            record.args = { count(out.values.size()), count(annotation.args.size()) };
+            out.values.resize(out.values.size() + annotation.args.size());
+            for (Index arg = 0; arg != record.args.count; ++arg)
+                fill(record.args.first + arg, annotation.args[arg]);
+
+            out.annotations[range.first + index] = record;
+        }
+        return range;
+    }
+
+    Index Flattener::value(schema::Value const& source) {
+        auto const slot = count(out.values.size());
+        out.values.emplace_back();
+        fill(slot, source);
+        return slot;
+    }
+
+    // array elements are stored contiguously, so their slots are reserved
+    // before any element (which may itself be an array) is filled in
+    void Flattener::fill(Index slot, schema::Value const& source) {
+        Value record;
+        std::visit([this, &record](auto const& val) {
+            using T = std::remove_cv_t<std::remove_reference_t<decltype(val)>>;
+            if constexpr (std::is_same_v<T, std::nullptr_t>) {
+                record.kind = ValueKind::Null;
+            }
+            else if constexpr (std::is_same_v<T, bool>) {
+                record.kind = ValueKind::Bool;
+                record.number = val ? 1 : 0;
+            }
+            else if constexpr (std::is_same_v<T, long long>) {
+                record.kind = ValueKind::Integer;
+                record.number = val;
+            }
+            else if constexpr (std::is_same_v<T, std::string>) {
+                record.kind = ValueKind::String;
+                record.index = string(val);
+            }
+            else if constexpr (std::is_same_v<T, schema::Type const*>) {
+                assert(val != nullptr);
+                record.kind = ValueKind::TypeName;
+                record.index = type(val);
+            }
+            else if constexpr (std::is_same_v<T, schema::EnumItem const*>) {
+                record.kind = ValueKind::Enum;
+                record.index = item(val);
+            }
+            else if constexpr (std::is_same_v<T, std::vector<schema::Value>>) {
+                record.kind = ValueKind::Array;
+                record.elements = { count(out.values.size()), count(val.size()) };
+                out.values.resize(out.values.size() + val.size());
+                for (Index index = 0; index != record.elements.count; ++index)
+                    fill(record.elements.first + index, val[index]);
+            }
+            }, source.data);
+        out.values[slot] = record;
+    }
+
+    void Flattener::fill(Index slot, schema::Type const& type) {
+        auto const annotations = annotate(type.annotations);
+        out.types[slot].annotations = annotations;
+
+        if (type.kind == schema::Type::Kind::Enum) {
+            // the items were reserved along with the type
+            auto const& typeEnum = static_cast<schema::TypeEnum const&>(type);
+            for (auto const* enumItem : typeEnum.items) {
+                auto const itemAnnotations = annotate(enumItem->annotations);
+                out.enumItems[itemIds.at(enumItem)].annotations = itemAnnotations;
+            }
+
+            auto const base = this->type(typeEnum.baseType);
+            out.types[slot].refType = base;
+        }
+        else if (isAggregate(type.kind)) {
+            auto const& typeAggr = static_cast<schema::TypeAggregate const&>(type);
+
+            auto const base = this->type(typeAggr.baseType);
+            auto const typeParams = refs(typeAggr.typeParams, [this](auto const* param) { return this->type(param); });
+            auto const fields = this->fields(typeAggr.fields);
+
+            auto& record = out.types[slot];
+            record.refType = base;
+            record.typeParams = typeParams;
+            record.fields = fields;
+        }
+        else if (isIndirect(type.kind)) {
+            auto const& typeInd = static_cast<schema::TypeIndirect const&>(type);
+
+            auto const refType = this->type(typeInd.refType);
+            auto const typeArgs = refs(typeInd.typeArgs, [this](auto const* arg) { return this->type(arg); });
+            auto const fields = instantiated ? this->fields(typeInd.fields) : Range{};
+
+            auto& record = out.types[slot];
+            record.refType = refType;
+            record.arraySize = typeInd.arraySize;
+            record.typeArgs = typeArgs;
+            record.fields = fields;
+        }
+    }
+
+    Range Flattener::fields(std::vector<schema::Field*> const& source) {
+        Range const range{ count(out.fields.size()), count(source.size()) };
+        out.fields.resize(out.fields.size() + source.size());
+        for (Index index = 0; index != range.count; ++index) {
+            auto const& field = *source[index];
+
+            Field record;
+            record.name = field.name;
+            record.location = field.location;
+            record.type = type(field.type);
+            if (field.defaultValue)
+                record.defaultValue = value(*field.defaultValue);
+            record.annotations = annotate(field.annotations);
+            out.fields[range.first + index] = record;
+        }
+        return range;
+    }
+
+    void Flattener::fill(Index slot, schema::Constant const& constant) {
+        auto const constantType = type(constant.type);
+        auto const constantValue = value(constant.value);
+        auto const annotations = annotate(constant.annotations);
+
+        auto& record = out.constants[slot];
+        record.type = constantType;
+        record.value = constantValue;
+        record.annotations = annotations;
+    }
+
+    void Flattener::fill(Index slot, schema::Namespace const& ns) {
+        std::vector<schema::Type const*> keptTypes;
+        std::vector<schema::Constant const*> keptConstants;
+        std::vector<schema::Namespace const*> keptNamespaces;
+        auto const types = refs(listed(ns.types, keptTypes), [this](auto const* type) { return this->type(type); });
+        auto const constants = refs(listed(ns.constants, keptConstants), [this](auto const* constant) { return this->constant(constant); });
+        auto const namespaces = refs(listed(ns.namespaces, keptNamespaces), [this](auto const* sub) { return this->ns(sub); });
+
+        auto& record = out.namespaces[slot];
+        record.types = types;
+        record.constants = constants;
+        record.namespaces = namespaces;
+    }
+
+    void Flattener::flatten(schema::Module const& mod) {
+        assert(mod.root != nullptr);
+
+        std::vector<schema::Type const*> keptTypes;
+        std::vector<schema::Constant const*> keptConstants;
+        std::vector<schema::Namespace const*> keptNamespaces;
+        auto const& types = listed(mod.types, keptTypes);
+        auto const& constants = listed(mod.constants, keptConstants);
+        auto const& namespaces = listed(mod.namespaces, keptNamespaces);
+
+        // the listed records take the leading slots, in order, before any
+        // reference can add other records
+        reserve(types, typeIds, out.types, out.listedTypes);
+        reserve(constants, constantIds, out.constants, out.listedConstants);
+        reserve(namespaces, namespaceIds, out.namespaces, out.listedNamespaces);
+
+        for (Index slot = 0; slot != out.listedTypes.count; ++slot)
+            header(slot, *types[slot]);
+        for (Index slot = 0; slot != out.listedConstants.count; ++slot)
+            header(slot, *constants[slot]);
+        for (Index slot = 0; slot != out.listedNamespaces.count; ++slot)
+            header(slot, *namespaces[slot]);
+
+        // items are reserved as a contiguous run per listed enum
+        for (Index slot = 0; slot != out.listedTypes.count; ++slot) {
+            auto const* listedType = types[slot];
+            if (listedType->kind != schema::Type::Kind::Enum)
+                continue;
+
+            auto const& typeEnum = static_cast<schema::TypeEnum const&>(*listedType);
+            Range const items{ count(out.enumItems.size()), count(typeEnum.items.size()) };
+            for (auto const* enumItem : typeEnum.items)
+                item(enumItem);
+            out.types[slot].items = items;
+        }
+
+        out.name = mod.name;
+        out.location = mod.location;
+        out.filename = string(mod.filename.string());
+        out.moduleAnnotations = annotate(mod.annotations);
+        out.root = ns(mod.root);
+
+        out.imports.reserve(mod.imports.size());
+        for (auto const& imp : mod.imports) {
+            Import record;
+            record.name = imp.mod->name;
+            record.filename = string(imp.mod->filename.string());
+            record.location = imp.location;
+            record.annotations = annotate(imp.mod->annotations);
+            out.imports.push_back(record);
+        }
+
+        for (Index slot = 0; slot != out.listedTypes.count; ++slot)
+            fill(slot, *types[slot]);
+        for (Index slot = 0; slot != out.listedConstants.count; ++slot)
+            fill(slot, *constants[slot]);
+        for (Index slot = 0; slot != out.listedNamespaces.count; ++slot)
+            fill(slot, *namespaces[slot]);
+        if (out.root >= out.listedNamespaces.count)
+            fill(out.root, *mod.root);
+    }
+}
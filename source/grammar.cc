@@ -5,10 +5,10 @@
 #include "grammar.hh"
 #include "compiler.hh"
 #include "lexer.hh"
-#include "location.hh"
-#include "file_util.hh"
+#include "sapc/location.hh"
 #include "ast.hh"
 #include "log.hh"
+#include "symbol_pool.hh"
 
 #include <algorithm>
 #include <cassert>
@@ -40,20 +40,26 @@ namespace sapc {
             std::vector<Token> const& tokens;
             Log& log;
             fs::path const& filename;
-            ParserImportModuleCb const& importCallback;
+            std::uint32_t file = 0;
+            ImportedTags const& importedTags;
+            SymbolPool& symbols;
             ast::ModuleUnit& module;
             size_t next = 0;
-            std::vector<std::vector<std::unique_ptr<ast::Declaration>>*> scopeStack;
+            unsigned depth = 0; // namespaces, type arguments and list literals entered
+            std::vector<std::vector<ast::Declaration*>*> scopeStack;
             std::unordered_map<std::string_view, ast::CustomTagDecl const*> customTags;
             std::vector<ast::Annotation> annotations;
 
+            inline Location location(Token const& tok);
             inline Location pos();
 
             template <typename... T>
-            bool fail(std::string message, T const&... args);
+            bool fail(Code code, std::string message, T const&... args);
 
             inline bool match(TokenType type);
 
+            inline bool enter();
+
             inline bool consume(TokenType type);
             inline bool consume(std::initializer_list<TokenType> select);
 
@@ -63,7 +69,7 @@ namespace sapc {
             inline bool mustConsume(ast::Identifier& out);
             inline bool mustConsume(ast::QualifiedId& out);
             inline bool mustConsume(ast::Literal& out);
-            inline bool mustConsume(std::unique_ptr<ast::TypeRef>& type);
+            inline bool mustConsume(ast::TypeRef*& type);
             inline bool mustConsume(std::vector<ast::Annotation>& out_annotations);
 
             inline bool parseFile();
@@ -83,38 +89,36 @@ namespace sapc {
         };
     }
 
-    std::unique_ptr<ast::ModuleUnit> parse(std::filesystem::path const& filename, ParserImportModuleCb const& importCb, Log& log) {
+    std::unique_ptr<ast::ModuleUnit> parse(std::filesystem::path const& filename, std::uint32_t file, std::vector<Token> const& tokens, ImportedTags const& importedTags, SymbolPool& symbols, Log& log) {
         assert(!filename.empty());
-        assert(importCb);
-
-        std::string contents;
-        if (!loadText(filename, contents)) {
-            log.error({ filename }, "failed to open input");
-            return nullptr;
-        }
-
-        std::vector<Token> tokens;
-        if (!tokenize(contents, filename, tokens, log))
-            return nullptr;
+        assert(!tokens.empty());
 
         auto mod = std::make_unique<ast::ModuleUnit>();
         mod->filename = filename;
 
-        Grammar grammar{ tokens, log, filename, importCb, *mod };
+        Grammar grammar{ tokens, log, filename, file, importedTags, symbols, *mod };
         if (!grammar.parseFile())
             return nullptr;
 
         return mod;
     }
 
+    std::unique_ptr<ast::ModuleUnit> parse(std::filesystem::path const& filename, std::uint32_t file, std::string_view source, ImportedTags const& importedTags, SymbolPool& symbols, Log& log) {
+        std::vector<Token> tokens;
+        if (!tokenize(source, file, tokens, log))
+            return nullptr;
+
+        return parse(filename, file, tokens, importedTags, symbols, log);
+    }
+
     bool Grammar::parseFile() {
         scopeStack.push_back(&module.decls);
 
-        if (!parseScope(Location{ module.filename, {1, 0} }, TokenType::EndOfFile, ConfigModule))
+        if (!parseScope(Location{ file, 0, 0 }, TokenType::EndOfFile, ConfigModule))
             return false;
 
         if (module.name.empty())
-            return fail("missing module declaration");
+            return fail(Code::MissingModule, "missing module declaration");
 
         return true;
     }
@@ -122,8 +126,8 @@ namespace sapc {
     bool Grammar::parseScope(Location const& start, TokenType terminate, unsigned config) {
         while (!consume(terminate)) {
             if (consume(TokenType::EndOfFile)) {
-                log.error(pos(), "unexpected end of file");
-                log.info(start, "unclosed scope started here");
+                log.error(Code::UnexpectedEnd, pos(), "unexpected end of file");
+                log.info(Code::UnclosedScope, start, "unclosed scope started here");
                 return false;
             }
 
@@ -132,7 +136,7 @@ namespace sapc {
                 buf << "unexpected input";
                 if (next > 0)
                     buf << " after " << tokens[next - 1];
-                return fail(buf.str());
+                return fail(Code::UnexpectedInput, buf.str());
             }
 
             if ((config & AllowImport) != 0 && consume(TokenType::KeywordImport)) {
@@ -141,12 +145,10 @@ namespace sapc {
                 EXPECT(impDecl.target);
                 EXPECT(TokenType::SemiColon);
 
-                // Parse the imported module, which we need in order to find custom decls
-                auto const* const imported = importCallback(impDecl.target, filename);
-                if (imported != nullptr)
-                    for (auto const& decl : imported->decls)
-                        if (decl->kind == ast::Declaration::Kind::CustomTag)
-                            processCustomTag(*static_cast<ast::CustomTagDecl const*>(decl.get()));
+                // imports are parsed first, so their custom tags are known
+                if (auto const it = importedTags.find(impDecl.target.id); it != importedTags.end())
+                    for (auto const* customDecl : it->second)
+                        processCustomTag(*customDecl);
 
                 continue;
             }
@@ -223,10 +225,13 @@ namespace sapc {
                 EXPECT(nsDecl.name);
                 EXPECT(TokenType::LeftBrace);
 
+                if (!enter())
+                    return false;
                 scopeStack.push_back(&nsDecl.decls);
                 if (!parseScope(nsDecl.name.loc, TokenType::RightBrace, ConfigNamespace))
                     return false;
                 scopeStack.pop_back();
+                --depth;
 
                 continue;
             }
@@ -288,7 +293,7 @@ namespace sapc {
                 continue;
             }
 
-            return fail("unexpected ", tokens[next]);
+            return fail(Code::UnexpectedToken, "unexpected ", tokens[next]);
         }
 
         return true;
@@ -435,7 +440,7 @@ namespace sapc {
         else if (hasCustomTag(tag, ast::Declaration::Kind::Constant))
             return parseConstant(tag);
 
-        return fail("unexpected identifier `", tag, '`');
+        return fail(Code::UnexpectedToken, "unexpected identifier `", tag, '`');
     }
 
     bool Grammar::match(TokenType type) {
@@ -448,6 +453,14 @@ namespace sapc {
         return true;
     }
 
+    bool Grammar::enter() {
+        if (depth == maxNestingDepth)
+            return fail(Code::NestingDepth, "nested more than ", maxNestingDepth, " deep");
+
+        ++depth;
+        return true;
+    }
+
     bool Grammar::consume(TokenType type) {
         if (!match(type))
             return false;
@@ -463,16 +476,17 @@ namespace sapc {
         return false;
     }
 
+    Location Grammar::location(Token const& tok) {
+        return Location{ file, tok.offset, tok.offset + tok.length };
+    }
+
     Location Grammar::pos() {
-        auto const& tok = next > 0 ? tokens[next - 1] : tokens.front();
-        return Location{ filename, tok.start, tok.end };
+        return location(next > 0 ? tokens[next - 1] : tokens.front());
     }
 
     template <typename... T>
-    bool Grammar::fail(std::string message, T const&... args) {
-        auto const& tok = next < tokens.size() ? tokens[next] : tokens.back();
-        Location const loc{ filename, tok.start, tok.end };
-        log.error(loc, message, args...);
+    bool Grammar::fail(Code code, std::string message, T const&... args) {
+        log.error(code, location(next < tokens.size() ? tokens[next] : tokens.back()), message, args...);
         return false;
     };
 
@@ -486,7 +500,7 @@ namespace sapc {
             buf << " after " << tokens[next - 1];
         if (next < tokens.size())
             buf << ", got " << tokens[next];
-        return fail(buf.str());
+        return fail(Code::Expected, buf.str());
     }
 
     bool Grammar::mustConsume(std::initializer_list<TokenType> select) {
@@ -503,7 +517,7 @@ namespace sapc {
             buf << " after " << tokens[next - 1];
         if (next < tokens.size())
             buf << ", got " << tokens[next];
-        return fail(buf.str());
+        return fail(Code::Expected, buf.str());
     }
 
     bool Grammar::mustConsume(long long& out) {
@@ -519,7 +533,7 @@ namespace sapc {
             buf << " after " << tokens[next - 1];
         if (next < tokens.size())
             buf << ", got " << tokens[next];
-        return fail(buf.str());
+        return fail(Code::Expected, buf.str());
     }
 
     bool Grammar::mustConsume(ast::Literal& out) {
@@ -537,7 +551,8 @@ namespace sapc {
         }
         else if (consume(TokenType::String)) {
             out.loc = pos();
-            out.data = tokens[next - 1].dataString;
+            auto const& token = tokens[next - 1];
+            out.data = token.hasEscapes ? unescape(token.dataString) : std::string{ token.dataString };
         }
         else if (consume(TokenType::Number)) {
             out.loc = pos();
@@ -551,6 +566,8 @@ namespace sapc {
         }
         else if (consume(TokenType::LeftBrace)) {
             out.loc = pos();
+            if (!enter())
+                return false;
             std::vector<ast::Literal> values;
             if (!consume(TokenType::RightBrace)) {
                 for (;;) {
@@ -560,6 +577,7 @@ namespace sapc {
                 }
                 EXPECT(TokenType::RightBrace);
             }
+            --depth;
             out.data = std::move(values);
         }
         else {
@@ -569,7 +587,7 @@ namespace sapc {
                 buf << " after " << tokens[next - 1];
             if (next < tokens.size())
                 buf << ", got " << tokens[next];
-            return fail(buf.str());
+            return fail(Code::Expected, buf.str());
         }
         return true;
     }
@@ -583,10 +601,10 @@ namespace sapc {
                 buf << " after " << tokens[next - 1];
             if (next < tokens.size())
                 buf << ", got " << tokens[next];
-            return fail(buf.str());
+            return fail(Code::Expected, buf.str());
         }
 
-        out.id = tokens[index].dataString;
+        out.id = symbols.intern(tokens[index].dataString);
         out.loc = pos();
         return true;
     }
@@ -602,51 +620,54 @@ namespace sapc {
         return true;
     }
 
-    bool Grammar::mustConsume(std::unique_ptr<ast::TypeRef>& type) {
+    bool Grammar::mustConsume(ast::TypeRef*& type) {
         if (consume(TokenType::KeywordTypename)) {
-            auto tref = std::make_unique<ast::TypeRef>();
+            auto* const tref = module.arena.create<ast::TypeRef>();
             tref->kind = ast::TypeRef::Kind::TypeName;
             tref->loc = pos();
-            type = std::move(tref);
+            type = tref;
         }
         else
         {
-            auto name = std::make_unique<ast::TypeRef>();
+            auto* const name = module.arena.create<ast::TypeRef>();
             name->kind = ast::TypeRef::Kind::Name;
             EXPECT(name->name);
             name->loc = name->name.components.front().loc;
             if (name->name.components.size() > 1)
                 name->loc.merge(name->name.components.back().loc);
-            type = std::move(name);
+            type = name;
 
             if (consume(TokenType::LeftAngle)) {
-                auto gen = std::make_unique<ast::TypeRef>();
+                auto* const gen = module.arena.create<ast::TypeRef>();
                 gen->kind = ast::TypeRef::Kind::Generic;
                 gen->loc = type->loc;
+                if (!enter())
+                    return false;
                 EXPECT(gen->typeArgs.emplace_back());
                 while (consume(TokenType::Comma))
                     EXPECT(gen->typeArgs.emplace_back());
                 EXPECT(TokenType::RightAngle);
+                --depth;
                 gen->loc.merge(pos());
-                gen->ref = std::move(type);
-                type = std::move(gen);
+                gen->ref = type;
+                type = gen;
             }
         }
 
         if (consume(TokenType::Asterisk)) {
-            auto ptr = std::make_unique<ast::TypeRef>();
+            auto* const ptr = module.arena.create<ast::TypeRef>();
             ptr->kind = ast::TypeRef::Kind::Pointer;
             ptr->loc = type->loc;
             ptr->loc.merge(pos());
-            ptr->ref = std::move(type);
-            type = std::move(ptr);
+            ptr->ref = type;
+            type = ptr;
         }
 
         if (consume(TokenType::LeftBracket)) {
-            auto arr = std::make_unique<ast::TypeRef>();
+            auto* const arr = module.arena.create<ast::TypeRef>();
             arr->kind = ast::TypeRef::Kind::Array;
             arr->loc = type->loc;
-            arr->ref = std::move(type);
+            arr->ref = type;
 
             if (match(TokenType::Number)) {
                 long long arraySize = 0;
@@ -656,7 +677,7 @@ namespace sapc {
 
             EXPECT(TokenType::RightBracket);
             arr->loc.merge(pos());
-            type = std::move(arr);
+            type = arr;
         }
         return true;
     }
@@ -691,12 +712,10 @@ namespace sapc {
     DeclT& Grammar::begin() {
         assert(!scopeStack.empty());
 
-        auto decl = std::make_unique<DeclT>();
-        auto* const ret = decl.get();
-
-        scopeStack.back()->push_back(move(decl));
+        auto* const decl = module.arena.create<DeclT>();
+        scopeStack.back()->push_back(decl);
 
-        return *ret;
+        return *decl;
     }
 
     bool Grammar::hasCustomTag(std::string_view tag, ast::Declaration::Kind kind) const {
@@ -705,6 +724,6 @@ namespace sapc {
     }
 
     void Grammar::processCustomTag(ast::CustomTagDecl const& customDecl) {
-        customTags.insert({ customDecl.name.id, &customDecl });
+        customTags.insert({ customDecl.name.id.str(), &customDecl });
     }
 }
@@ -5,20 +5,36 @@
 #pragma once
 
 #include "lexer.hh"
+#include "sapc/symbol.hh"
 
 #include <memory>
 #include <filesystem>
-#include <functional>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace sapc {
     struct Log;
+    struct SymbolPool;
     namespace ast {
         struct ModuleUnit;
-        struct Identifier;
+        struct CustomTagDecl;
     }
 
-    using ParserImportModuleCb = std::function<ast::ModuleUnit const* (ast::Identifier const& id, std::filesystem::path const& requestingFile)>;
+    // the custom tags declared by each imported module, by module name; a
+    // module's tags may be used after the declaration importing it
+    using ImportedTags = std::unordered_map<Symbol, std::vector<ast::CustomTagDecl const*>>;
 
-    std::unique_ptr<ast::ModuleUnit> parse(std::filesystem::path const& filename, ParserImportModuleCb const& importCb, Log& log);
+    // namespaces, type arguments, and list literals nested deeper than this
+    // are an error, which bounds the recursion of every later stage
+    constexpr unsigned maxNestingDepth = 256;
+
+    // tokens must have been produced from the file registered as `file';
+    // names are interned in symbols, which must outlive the syntax tree
+    std::unique_ptr<ast::ModuleUnit> parse(std::filesystem::path const& filename, std::uint32_t file, std::vector<Token> const& tokens, ImportedTags const& importedTags, SymbolPool& symbols, Log& log);
+
+    // tokenizes and parses a source held in memory, which must outlive the
+    // syntax tree; returns null if either fails
+    std::unique_ptr<ast::ModuleUnit> parse(std::filesystem::path const& filename, std::uint32_t file, std::string_view source, ImportedTags const& importedTags, SymbolPool& symbols, Log& log);
 }
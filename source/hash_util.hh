@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <string_view>
 
 namespace sapc {
     // https://stackoverflow.com/questions/2590677/how-do-i-combine-hash-values-in-c0x
@@ -13,4 +15,13 @@ namespace sapc {
     {
         return seed ^ ((H{}(val)) + 0x9e3779b9 + (seed << 6) + (seed >> 2));
     }
+
+    // FNV-1a; unlike std::hash, stable across runs and platforms
+    constexpr std::uint64_t hash_fnv1a(std::string_view data, std::uint64_t seed = 0xcbf29ce484222325ull) noexcept {
+        for (char const ch : data) {
+            seed ^= static_cast<unsigned char>(ch);
+            seed *= 0x100000001b3ull;
+        }
+        return seed;
+    }
 }
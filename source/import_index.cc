@@ -0,0 +1,134 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "import_index.hh"
+#include "stats.hh"
+#include "string_util.hh"
+
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // the default file systems of Windows and macOS ignore case
+    std::string foldCase(std::string name) {
+#if defined(_WIN32) || defined(__APPLE__)
+        for (auto& ch : name)
+            if (ch >= 'A' && ch <= 'Z')
+                ch = static_cast<char>(ch - 'A' + 'a');
+#endif
+        return name;
+    }
+
+    // spellings of the same directory share one listing
+    fs::path directoryKey(fs::path const& path) {
+        std::error_code ec;
+        auto key = fs::absolute(path.empty() ? fs::path{ "." } : path, ec).lexically_normal();
+        if (!key.has_filename() && key.has_relative_path())
+            key = key.parent_path();
+        return key;
+    }
+
+    fs::file_time_type directoryTime(fs::path const& path) {
+        std::error_code ec;
+        auto const timestamp = fs::last_write_time(path, ec);
+        return ec ? fs::file_time_type::min() : timestamp;
+    }
+}
+
+namespace sapc {
+    ImportIndex::Resolution ImportIndex::resolve(std::string_view moduleName, fs::path const& importer, Stats* stats) {
+        auto const basename = fs::path{ moduleName }.replace_extension(".sap");
+        auto const base = importer.parent_path();
+
+        std::string key = base.string();
+        key += '\n';
+        key += moduleName;
+
+        std::lock_guard lock(mutex);
+
+        if (auto const it = resolved.find(key); it != resolved.end()) {
+            if (stats != nullptr)
+                ++stats->importHits;
+            return it->second;
+        }
+        if (stats != nullptr)
+            ++stats->importMisses;
+
+        auto const contains = [&](fs::path const& dir) {
+            auto const candidate = dir / basename;
+            return directory(candidate.parent_path(), stats).files.count(foldCase(candidate.filename().string())) != 0;
+        };
+
+        Resolution result;
+        if (contains(base))
+            result.filename = base / basename;
+
+        // a search path only hides another when both hold the module; the
+        // same directory listed twice hides nothing
+        fs::path found;
+        for (auto const& path : searchPaths) {
+            if (!contains(path))
+                continue;
+            if (result.filename.empty()) {
+                result.filename = path / basename;
+                found = directoryKey(path);
+            }
+            else if (!found.empty() && directoryKey(path) != found)
+                result.shadowed.push_back(path / basename);
+        }
+
+        return resolved.emplace(std::move(key), std::move(result)).first->second;
+    }
+
+    bool ImportIndex::setSearchPaths(std::vector<fs::path> const& paths) {
+        std::lock_guard lock(mutex);
+        if (paths == searchPaths)
+            return false;
+
+        searchPaths = paths;
+        resolved.clear();
+        return true;
+    }
+
+    void ImportIndex::refresh() {
+        std::lock_guard lock(mutex);
+
+        // adding, removing, or renaming a file changes its directory's time
+        bool changed = false;
+        for (auto it = directories.begin(); it != directories.end();) {
+            if (directoryTime(it->first) != it->second.timestamp) {
+                it = directories.erase(it);
+                changed = true;
+            }
+            else
+                ++it;
+        }
+
+        if (changed)
+            resolved.clear();
+    }
+
+    ImportIndex::Directory const& ImportIndex::directory(fs::path const& path, Stats* stats) {
+        auto key = directoryKey(path);
+        if (auto const it = directories.find(key); it != directories.end())
+            return it->second;
+
+        if (stats != nullptr)
+            ++stats->directoriesListed;
+
+        // stamped before listing, so a concurrent change is seen by refresh
+        Directory listing;
+        listing.timestamp = directoryTime(key);
+
+        std::error_code ec;
+        for (fs::directory_iterator it(key, ec), end; !ec && it != end; it.increment(ec)) {
+            auto name = foldCase(it->path().filename().string());
+            if (ends_with(name, ".sap"))
+                listing.files.insert(std::move(name));
+        }
+
+        return directories.emplace(std::move(key), std::move(listing)).first->second;
+    }
+}
@@ -0,0 +1,55 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "file_util.hh"
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace sapc {
+    struct Stats;
+
+    // Resolves imported module names to files. Each directory searched is
+    // listed once and the names of the .sap files in it are kept, so that
+    // resolving an import makes no file system calls; results are cached by
+    // module name and importing directory for the life of the context.
+    struct ImportIndex {
+        struct Resolution {
+            std::filesystem::path filename; // empty if the module wasn't found
+            std::vector<std::filesystem::path> shadowed; // files of the module in later search paths, hidden by the one found
+        };
+
+        struct Directory {
+            std::filesystem::file_time_type timestamp;
+            std::unordered_set<std::string> files;
+        };
+
+        // Thread-safe; the importer's directory is searched first, then the
+        // search paths in order
+        Resolution resolve(std::string_view moduleName, std::filesystem::path const& importer, Stats* stats);
+
+        // Forgets every earlier result if the paths differ from those they
+        // were resolved with, returning true in that case
+        bool setSearchPaths(std::vector<std::filesystem::path> const& paths);
+
+        // Forgets the listings of directories whose entries have changed
+        // since they were listed, and every result that may depend on them
+        void refresh();
+
+        // the listing of a directory, listing it now if needed; requires the lock
+        Directory const& directory(std::filesystem::path const& path, Stats* stats);
+
+        std::mutex mutex;
+        std::vector<std::filesystem::path> searchPaths;
+        std::unordered_map<std::filesystem::path, Directory, PathHash> directories; // by absolute, normalized path
+        std::unordered_map<std::string, Resolution> resolved; // by importing directory and module name
+    };
+}
@@ -3,275 +3,461 @@
 // See LICENSE.md for more details.
 
 #include "json.hh"
-#include "schema.hh"
+#include "sapc/flat.hh"
+
+#include <cassert>
+#include <charconv>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace sapc {
-    template <typename JsonT>
-    void to_json(JsonT& j, Location const& loc);
-
-    namespace schema {
-        template <typename JsonT>
-        void to_json(JsonT& j, Value const& value);
-        template <typename JsonT>
-        void to_json(JsonT& j, std::vector<Value> const& value);
-        template <typename JsonT>
-        void to_json(JsonT& j, Type::Kind value);
-        template <typename JsonT>
-        void to_json(JsonT& j, Type const& type);
-        template <typename JsonT>
-        void to_json(JsonT& j, Constant const& constant);
-        template <typename JsonT>
-        void to_json(JsonT& j, Namespace const& ns);
-        template <typename JsonT>
-        void to_json(JsonT& j, Annotation const& value);
-        template <typename JsonT>
-        void to_json(JsonT& j, std::vector<std::unique_ptr<Annotation>> const& values);
-    }
+    namespace {
+        // Emits JSON text into a buffer that is flushed to the stream in
+        // large blocks; the layout matches a 4-space indented dump, or a
+        // dump without any whitespace when compact
+        struct JsonWriter {
+            static constexpr size_t flushSize = 64 * 1024;
+            static constexpr int indentWidth = 4;
+
+            JsonWriter(std::ostream& os, bool compact) : os(os), compact(compact) { buffer.reserve(flushSize + 4096); }
+            ~JsonWriter() { flush(); }
+
+            JsonWriter(JsonWriter const&) = delete;
+            JsonWriter& operator=(JsonWriter const&) = delete;
+
+            void beginObject() { beginScope('{'); }
+            void endObject() { endScope('}'); }
+            void beginArray() { beginScope('['); }
+            void endArray() { endScope(']'); }
+
+            void key(std::string_view name) {
+                separate();
+                string(name);
+                buffer += compact ? ":" : ": ";
+                afterKey = true;
+            }
 
-    template <typename JsonT>
-    void to_json(JsonT& j, Location const& loc) {
-        j = JsonT::object();
-        j["filename"] = loc.filename.string();
-        if (loc.start.line > 0)
-            j["line"] = loc.start.line;
-        if (loc.start.column)
-            j["column"] = loc.start.column;
-        if (loc.end.line > 0 && loc.end.line != loc.start.line)
-            j["lineEnd"] = loc.end.line;
-        if (loc.end.line >= loc.start.line && loc.end.column != loc.start.column)
-            j["columnEnd"] = loc.end.column;
-    };
-
-    template <typename JsonT>
-    void schema::to_json(JsonT& j, std::vector<Value> const& value) {
-        j = JsonT::array();
-        for (Value const& val : value) {
-            j.push_back(val);
-        }
-    }
+            void value(std::nullptr_t) { separate(); buffer += "null"; }
+            void value(bool val) { separate(); buffer += val ? "true" : "false"; }
+            void value(long long val) { separate(); integer(val); }
+            void value(int val) { separate(); integer(val); }
+            void value(std::string_view val) { separate(); string(val); }
+            void value(char const* val) { value(std::string_view{ val }); }
+            void value(Symbol val) { value(val.str()); }
+
+            template <typename T>
+            void member(std::string_view name, T const& val) {
+                key(name);
+                value(val);
+            }
 
-    template <typename JsonT>
-    void schema::to_json(JsonT& j, Value const& value) {
-        std::visit([&j](auto const& val) {
-            using T = std::remove_cv_t<std::remove_reference_t<decltype(val)>>;
-            if constexpr (std::is_same_v<T, schema::Type const*>) {
-                assert(val != nullptr);
-                j = JsonT::object();
-                j["kind"] = "typename";
-                j["type"] = val->qualifiedName;
+            void beginScope(char open) {
+                separate();
+                buffer += open;
+                scopes.push_back(true);
             }
-            else if constexpr (std::is_same_v<T, schema::EnumItem const*>) {
-                assert(val != nullptr);
-                j = JsonT::object();
-                j["kind"] = "enum";
-                j["type"] = val->parent->name;
-                j["name"] = val->name;
-                j["value"] = val->value;
+
+            void endScope(char close) {
+                assert(!scopes.empty());
+                bool const empty = scopes.back();
+                scopes.pop_back();
+                if (!empty)
+                    newline();
+                buffer += close;
+
+                if (buffer.size() >= flushSize)
+                    flush();
+            }
+
+            // emits the separator and indentation that precede a value or key
+            void separate() {
+                if (afterKey) {
+                    afterKey = false;
+                    return;
+                }
+                if (scopes.empty())
+                    return;
+
+                if (!scopes.back())
+                    buffer += ',';
+                scopes.back() = false;
+                newline();
             }
-            else if constexpr (std::is_same_v<T, std::vector<schema::Value>>) {
-                j = JsonT::array();
-                for (auto const& elem : val)
-                    j.push_back(elem);
+
+            void newline() {
+                if (compact)
+                    return;
+                buffer += '\n';
+                buffer.append(scopes.size() * indentWidth, ' ');
             }
-            else {
-                j = val;
+
+            template <typename IntT>
+            void integer(IntT val) {
+                char digits[24];
+                auto const result = std::to_chars(digits, digits + sizeof(digits), val);
+                buffer.append(digits, result.ptr);
             }
-            }, value.data);
+
+            void string(std::string_view text) {
+                static constexpr char hex[] = "0123456789abcdef";
+
+                buffer += '"';
+                for (char const ch : text) {
+                    switch (ch) {
+                    case '"': buffer += "\\\""; break;
+                    case '\\': buffer += "\\\\"; break;
+                    case '\b': buffer += "\\b"; break;
+                    case '\f': buffer += "\\f"; break;
+                    case '\n': buffer += "\\n"; break;
+                    case '\r': buffer += "\\r"; break;
+                    case '\t': buffer += "\\t"; break;
+                    default:
+                        if (static_cast<unsigned char>(ch) < 0x20) {
+                            buffer += "\\u00";
+                            buffer += hex[(ch >> 4) & 0xF];
+                            buffer += hex[ch & 0xF];
+                        }
+                        else
+                            buffer += ch;
+                        break;
+                    }
+                }
+                buffer += '"';
+            }
+
+            void flush() {
+                os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+
+            std::ostream& os;
+            std::string buffer;
+            std::vector<bool> scopes; // true until the scope has its first member
+            bool afterKey = false;
+            bool compact = false;
+        };
+
+        struct Serializer {
+            JsonWriter& out;
+            flat::Module const& mod;
+            FileTable const& files;
+            JsonOptions const& options;
+            std::unordered_map<std::uint32_t, int> fileIndices;
+            std::vector<std::uint32_t> fileOrder;
+
+            void write();
+            void location(Location const& loc);
+            void write(Location const& loc);
+            void write(flat::Value const& value);
+            void write(flat::Range annotations);
+            void write(flat::Annotation const& annotation);
+            void write(flat::Type const& type);
+            void writeFields(flat::Range fields);
+            void write(flat::Constant const& constant);
+            void write(flat::Namespace const& ns);
+            void writeScope(flat::Index scope);
+
+            template <typename T>
+            void member(std::string_view name, T const& val) {
+                out.key(name);
+                write(val);
+            }
+        };
+
+        char const* kindName(schema::Type::Kind kind) {
+            using Kind = schema::Type::Kind;
+            switch (kind) {
+            case Kind::Simple: return "simple";
+            case Kind::Attribute: return "attribute";
+            case Kind::TypeParam: return "typeparam";
+            case Kind::Specialized: return "specialized";
+            case Kind::Enum: return "enum";
+            case Kind::Alias: return "alias";
+            case Kind::Struct: return "struct";
+            case Kind::Union: return "union";
+            case Kind::TypeId: return "typename";
+            case Kind::Array: return "array";
+            case Kind::Pointer: return "pointer";
+            default: assert(false && "unknown type kind"); return nullptr;
+            }
+        }
     }
 
-    nlohmann::ordered_json serializeToJson(schema::Module const& mod) {
-        using JsonT = nlohmann::ordered_json;
+    void serializeToJson(std::ostream& os, flat::Module const& mod, FileTable const& files, JsonOptions const& options) {
+        JsonWriter writer(os, options.compact);
+        Serializer{ writer, mod, files, options }.write();
+    }
 
-        auto doc = JsonT::object();
+    void Serializer::write() {
+        out.beginObject();
 
-        doc["$schema"] = "https://raw.githubusercontent.com/potatoengine/sapc/master/schema/sap-1.schema.json";
+        out.member("$schema", "https://raw.githubusercontent.com/potatoengine/sapc/master/schema/sap-1.schema.json");
 
-        auto mod_json = JsonT::object();
-        mod_json["name"] = mod.name;
-        mod_json["annotations"] = mod.annotations;
-        auto imports_json = JsonT::array();
+        out.key("module");
+        out.beginObject();
+        out.member("name", mod.name);
+        member("annotations", mod.moduleAnnotations);
+        out.key("imports");
+        out.beginArray();
         for (auto const& imp : mod.imports) {
-            auto import_json = JsonT::object();
-            import_json["name"] = imp.mod->name;
-            import_json["filename"] = imp.mod->location.filename.string();
-            import_json["annotations"] = imp.mod->annotations;
-            import_json["location"] = imp.location;
-            imports_json.push_back(std::move(import_json));
+            out.beginObject();
+            out.member("name", imp.name);
+            out.member("filename", mod.strings[imp.filename]);
+            member("annotations", imp.annotations);
+            location(imp.location);
+            out.endObject();
+        }
+        out.endArray();
+        out.endObject();
+
+        out.key("types");
+        out.beginArray();
+        for (auto const& type : mod.slice(mod.types, mod.listedTypes))
+            write(type);
+        out.endArray();
+
+        out.key("constants");
+        out.beginArray();
+        for (auto const& constant : mod.slice(mod.constants, mod.listedConstants))
+            write(constant);
+        out.endArray();
+
+        out.key("namespaces");
+        out.beginArray();
+        for (auto const& ns : mod.slice(mod.namespaces, mod.listedNamespaces))
+            write(ns);
+        out.endArray();
+
+        // the table is written last so that indices can be assigned as files are first referenced
+        if (options.locations == JsonOptions::Locations::Files) {
+            out.key("files");
+            out.beginArray();
+            for (auto const file : fileOrder)
+                out.value(files.path(file).string());
+            out.endArray();
         }
-        mod_json["imports"] = std::move(imports_json);
-        doc["module"] = std::move(mod_json);
 
-        auto types_json = JsonT::array();
-        for (auto const* type : mod.types)
-            types_json.push_back(*type);
-        doc["types"] = std::move(types_json);
+        out.endObject();
+    }
+
+    void Serializer::location(Location const& loc) {
+        if (options.locations == JsonOptions::Locations::None)
+            return;
 
-        auto constants_json = JsonT::array();
-        for (auto const* constant : mod.constants)
-            constants_json.push_back(*constant);
-        doc["constants"] = std::move(constants_json);
+        out.key("location");
+        write(loc);
+    }
 
-        auto namespaces_json = JsonT::array();
-        for (auto const* ns : mod.namespaces)
-            namespaces_json.push_back(*ns);
-        doc["namespaces"] = std::move(namespaces_json);
+    void Serializer::write(Location const& loc) {
+        auto const start = files.position(loc.file, loc.start);
+        auto const end = files.position(loc.file, loc.end);
 
-        return doc;
+        out.beginObject();
+        if (options.locations == JsonOptions::Locations::Files) {
+            auto const [it, inserted] = fileIndices.emplace(loc.file, static_cast<int>(fileOrder.size()));
+            if (inserted)
+                fileOrder.push_back(loc.file);
+            out.member("file", it->second);
+        }
+        else
+            out.member("filename", files.path(loc.file).string());
+        if (start.line > 0)
+            out.member("line", start.line);
+        if (start.column)
+            out.member("column", start.column);
+        if (end.line > 0 && end.line != start.line)
+            out.member("lineEnd", end.line);
+        if (end.line >= start.line && end.column != start.column)
+            out.member("columnEnd", end.column);
+        out.endObject();
     }
 
-    template <typename JsonT>
-    void schema::to_json(JsonT& j, Type::Kind value) {
-        switch (value) {
-        case Type::Kind::Simple: j = "simple"; break;
-        case Type::Kind::Attribute: j = "attribute"; break;
-        case Type::Kind::TypeParam: j = "typeparam"; break;
-        case Type::Kind::Specialized: j = "specialized"; break;
-        case Type::Kind::Enum: j = "enum"; break;
-        case Type::Kind::Alias: j = "alias"; break;
-        case Type::Kind::Struct: j = "struct"; break;
-        case Type::Kind::Union: j = "union"; break;
-        case Type::Kind::TypeId: j = "typename"; break;
-        case Type::Kind::Array: j = "array"; break;
-        case Type::Kind::Pointer: j = "pointer"; break;
-        default: assert(false && "unknown type kind"); break;
+    void Serializer::write(flat::Value const& value) {
+        switch (value.kind) {
+        case flat::ValueKind::Null: out.value(nullptr); break;
+        case flat::ValueKind::Bool: out.value(value.number != 0); break;
+        case flat::ValueKind::Integer: out.value(value.number); break;
+        case flat::ValueKind::String: out.value(mod.strings[value.index]); break;
+        case flat::ValueKind::TypeName:
+            out.beginObject();
+            out.member("kind", "typename");
+            out.member("type", mod.types[value.index].qualifiedName);
+            out.endObject();
+            break;
+        case flat::ValueKind::Enum: {
+            auto const& item = mod.enumItems[value.index];
+            out.beginObject();
+            out.member("kind", "enum");
+            out.member("type", mod.types[item.parent].name);
+            out.member("name", item.name);
+            out.member("value", item.value);
+            out.endObject();
+            break;
         }
-    };
-
-    template <typename JsonT>
-    void schema::to_json(JsonT& type_json, Type const& type) {
-        assert(type.scope != nullptr);
-        assert(type.scope->owner != nullptr);
-
-        type_json = JsonT::object();
-
-        type_json["name"] = type.name;
-        type_json["qualified"] = type.qualifiedName;
-        type_json["module"] = type.scope->owner->name;
-        if (!type.scope->name.empty())
-            type_json["namespace"] = type.scope->qualifiedName;
-        type_json["kind"] = type.kind;
-        type_json["annotations"] = type.annotations;
-
-        if (type.kind == Type::Kind::Enum) {
-            auto& typeEnum = static_cast<TypeEnum const&>(type);
-
-            auto items_json = JsonT::array();
-            for (auto const& item : typeEnum.items) {
-                auto item_json = JsonT::object();
-                item_json["name"] = item->name;
-                item_json["value"] = item->value;
-                items_json.push_back(std::move(item_json));
-            }
-            type_json["items"] = std::move(items_json);
+        case flat::ValueKind::Array:
+            out.beginArray();
+            for (auto const& elem : mod.slice(mod.values, value.elements))
+                write(elem);
+            out.endArray();
+            break;
         }
-        else if (type.kind == Type::Kind::Struct || type.kind == Type::Kind::Union || type.kind == Type::Kind::Attribute) {
-            auto& typeAggr = static_cast<TypeAggregate const&>(type);
+    }
 
-            if (typeAggr.baseType != nullptr)
-                type_json["base"] = typeAggr.baseType->qualifiedName;
+    void Serializer::write(flat::Range annotations) {
+        out.beginArray();
+        for (auto const& annotation : mod.slice(mod.annotations, annotations))
+            write(annotation);
+        out.endArray();
+    }
 
-            if (!typeAggr.typeParams.empty()) {
-                auto type_params_json = JsonT::array();
-                for (auto const* typeParam : typeAggr.typeParams)
-                    type_params_json.push_back(typeParam->name);
-                type_json["typeParams"] = std::move(type_params_json);
-            }
+    void Serializer::write(flat::Annotation const& annotation) {
+        auto const& type = mod.types[annotation.type];
+        assert(type.kind == schema::Type::Kind::Attribute);
 
-            auto fields = JsonT::array();
-            for (auto const& field : typeAggr.fields) {
-                auto field_json = JsonT::object();
-                field_json["name"] = field->name;
-                field_json["type"] = field->type->qualifiedName;
-                if (field->defaultValue)
-                    field_json["default"] = *field->defaultValue;
-                field_json["annotations"] = field->annotations;
-                field_json["location"] = field->location;
-
-                fields.push_back(std::move(field_json));
-            }
-            type_json["fields"] = std::move(fields);
-        }
-        else if (type.kind == Type::Kind::Array || type.kind == Type::Kind::Pointer || type.kind == Type::Kind::Alias) {
-            auto& typeInd = static_cast<TypeIndirect const&>(type);
+        out.beginObject();
+        out.member("type", type.qualifiedName);
+        location(annotation.location);
+
+        out.key("args");
+        out.beginArray();
+        for (auto const& arg : mod.slice(mod.values, annotation.args))
+            write(arg);
+        out.endArray();
+
+        out.endObject();
+    }
+
+    // the owning module, and the enclosing namespace unless it is the root
+    void Serializer::writeScope(flat::Index scope) {
+        assert(scope != flat::none);
+        auto const& ns = mod.namespaces[scope];
+        out.member("module", ns.module);
+        if (!ns.name.empty())
+            out.member("namespace", ns.qualifiedName);
+    }
 
-            if (typeInd.refType != nullptr)
-                type_json["refType"] = typeInd.refType->qualifiedName;
+    void Serializer::write(flat::Type const& type) {
+        using Kind = schema::Type::Kind;
 
-            if (typeInd.arraySize)
-                type_json["length"] = *typeInd.arraySize;
+        out.beginObject();
+
+        out.member("name", type.name);
+        out.member("qualified", type.qualifiedName);
+        writeScope(type.scope);
+        out.member("kind", kindName(type.kind));
+        member("annotations", type.annotations);
+
+        if (type.kind == Kind::Enum) {
+            if (type.refType != flat::none)
+                out.member("base", mod.types[type.refType].qualifiedName);
+
+            out.key("items");
+            out.beginArray();
+            for (auto const& item : mod.slice(mod.enumItems, type.items)) {
+                out.beginObject();
+                out.member("name", item.name);
+                out.member("value", item.value);
+                out.endObject();
+            }
+            out.endArray();
         }
-        else if (type.kind == Type::Kind::Specialized) {
-            auto& typeInd = static_cast<TypeIndirect const&>(type);
+        else if (type.kind == Kind::Struct || type.kind == Kind::Union || type.kind == Kind::Attribute) {
+            if (type.refType != flat::none)
+                out.member("base", mod.types[type.refType].qualifiedName);
+
+            if (type.typeParams.count != 0) {
+                out.key("typeParams");
+                out.beginArray();
+                for (auto const typeParam : mod.refsOf(type.typeParams))
+                    out.value(mod.types[typeParam].name);
+                out.endArray();
+            }
 
-            type_json["refType"] = typeInd.refType->qualifiedName;
+            writeFields(type.fields);
+        }
+        else if (type.kind == Kind::Array || type.kind == Kind::Pointer || type.kind == Kind::Alias) {
+            if (type.refType != flat::none)
+                out.member("refType", mod.types[type.refType].qualifiedName);
 
-            auto type_args_json = JsonT::array();
-            for (auto const* typeArg : typeInd.typeArgs)
-                type_args_json.push_back(typeArg->qualifiedName);
-            type_json["typeArgs"] = std::move(type_args_json);
+            if (type.arraySize)
+                out.member("length", *type.arraySize);
+        }
+        else if (type.kind == Kind::Specialized) {
+            out.member("refType", mod.types[type.refType].qualifiedName);
+
+            out.key("typeArgs");
+            out.beginArray();
+            for (auto const typeArg : mod.refsOf(type.typeArgs))
+                out.value(mod.types[typeArg].qualifiedName);
+            out.endArray();
+
+            // only instantiated specializations list fields
+            if (type.fields.count != 0)
+                writeFields(type.fields);
         }
 
-        type_json["location"] = type.location;
-    }
+        location(type.location);
 
-    template <typename JsonT>
-    void schema::to_json(JsonT& const_json, Constant const& constant) {
-        const_json = JsonT::object();
-        const_json["name"] = constant.name;
-        const_json["qualified"] = constant.qualifiedName;
-        const_json["module"] = constant.scope->owner->name;
-        if (!constant.scope->name.empty())
-            const_json["namespace"] = constant.scope->qualifiedName;
-        const_json["type"] = constant.type->name;
-        const_json["value"] = constant.value;
-        const_json["annotations"] = constant.annotations;
-        const_json["location"] = constant.location;
+        out.endObject();
     }
 
-    template <typename JsonT>
-    void schema::to_json(JsonT& ns_json, Namespace const& ns) {
-        ns_json = JsonT::object();
-        ns_json["name"] = ns.name;
-        ns_json["qualified"] = ns.qualifiedName;
-        ns_json["module"] = ns.owner->name;
-        if (!ns.parent->name.empty())
-            ns_json["namespace"] = ns.parent->qualifiedName;
-
-        auto types_json = JsonT::array();
-        for (auto const* type : ns.types)
-            types_json.push_back(type->qualifiedName);
-        ns_json["types"] = std::move(types_json);
-
-        auto constants_json = JsonT::array();
-        for (auto const* constant : ns.constants)
-            constants_json.push_back(constant->qualifiedName);
-        ns_json["constants"] = std::move(constants_json);
-
-        auto namespaces_json = JsonT::array();
-        for (auto const* subNamespace : ns.namespaces)
-            namespaces_json.push_back(subNamespace->qualifiedName);
-        ns_json["namespaces"] = std::move(namespaces_json);
+    void Serializer::writeFields(flat::Range fields) {
+        out.key("fields");
+        out.beginArray();
+        for (auto const& field : mod.slice(mod.fields, fields)) {
+            out.beginObject();
+            out.member("name", field.name);
+            out.member("type", mod.types[field.type].qualifiedName);
+            if (field.defaultValue != flat::none)
+                member("default", mod.values[field.defaultValue]);
+            member("annotations", field.annotations);
+            location(field.location);
+            out.endObject();
+        }
+        out.endArray();
     }
 
-    template <typename JsonT>
-    void schema::to_json(JsonT& j, Annotation const& value) {
-        j = JsonT::object();
-
-        j["type"] = value.type->qualifiedName;
-        j["location"] = value.location;
-
-        assert(value.type->kind == Type::Kind::Attribute);
-
-        auto args_json = JsonT::array();
-        for (size_t index = 0; index != value.args.size(); ++index)
-            args_json.push_back(value.args[index]);
-        j["args"] = std::move(args_json);
+    void Serializer::write(flat::Constant const& constant) {
+        out.beginObject();
+        out.member("name", constant.name);
+        out.member("qualified", constant.qualifiedName);
+        writeScope(constant.scope);
+        out.member("type", mod.types[constant.type].name);
+        member("value", mod.values[constant.value]);
+        member("annotations", constant.annotations);
+        location(constant.location);
+        out.endObject();
     }
 
-    template <typename JsonT>
-    void schema::to_json(JsonT& j, std::vector<std::unique_ptr<Annotation>> const& values) {
-        j = JsonT::array();
-        for (auto const& val : values)
-            j.push_back(*val);
+    void Serializer::write(flat::Namespace const& ns) {
+        out.beginObject();
+        out.member("name", ns.name);
+        out.member("qualified", ns.qualifiedName);
+        out.member("module", ns.module);
+        if (auto const& parent = mod.namespaces[ns.parent]; !parent.name.empty())
+            out.member("namespace", parent.qualifiedName);
+
+        out.key("types");
+        out.beginArray();
+        for (auto const type : mod.refsOf(ns.types))
+            out.value(mod.types[type].qualifiedName);
+        out.endArray();
+
+        out.key("constants");
+        out.beginArray();
+        for (auto const constant : mod.refsOf(ns.constants))
+            out.value(mod.constants[constant].qualifiedName);
+        out.endArray();
+
+        out.key("namespaces");
+        out.beginArray();
+        for (auto const subNamespace : mod.refsOf(ns.namespaces))
+            out.value(mod.namespaces[subNamespace].qualifiedName);
+        out.endArray();
+
+        out.endObject();
     }
 }
@@ -4,11 +4,21 @@
 
 #pragma once
 
-#include "location.hh"
-#include "schema.hh"
+#include "sapc/location.hh"
+#include "sapc/flat.hh"
 
-#include <nlohmann/json.hpp>
+#include <iosfwd>
 
 namespace sapc {
-    nlohmann::ordered_json serializeToJson(schema::Module const& mod);
+    struct JsonOptions {
+        enum class Locations {
+            Full, // every location names its file
+            Files, // locations hold an index into a top-level "files" array
+            None, // locations are omitted
+        } locations = Locations::Full;
+        bool compact = false; // no indentation or line breaks
+    };
+
+    // writes the sap-1 JSON document for the module directly to the stream
+    void serializeToJson(std::ostream& os, flat::Module const& mod, FileTable const& files, JsonOptions const& options = {});
 }
@@ -6,16 +6,19 @@
 #include "log.hh"
 
 #include <charconv>
-#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 
-namespace sapc {
-    static const Token unknown = { TokenType::Unknown };
-
-    static auto isIdentStartChar(char ch) -> bool { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_'; };
-    static auto isIdentChar(char ch) -> bool { return isIdentStartChar(ch) || (ch >= '0' && ch <= '9'); };
-    static auto isDigit(char ch) -> bool { return ch >= '0' && ch <= '9'; };
-    static auto isWhiteSpace(char ch) -> bool { return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n'; }
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define SAPC_LEXER_SSE2
+#   include <emmintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#   endif
+#endif
 
+namespace sapc {
     std::ostream& operator<<(std::ostream& os, TokenType type) {
         switch (type) {
         case TokenType::Unknown: os << "unknown"; break;
@@ -59,205 +62,309 @@ namespace sapc {
         return os;
     }
 
-    bool tokenize(std::string_view source, std::filesystem::path const& filename, std::vector<Token>& tokens, Log& log) {
-        decltype(source.size()) position = 0;
-        int line = 1;
-        decltype(position) lineStart = 0;
-
-        auto advance = [&, source](decltype(position) count = 1) {
-            while (count-- > 0 && position < source.size()) {
-                if (source[position++] == '\n') {
-                    ++line;
-                    lineStart = position;
-                }
-            }
+    namespace {
+        enum CharClass : unsigned char {
+            CharSpace = 1 << 0,
+            CharIdentStart = 1 << 1,
+            CharIdent = 1 << 2,
+            CharDigit = 1 << 3,
         };
 
-        auto const pos = [&](decltype(position) start) {
-            return Position{ line, static_cast<int>(start - lineStart) + 1 };
+        struct LexTables {
+            unsigned char classes[256] = {};
+            TokenType punctuation[256] = {};
         };
 
-        auto const match = [&](std::string_view input, bool only = false) {
-            auto const remaining = source.size() - position;
-            if (remaining < input.size())
-                return false;
+        constexpr LexTables makeLexTables() {
+            LexTables tables;
+            for (unsigned ch = 0; ch != 256; ++ch) {
+                unsigned char flags = 0;
+                if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+                    flags |= CharSpace;
+                if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_')
+                    flags |= CharIdentStart | CharIdent;
+                if (ch >= '0' && ch <= '9')
+                    flags |= CharIdent | CharDigit;
+                tables.classes[ch] = flags;
+                tables.punctuation[ch] = TokenType::Unknown;
+            }
 
-            auto const text = source.substr(position, input.size());
-            if (text != input)
-                return false;
+            tables.punctuation[static_cast<unsigned char>('{')] = TokenType::LeftBrace;
+            tables.punctuation[static_cast<unsigned char>('}')] = TokenType::RightBrace;
+            tables.punctuation[static_cast<unsigned char>('(')] = TokenType::LeftParen;
+            tables.punctuation[static_cast<unsigned char>(')')] = TokenType::RightParen;
+            tables.punctuation[static_cast<unsigned char>('[')] = TokenType::LeftBracket;
+            tables.punctuation[static_cast<unsigned char>(']')] = TokenType::RightBracket;
+            tables.punctuation[static_cast<unsigned char>('<')] = TokenType::LeftAngle;
+            tables.punctuation[static_cast<unsigned char>('>')] = TokenType::RightAngle;
+            tables.punctuation[static_cast<unsigned char>(',')] = TokenType::Comma;
+            tables.punctuation[static_cast<unsigned char>('.')] = TokenType::Dot;
+            tables.punctuation[static_cast<unsigned char>('=')] = TokenType::Equal;
+            tables.punctuation[static_cast<unsigned char>(':')] = TokenType::Colon;
+            tables.punctuation[static_cast<unsigned char>(';')] = TokenType::SemiColon;
+            tables.punctuation[static_cast<unsigned char>('*')] = TokenType::Asterisk;
+            return tables;
+        }
 
-            if (only && source.size() >= position + input.size() && isIdentChar(source[position + input.size()]))
-                return false;
+        constexpr LexTables lexTables = makeLexTables();
 
-            advance(input.size());
-            return true;
-        };
+        inline bool hasClass(char ch, unsigned char flags) noexcept {
+            return (lexTables.classes[static_cast<unsigned char>(ch)] & flags) != 0;
+        }
+
+#if defined(SAPC_LEXER_SSE2)
+        inline unsigned countTrailingZeros(unsigned mask) noexcept {
+#if defined(_MSC_VER)
+            unsigned long index = 0;
+            _BitScanForward(&index, mask);
+            return static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+        }
 
-        auto const error = [&](decltype(position) start, char const* message) {
-            log.error(Location{ filename, pos(start) }, message);
-            tokens.push_back({ TokenType::Unknown, pos(start), pos(position) });
+        // mask of the bytes in the block that are whitespace
+        inline unsigned spaceMask(__m128i block) noexcept {
+            __m128i const space = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+            return static_cast<unsigned>(_mm_movemask_epi8(space));
+        }
+
+        // mask of the bytes in the block that are [A-Za-z0-9_]; bytes >= 0x80
+        // are negative under the signed compares and never match
+        inline unsigned identMask(__m128i block) noexcept {
+            __m128i const lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+            __m128i const alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+            __m128i const digit = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), block));
+            __m128i const under = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+            return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under)));
+        }
+#endif
+
+        // returns the offset of the first character at or after position that isn't whitespace
+        inline size_t skipSpace(std::string_view source, size_t position) noexcept {
+#if defined(SAPC_LEXER_SSE2)
+            while (position + 16 <= source.size()) {
+                auto const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source.data() + position));
+                auto const mask = ~spaceMask(block) & 0xFFFFu;
+                if (mask != 0)
+                    return position + countTrailingZeros(mask);
+                position += 16;
+            }
+#endif
+            while (position < source.size() && hasClass(source[position], CharSpace))
+                ++position;
+            return position;
+        }
+
+        // returns the offset of the first character at or after position that isn't an identifier character
+        inline size_t skipIdent(std::string_view source, size_t position) noexcept {
+#if defined(SAPC_LEXER_SSE2)
+            while (position + 16 <= source.size()) {
+                auto const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source.data() + position));
+                auto const mask = ~identMask(block) & 0xFFFFu;
+                if (mask != 0)
+                    return position + countTrailingZeros(mask);
+                position += 16;
+            }
+#endif
+            while (position < source.size() && hasClass(source[position], CharIdent))
+                ++position;
+            return position;
+        }
+
+        // returns the offset just past the next newline, or the end of the source
+        inline size_t skipLine(std::string_view source, size_t position) noexcept {
+            auto const* const found = static_cast<char const*>(std::memchr(source.data() + position, '\n', source.size() - position));
+            return found != nullptr ? static_cast<size_t>(found - source.data()) + 1 : source.size();
+        }
+
+        // returns the offset just past the next `*/', or the end of the source
+        inline size_t skipBlockComment(std::string_view source, size_t position) noexcept {
+            auto const found = source.find("*/", position);
+            return found != std::string_view::npos ? found + 2 : source.size();
+        }
+
+        inline TokenType keyword(std::string_view ident) noexcept {
+            using namespace std::literals;
+
+            switch (ident.size()) {
+            case 3:
+                if (ident == "use"sv) return TokenType::KeywordUse;
+                break;
+            case 4:
+                if (ident == "enum"sv) return TokenType::KeywordEnum;
+                if (ident == "true"sv) return TokenType::KeywordTrue;
+                if (ident == "null"sv) return TokenType::KeywordNull;
+                break;
+            case 5:
+                if (ident == "const"sv) return TokenType::KeywordConst;
+                if (ident == "union"sv) return TokenType::KeywordUnion;
+                if (ident == "false"sv) return TokenType::KeywordFalse;
+                if (ident == "using"sv) return TokenType::KeywordUsing;
+                if (ident == "class"sv) return TokenType::KeywordClass;
+                if (ident == "final"sv) return TokenType::KeywordFinal;
+                break;
+            case 6:
+                if (ident == "module"sv) return TokenType::KeywordModule;
+                if (ident == "import"sv) return TokenType::KeywordImport;
+                if (ident == "struct"sv) return TokenType::KeywordStruct;
+                break;
+            case 8:
+                if (ident == "typename"sv) return TokenType::KeywordTypename;
+                if (ident == "abstract"sv) return TokenType::KeywordAbstract;
+                break;
+            case 9:
+                if (ident == "attribute"sv) return TokenType::KeywordAttribute;
+                if (ident == "namespace"sv) return TokenType::KeywordNamespace;
+                break;
+            }
+            return TokenType::Identifier;
+        }
+    }
+
+    bool tokenize(std::string_view source, std::uint32_t file, std::vector<Token>& tokens, Log& log) {
+        if (source.size() >= std::numeric_limits<std::uint32_t>::max()) {
+            log.error(Code::InputTooLarge, Location{ file }, "input is too large");
             return false;
-        };
+        }
+
+        size_t position = 0;
 
-        struct TokenMap {
-            std::string_view text;
-            TokenType token;
-            bool keyword = false;
+        auto const push = [&](TokenType type, size_t start) -> Token& {
+            auto& token = tokens.emplace_back();
+            token.type = type;
+            token.offset = static_cast<std::uint32_t>(start);
+            token.length = static_cast<std::uint32_t>(position - start);
+            return token;
         };
-        constexpr TokenMap tokenMap[] = {
-            { "{", TokenType::LeftBrace },
-            { "}", TokenType::RightBrace },
-            { "(", TokenType::LeftParen },
-            { ")", TokenType::RightParen },
-            { "[", TokenType::LeftBracket },
-            { "]", TokenType::RightBracket },
-            { "<", TokenType::LeftAngle },
-            { ">", TokenType::RightAngle },
-            { ",", TokenType::Comma },
-            { ".", TokenType::Dot },
-            { "=", TokenType::Equal },
-            { ":", TokenType::Colon },
-            { ";", TokenType::SemiColon },
-            { "*", TokenType::Asterisk },
-            { "module", TokenType::KeywordModule, true },
-            { "import", TokenType::KeywordImport, true },
-            { "attribute", TokenType::KeywordAttribute, true },
-            { "typename", TokenType::KeywordTypename, true },
-            { "const", TokenType::KeywordConst, true },
-            { "struct", TokenType::KeywordStruct, true },
-            { "union", TokenType::KeywordUnion, true },
-            { "enum", TokenType::KeywordEnum, true },
-            { "true", TokenType::KeywordTrue, true },
-            { "false", TokenType::KeywordFalse, true },
-            { "null", TokenType::KeywordNull, true },
-            { "namespace", TokenType::KeywordNamespace, true },
-            { "using", TokenType::KeywordUsing, true },
-            { "class", TokenType::KeywordClass, true },
-            { "abstract", TokenType::KeywordAbstract, true },
-            { "final", TokenType::KeywordFinal, true },
-            { "use", TokenType::KeywordUse, true },
+
+        auto const error = [&](size_t start, Code code, char const* message) {
+            log.error(code, Location{ file, static_cast<std::uint32_t>(start), static_cast<std::uint32_t>(start) }, message);
+            push(TokenType::Unknown, start);
+            return false;
         };
 
+        // a rough guess that avoids most reallocations for typical sources
+        tokens.reserve(tokens.size() + source.size() / 6 + 1);
+
         // parse until end of file
         for (;;) {
             // consume all whitespace
-            while (position < source.size() && isWhiteSpace(source[position]))
-                advance();
+            position = skipSpace(source, position);
 
             auto const start = position;
 
             // if we hit EOF, termine loop
             if (position == source.size()) {
-                tokens.push_back({ TokenType::EndOfFile, pos(start) });
+                push(TokenType::EndOfFile, start);
                 break;
             }
 
+            char const ch = source[position];
+
             // check for line-comments
-            if (source[position] == '#' || match("//")) {
-                bool eol = false;
-                while (!eol && position < source.size()) {
-                    if (source[position] == '\n')
-                        eol = true;
-                    advance();
-                }
+            if (ch == '#' || (ch == '/' && position + 1 < source.size() && source[position + 1] == '/')) {
+                position = skipLine(source, position);
                 continue;
             }
 
             // check for block-comments
-            if (match("/*")) {
-                bool end = false;
-                while (!end && position < source.size()) {
-                    if (match("*/"))
-                        end = true;
-                    advance();
-                }
+            if (ch == '/' && position + 1 < source.size() && source[position + 1] == '*') {
+                position = skipBlockComment(source, position + 2);
                 continue;
             }
 
             // check static inputs
-            bool matched = false;
-            for (auto [input, token, keyword] : tokenMap) {
-                if (match(input, keyword)) {
-                    tokens.push_back({ token, pos(start), pos(position) });
-                    matched = true;
-                    break;
-                }
-            }
-            if (matched)
+            if (auto const punct = lexTables.punctuation[static_cast<unsigned char>(ch)]; punct != TokenType::Unknown) {
+                ++position;
+                push(punct, start);
                 continue;
+            }
 
-            // see if we had an identifier (keywords will have been matched previously)
-            if (isIdentStartChar(source[position])) {
-                advance();
-                while (position < source.size() && isIdentChar(source[position]))
-                    advance();
+            // identifiers and keywords
+            if (hasClass(ch, CharIdentStart)) {
+                position = skipIdent(source, position + 1);
                 auto const identifier = source.substr(start, position - start);
-                tokens.push_back({ TokenType::Identifier, pos(start), pos(position), 0, std::string{identifier} });
+                auto const type = keyword(identifier);
+                auto& token = push(type, start);
+                if (type == TokenType::Identifier)
+                    token.dataString = identifier;
                 continue;
             }
 
             // number
-            bool const isNegative = source[position] == '-';
-            if (isNegative || isDigit(source[position])) {
-                advance();
-                while (position < source.size() && isDigit(source[position]))
-                    advance();
+            bool const isNegative = ch == '-';
+            if (isNegative || hasClass(ch, CharDigit)) {
+                ++position;
+                while (position < source.size() && hasClass(source[position], CharDigit))
+                    ++position;
 
                 // only a negative sign is not a complete number
                 if (isNegative && position - start <= 1)
-                    return error(start, "expected digits after -");
+                    return error(start, Code::ExpectedDigits, "expected digits after -");
 
-                Token token;
-                token.type = TokenType::Number;
-                token.start = pos(start);
-                token.end = pos(position);
+                auto& token = push(TokenType::Number, start);
                 std::from_chars(source.data() + start, source.data() + position, token.dataNumber);
-                tokens.push_back(token);
                 continue;
             }
 
             // string
-            if (source[position] == '"') {
-                advance();
-                std::ostringstream buf;
+            if (ch == '"') {
+                ++position;
+                auto const textStart = position;
+                auto textEnd = source.size();
+                bool hasEscapes = false;
                 while (position < source.size()) {
-                    auto const ch = source[position];
-                    advance();
+                    auto const next = source[position++];
 
-                    if (ch == '"') {
+                    if (next == '"') {
+                        textEnd = position - 1;
                         break;
                     }
-                    else if (ch == '\\') {
+                    else if (next == '\\') {
                         if (position < source.size()) {
-                            auto const esc = source[position];
-                            advance();
-                            switch (esc) {
-                            case 'n':
-                                buf << '\n';
-                                break;
-                            case '\\':
-                                buf << '\\';
-                                break;
-                            default:
-                                return error(start, "unexpected escape sequence");
-                            }
+                            auto const esc = source[position++];
+                            if (esc != 'n' && esc != '\\')
+                                return error(start, Code::BadEscape, "unexpected escape sequence");
+                            hasEscapes = true;
                         }
                         else
-                            return error(start, "unterminated string literal");
-                    }
-                    else {
-                        buf << ch;
+                            return error(start, Code::UnterminatedString, "unterminated string literal");
                     }
                 }
 
-                tokens.push_back({ TokenType::String, pos(start), pos(position), 0, std::move(buf).str() });
+                auto& token = push(TokenType::String, start);
+                token.dataString = source.substr(textStart, textEnd - textStart);
+                token.hasEscapes = hasEscapes;
                 continue;
             }
 
             // unknown input
-            return error(start, "unreconized input");
+            ++position;
+            return error(start, Code::UnrecognizedInput, "unreconized input");
         }
 
         return true;
     }
+
+    std::string unescape(std::string_view text) {
+        std::string result;
+        result.reserve(text.size());
+        for (size_t index = 0; index != text.size(); ++index) {
+            auto const ch = text[index];
+            if (ch != '\\' || index + 1 == text.size()) {
+                result.push_back(ch);
+                continue;
+            }
+
+            // the lexer has already rejected any other escape sequence
+            switch (text[++index]) {
+            case 'n': result.push_back('\n'); break;
+            default: result.push_back(text[index]); break;
+            }
+        }
+        return result;
+    }
 }
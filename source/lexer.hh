@@ -4,11 +4,13 @@
 
 #pragma once
 
-#include "location.hh"
+#include "sapc/location.hh"
 
+#include <cstdint>
 #include <filesystem>
 #include <iosfwd>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace sapc {
@@ -56,14 +58,19 @@ namespace sapc {
 
     struct Token {
         TokenType type = TokenType::Unknown;
-        Position start;
-        Position end;
+        std::uint32_t offset = 0; // byte offset of the token in the source
+        std::uint32_t length = 0;
         long long dataNumber = 0;
-        std::string dataString;
+        std::string_view dataString; // views the source text; string literals exclude the quotes
+        bool hasEscapes = false; // string literal must be passed through unescape()
 
         constexpr operator bool() const noexcept { return type != TokenType::Unknown; }
         friend std::ostream& operator<<(std::ostream& os, Token const& tok) { return os << tok.type; }
     };
 
-    bool tokenize(std::string_view source, std::filesystem::path const& filename, std::vector<Token>& tokens, Log& log);
+    // tokens view the source, which must outlive them
+    bool tokenize(std::string_view source, std::uint32_t file, std::vector<Token>& tokens, Log& log);
+
+    // materializes the value of a string literal that contains escape sequences
+    std::string unescape(std::string_view text);
 }
@@ -2,39 +2,99 @@
 // This is free and unencumbered software released into the public domain.
 // See LICENSE.md for more details.
 
-#include "location.hh"
+#include "sapc/location.hh"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 namespace sapc {
-    std::ostream& operator<<(std::ostream& os, Location const& loc) {
-        os << loc.filename.string();
-        if (loc.start.line > 0 && loc.start.column > 0) {
-            os << '(';
-            os << loc.start.line << ',' << loc.start.column;
-            if (loc.start != loc.end && loc.end.line != 0)
-                os << ',' << loc.end.line << ',' << loc.end.column;
-            os << ')';
+    Location& Location::merge(Location const& rhs) {
+        if (rhs.start == npos)
+            return *this;
+
+        if (start == npos) {
+            *this = rhs;
+            return *this;
         }
-        else if (loc.start.line > 0) {
-            os << '(' << loc.start.line << ')';
+
+        start = std::min(start, rhs.start);
+        end = std::max(end, rhs.end);
+        return *this;
+    }
+
+    LineIndex::LineIndex(std::string_view text) {
+        lineStarts.push_back(0);
+
+        char const* const first = text.data();
+        char const* const last = first + text.size();
+        for (char const* it = first; it != last;) {
+            auto const* const newline = static_cast<char const*>(std::memchr(it, '\n', last - it));
+            if (newline == nullptr)
+                break;
+            it = newline + 1;
+            lineStarts.push_back(static_cast<std::uint32_t>(it - first));
         }
-        return os;
     }
 
-    Location& Location::merge(Position const& rhs) {
-        if (rhs.line == 0)
-            return *this;
+    Position LineIndex::position(size_t offset) const noexcept {
+        if (lineStarts.empty())
+            return {};
 
-        if (start.line == 0 || rhs.line < start.line)
-            start = rhs;
-        else if (start.line == rhs.line && rhs.column < start.column)
-            start.column = rhs.column;
+        auto const it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - 1;
+        return { static_cast<int>(it - lineStarts.begin()) + 1, static_cast<int>(offset - *it) + 1 };
+    }
 
-        if (end.line == 0 || rhs.line > end.line)
-            end = rhs;
-        else if (end.line == rhs.line && rhs.column > end.column)
-            end.column = rhs.column;
+    std::uint32_t FileTable::intern(std::filesystem::path const& path) {
+        std::lock_guard lock(mutex);
 
-        return *this;
+        auto const [it, inserted] = ids.insert({ path.string(), static_cast<std::uint32_t>(files.size()) });
+        if (inserted)
+            files.emplace_back().path = path;
+        return it->second;
+    }
+
+    SourceFile& FileTable::file(std::uint32_t id) {
+        std::lock_guard lock(mutex);
+        return files[id];
+    }
+
+    std::filesystem::path FileTable::path(std::uint32_t id) const {
+        std::lock_guard lock(mutex);
+        return id < files.size() ? files[id].path : std::filesystem::path{};
+    }
+
+    Position FileTable::position(std::uint32_t id, std::uint32_t offset) const {
+        if (offset == Location::npos)
+            return {};
+
+        std::lock_guard lock(mutex);
+        if (id >= files.size())
+            return {};
+
+        auto& file = files[id];
+        if (file.lineOffsets)
+            return { static_cast<int>(offset), 0 };
+
+        if (!file.lines)
+            file.lines.emplace(file.text);
+        return file.lines->position(offset);
+    }
+
+    void FileTable::print(std::ostream& os, Location const& loc) const {
+        printLocation(os, path(loc.file).string(), position(loc.file, loc.start), position(loc.file, loc.end));
+    }
+
+    void printLocation(std::ostream& os, std::string_view path, Position start, Position end) {
+        os << path;
+        if (start.line > 0 && start.column > 0) {
+            os << '(';
+            os << start.line << ',' << start.column;
+            if (start != end && end.line != 0)
+                os << ',' << end.line << ',' << end.column;
+            os << ')';
+        }
+        else if (start.line > 0) {
+            os << '(' << start.line << ')';
+        }
     }
 }
@@ -0,0 +1,207 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "log.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+
+namespace {
+    std::string_view severityName(sapc::Severity severity) noexcept {
+        switch (severity) {
+        case sapc::Severity::Error: return "error";
+        case sapc::Severity::Warning: return "warning";
+        default: return "info";
+        }
+    }
+
+    // SARIF names info messages notes
+    std::string_view sarifLevel(sapc::Severity severity) noexcept {
+        switch (severity) {
+        case sapc::Severity::Error: return "error";
+        case sapc::Severity::Warning: return "warning";
+        default: return "note";
+        }
+    }
+
+    void writeString(std::ostream& os, std::string_view text) {
+        os << '"';
+        for (char const ch : text) {
+            if (ch == '"' || ch == '\\')
+                os << '\\' << ch;
+            else if (static_cast<unsigned char>(ch) < 0x20) {
+                char escape[8];
+                std::snprintf(escape, sizeof escape, "\\u%04x", static_cast<unsigned>(ch));
+                os << escape;
+            }
+            else
+                os << ch;
+        }
+        os << '"';
+    }
+
+    // relative paths stay relative references, resolved against the
+    // directory sapc ran in; absolute paths become file URIs
+    std::string fileUri(std::string_view path) {
+        static constexpr char hex[] = "0123456789ABCDEF";
+
+        auto const generic = std::filesystem::path{ path }.generic_string();
+
+        std::string uri;
+        if (std::filesystem::path{ path }.is_absolute())
+            uri = generic.front() == '/' ? "file://" : "file:///";
+        for (char const ch : generic) {
+            auto const byte = static_cast<unsigned char>(ch);
+            if ((byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || (byte >= '0' && byte <= '9') || std::string_view{ "-._~/:" }.find(ch) != std::string_view::npos)
+                uri.push_back(ch);
+            else {
+                uri.push_back('%');
+                uri.push_back(hex[byte >> 4]);
+                uri.push_back(hex[byte & 0xF]);
+            }
+        }
+        return uri;
+    }
+}
+
+namespace sapc {
+    void Diagnostic::printMessage(std::ostream& os) const {
+        for (auto const& arg : args)
+            std::visit([&os](auto const& value) { os << value; }, arg);
+    }
+
+    std::string Diagnostic::message() const {
+        std::ostringstream buffer;
+        printMessage(buffer);
+        return std::move(buffer).str();
+    }
+
+    void Report::print(std::ostream& os) const {
+        printLocation(os, path, start, end);
+        os << ": " << severityName(severity) << " C" << code << ": " << message;
+    }
+
+    std::string Report::line() const {
+        std::ostringstream buffer;
+        print(buffer);
+        return std::move(buffer).str();
+    }
+
+    Log Log::fork() {
+        if (maxErrors != 0 && shared == nullptr)
+            shared = std::make_shared<std::atomic<int>>(countErrors);
+
+        Log child;
+        child.maxErrors = maxErrors;
+        child.files = files;
+        child.shared = shared;
+        return child;
+    }
+
+    void Log::merge(Log&& other) {
+        // the limit is applied again in merge order, so the diagnostics kept
+        // don't depend on which thread finished first
+        auto const errors = countErrors + other.countErrors;
+        for (auto& diag : other.diagnostics) {
+            if (dropping = drops(diag.severity); dropping)
+                continue;
+            if (diag.severity == Severity::Error)
+                ++countErrors;
+            diagnostics.push_back(std::move(diag));
+            if (stream != nullptr)
+                print(diagnostics.back());
+        }
+        countErrors = errors;
+
+        other.diagnostics.clear();
+        other.countErrors = 0;
+    }
+
+    Report Log::resolve(Diagnostic const& diag) const {
+        Report report;
+        report.severity = diag.severity;
+        report.code = diag.code;
+        if (files != nullptr && diag.location.file != 0) {
+            report.path = files->path(diag.location.file).string();
+            report.start = files->position(diag.location.file, diag.location.start);
+            report.end = files->position(diag.location.file, diag.location.end);
+        }
+        report.message = diag.message();
+        return report;
+    }
+
+    std::vector<Report> Log::reports() const {
+        std::vector<Report> result;
+        result.reserve(diagnostics.size());
+        for (auto const& diag : diagnostics)
+            result.push_back(resolve(diag));
+        return result;
+    }
+
+    std::vector<std::string> Log::lines() const {
+        std::vector<std::string> result;
+        result.reserve(diagnostics.size());
+        for (auto const& diag : diagnostics)
+            result.push_back(resolve(diag).line());
+        return result;
+    }
+
+    void Log::print(Diagnostic const& diag) const {
+        resolve(diag).print(*stream);
+        *stream << '\n';
+    }
+
+    bool writeSarif(std::filesystem::path const& filename, std::vector<Report> const& reports) {
+        std::ofstream os(filename);
+        if (!os)
+            return false;
+
+        os << "{\n";
+        os << "  \"$schema\": \"https://json.schemastore.org/sarif-2.1.0.json\",\n";
+        os << "  \"version\": \"2.1.0\",\n";
+        os << "  \"runs\": [\n";
+        os << "    {\n";
+        os << "      \"tool\": { \"driver\": { \"name\": \"sapc\", \"version\": ";
+        writeString(os, SAPC_VERSION);
+        os << ", \"informationUri\": \"https://github.com/potatoengine/sapc\" } },\n";
+        os << "      \"results\": [";
+
+        bool first = true;
+        for (auto const& report : reports) {
+            os << (first ? "\n" : ",\n");
+            first = false;
+
+            os << "        { \"ruleId\": \"C" << report.code << "\", \"level\": \"" << sarifLevel(report.severity) << "\", \"message\": { \"text\": ";
+            writeString(os, report.message);
+            os << " }";
+
+            if (!report.path.empty()) {
+                os << ", \"locations\": [{ \"physicalLocation\": { \"artifactLocation\": { \"uri\": ";
+                writeString(os, fileUri(report.path));
+                os << " }";
+                if (report.start.line > 0) {
+                    os << ", \"region\": { \"startLine\": " << report.start.line;
+                    if (report.start.column > 0)
+                        os << ", \"startColumn\": " << report.start.column;
+                    if (report.end.line > 0 && report.end != report.start) {
+                        os << ", \"endLine\": " << report.end.line;
+                        if (report.end.column > 0)
+                            os << ", \"endColumn\": " << report.end.column;
+                    }
+                    os << " }";
+                }
+                os << " } }]";
+            }
+            os << " }";
+        }
+
+        os << (first ? "]\n" : "\n      ]\n");
+        os << "    }\n";
+        os << "  ]\n";
+        os << "}\n";
+
+        return static_cast<bool>(os);
+    }
+}
@@ -4,39 +4,247 @@
 
 #pragma once
 
-#include "location.hh"
+#include "sapc/location.hh"
+#include "sapc/symbol.hh"
 
-#include <ostream>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
 namespace sapc {
+    enum class Severity : std::uint8_t {
+        Error,
+        Warning,
+        Info,
+    };
+
+    // The code of each kind of diagnostic, printed as `C<code>` and used as
+    // the SARIF rule id; errors are 2xxx, and warnings and notes are 4xxx.
+    // Codes are never reused, so that suppressions and tooling keep working.
+    enum class Code : int {
+        Error = 2000, // an error of no more specific kind
+        CompileFailed = 2001,
+
+        // tokenizing
+        InputTooLarge = 2100,
+        ExpectedDigits = 2101,
+        BadEscape = 2102,
+        UnterminatedString = 2103,
+        UnrecognizedInput = 2104,
+
+        // parsing
+        MissingModule = 2200,
+        UnexpectedEnd = 2201,
+        UnexpectedInput = 2202,
+        UnexpectedToken = 2203,
+        NestingDepth = 2204,
+        Expected = 2205,
+
+        // loading imports
+        ModuleNotFound = 2300,
+        ImportCycle = 2301,
+        ParseFailed = 2302,
+        OpenFailed = 2303,
+
+        // resolving names and annotations
+        NotAType = 2400,
+        TypeNotFound = 2401,
+        InstantiationDepth = 2402,
+        NameNotFound = 2403,
+        NamespaceValue = 2404,
+        AttributeNotFound = 2405,
+        NotAnAttribute = 2406,
+        TooManyArguments = 2407,
+        MissingArgument = 2408,
+
+        // validating
+        MissingModuleName = 2500,
+        DuplicateField = 2501,
+        BaseNotStruct = 2502,
+        BaseCycle = 2503,
+        EnumBaseNotInteger = 2504,
+        EnumValueRange = 2505,
+        ValueKind = 2506,
+        ValueRange = 2507,
+        ValueItem = 2508,
+        ArraySize = 2509,
+
+        Warning = 4000, // a warning or note of no more specific kind
+
+        // warnings
+        ImportHidden = 4100,
+        SearchPathNotDirectory = 4101,
+        SearchPathRepeated = 4102,
+        ModuleNameMismatch = 4103,
+        DuplicateImport = 4104,
+        UnusedImport = 4105,
+        DuplicateEnumValue = 4106,
+        OnlyUnmatched = 4107,
+
+        // notes on the diagnostic before them
+        UnclosedScope = 4200,
+        HiddenFile = 4201,
+        InstantiatedFrom = 4202,
+        DeclaredHere = 4203,
+        FirstDeclared = 4204,
+    };
+
+    // A reported problem; the message is kept as the arguments it was
+    // reported with and only formatted when it is printed
+    struct Diagnostic {
+        // literals are kept as views, other text is copied
+        using Argument = std::variant<std::string_view, std::string, Symbol, long long, unsigned long long>;
+
+        Severity severity = Severity::Error;
+        int code = 0;
+        Location location;
+        std::vector<Argument> args;
+
+        void printMessage(std::ostream& os) const;
+        std::string message() const;
+
+        template <typename T>
+        static Argument argument(T const& value);
+    };
+
+    // A diagnostic with its location resolved to a file and positions; it
+    // no longer needs the file table, so it can be cached or written out
+    struct Report {
+        Severity severity = Severity::Error;
+        int code = 0;
+        std::string path;
+        Position start;
+        Position end;
+        std::string message;
+
+        // as printed to stderr: `file(line,col): error C2000: message`
+        void print(std::ostream& os) const;
+        std::string line() const;
+    };
+
+    // Writes a SARIF 2.1.0 log of one run of sapc
+    bool writeSarif(std::filesystem::path const& filename, std::vector<Report> const& reports);
+
     struct Log {
-        std::vector<std::string> lines;
+        std::vector<Diagnostic> diagnostics;
         int countErrors = 0;
+        int maxErrors = 0; // diagnostics after this many errors are dropped, and callers stop early; 0 is no limit
+        FileTable const* files = nullptr; // resolves locations into file names and positions
+        std::ostream* stream = nullptr; // diagnostics are printed here as they are logged or merged
+
+        template <typename... T>
+        void error(Code code, Location const& loc, T const&... args) {
+            report(Severity::Error, static_cast<int>(code), loc, args...);
+        }
+
+        template <typename... T>
+        void warn(Code code, Location const& loc, T const&... args) {
+            report(Severity::Warning, static_cast<int>(code), loc, args...);
+        }
+
+        template <typename... T>
+        void info(Code code, Location const& loc, T const&... args) {
+            report(Severity::Info, static_cast<int>(code), loc, args...);
+        }
 
+        // fallbacks for diagnostics of no specific kind
         template <typename... T>
         void error(Location const& loc, T const&... args) {
-            std::ostringstream buffer;
-            ((buffer << loc << ": error C2000: ") << ... << args);
-            lines.push_back(buffer.str());
-            ++countErrors;
+            error(Code::Error, loc, args...);
         }
 
         template <typename... T>
         void warn(Location const& loc, T const&... args) {
-            std::ostringstream buffer;
-            ((buffer << loc << ": warning C4000: ") << ... << args);
-            lines.push_back(buffer.str());
+            warn(Code::Warning, loc, args...);
         }
 
         template <typename... T>
         void info(Location const& loc, T const&... args) {
-            std::ostringstream buffer;
-            ((buffer << loc << ": info C4000: ") << ... << args);
-            lines.push_back(buffer.str());
+            info(Code::Warning, loc, args...);
+        }
+
+        template <typename... T>
+        void report(Severity severity, int code, Location const& loc, T const&... args) {
+            // nothing is kept past the limit, not even the arguments
+            if (dropping = drops(severity); dropping) {
+                if (severity == Severity::Error)
+                    countError();
+                return;
+            }
+
+            auto& diag = diagnostics.emplace_back();
+            diag.severity = severity;
+            diag.code = code;
+            diag.location = loc;
+            diag.args.reserve(sizeof...(T));
+            (diag.args.push_back(Diagnostic::argument(args)), ...);
+
+            if (severity == Severity::Error)
+                countError();
+            if (stream != nullptr)
+                print(diag);
         }
+
+        // true once maxErrors errors have been logged here; what is kept
+        // only depends on the order diagnostics arrive in
+        bool limitReached() const noexcept { return maxErrors != 0 && countErrors >= maxErrors; }
+
+        // the notes following the last error kept are kept with it
+        bool drops(Severity severity) const noexcept { return limitReached() && (severity != Severity::Info || dropping); }
+
+        // true once maxErrors errors have been logged here or in any fork,
+        // so that work still running on other threads can stop early
+        bool shouldStop() const noexcept {
+            return maxErrors != 0 && (shared != nullptr ? shared->load(std::memory_order_relaxed) : countErrors) >= maxErrors;
+        }
+
+        // Worker threads each log into their own fork, which needs no
+        // locking; forks share the error count with their parent, and are
+        // merged back in a deterministic order
+        Log fork();
+        void merge(Log&& other);
+
+        Report resolve(Diagnostic const& diag) const;
+        std::vector<Report> reports() const;
+        std::vector<std::string> lines() const;
+
+        void countError() noexcept {
+            ++countErrors;
+            if (shared != nullptr)
+                shared->fetch_add(1, std::memory_order_relaxed);
+        }
+        void print(Diagnostic const& diag) const;
+
+        std::shared_ptr<std::atomic<int>> shared; // errors counted across forks, if any were made
+        bool dropping = false; // the last diagnostic was past the limit
     };
+
+    template <typename T>
+    Diagnostic::Argument Diagnostic::argument(T const& value) {
+        if constexpr (std::is_array_v<T>)
+            return std::string_view{ value };
+        else if constexpr (std::is_same_v<T, Symbol>)
+            return value;
+        else if constexpr (std::is_convertible_v<T const&, std::string_view>)
+            return std::string{ std::string_view{ value } };
+        else if constexpr (std::is_same_v<T, char>)
+            return std::string(1, value);
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+            return static_cast<long long>(value);
+        else if constexpr (std::is_integral_v<T>)
+            return static_cast<unsigned long long>(value);
+        else {
+            std::ostringstream buffer;
+            buffer << value;
+            return std::move(buffer).str();
+        }
+    }
 }
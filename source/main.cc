@@ -3,67 +3,282 @@
 // See LICENSE.md for more details.
 
 #include "ast.hh"
+#include "binary.hh"
+#include "cache.hh"
 #include "compiler.hh"
 #include "context.hh"
+#include "cxx_header.hh"
+#include "cxx_reflect.hh"
+#include "cxx_serialize.hh"
+#include "file_util.hh"
 #include "json.hh"
 #include "string_util.hh"
 #include "log.hh"
-#include "schema.hh"
+#include "sapc/flat.hh"
+#include "sapc/schema.hh"
+#include "stats.hh"
 #include "validate.hh"
 
+#include <algorithm>
+#include <charconv>
 #include <string>
 #include <string_view>
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <fstream>
+#include <functional>
+#include <sstream>
 
 namespace fs = std::filesystem;
 
 namespace {
     struct Config {
-        fs::path input;
-        fs::path output;
-        fs::path deps;
+        std::vector<fs::path> inputs;
+        std::vector<fs::path> outputs;
+        std::vector<fs::path> deps;
         std::vector<fs::path> search;
+        fs::path cacheDir;
+        fs::path trace;
+        fs::path sarif;
+        unsigned jobs = 0;
+        int maxErrors = 0;
+        bool stats = false;
+        bool instantiate = false;
+        bool alwaysWrite = false; // rewrite outputs and deps files even if unchanged
+        std::vector<std::string> only; // patterns of the types and constants to write
+
+        enum class Format {
+            Json,
+            Binary,
+            Header,
+            Reflection,
+            Serializer,
+        } format = Format::Json;
+        sapc::JsonOptions json;
+        bool bulkCopy = false;
 
         enum class Mode {
             Compile,
+            Serve,
             Help,
         } mode = Mode::Compile;
     };
 
-    bool parse_arguments(int argc, char* argv[], Config& config) {
+    bool load_response_file(fs::path const& filename, std::vector<std::string>& args) {
         using namespace sapc;
 
+        std::string text;
+        if (!loadText(filename, text)) {
+            std::cerr << "error: Failed to open response file '" << filename.string() << "'\n";
+            return false;
+        }
+
+        // one argument per line, so that paths may contain spaces
+        std::string_view remaining = text;
+        while (!remaining.empty()) {
+            auto const eol = remaining.find('\n');
+            auto line = remaining.substr(0, eol);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (line.find_first_not_of(" \t") != std::string_view::npos)
+                args.emplace_back(trim(line));
+            if (eol == std::string_view::npos)
+                break;
+            remaining = remaining.substr(eol + 1);
+        }
+
+        return true;
+    }
+
+    bool parse_format(std::string_view name, Config::Format& out_format) {
+        if (name == "json")
+            out_format = Config::Format::Json;
+        else if (name == "binary")
+            out_format = Config::Format::Binary;
+        else if (name == "header")
+            out_format = Config::Format::Header;
+        else if (name == "reflection")
+            out_format = Config::Format::Reflection;
+        else if (name == "serializer")
+            out_format = Config::Format::Serializer;
+        else
+            return false;
+        return true;
+    }
+
+    bool parse_locations(std::string_view name, sapc::JsonOptions::Locations& out_locations) {
+        using Locations = sapc::JsonOptions::Locations;
+        if (name == "full")
+            out_locations = Locations::Full;
+        else if (name == "files")
+            out_locations = Locations::Files;
+        else if (name == "none")
+            out_locations = Locations::None;
+        else
+            return false;
+        return true;
+    }
+
+    bool parse_specializations(std::string_view name, bool& out_instantiate) {
+        if (name == "shared")
+            out_instantiate = false;
+        else if (name == "instantiated")
+            out_instantiate = true;
+        else
+            return false;
+        return true;
+    }
+
+    std::string format_options(Config const& config) {
+        using Locations = sapc::JsonOptions::Locations;
+        if (config.format == Config::Format::Binary)
+            return "binary";
+        if (config.format == Config::Format::Header)
+            return "header";
+        if (config.format == Config::Format::Reflection)
+            return "reflection";
+        if (config.format == Config::Format::Serializer)
+            return config.bulkCopy ? "serializer;bulk" : "serializer";
+
+        std::string options = config.json.compact ? "json-compact" : "json";
+        switch (config.json.locations) {
+        case Locations::Files: options += ";locations=files"; break;
+        case Locations::None: options += ";locations=none"; break;
+        default: break;
+        }
+        return options;
+    }
+
+    // identifies the options that change the output, for cache keys;
+    // instantiating can also report errors, whatever the format
+    std::string output_options(Config const& config) {
+        auto options = format_options(config);
+        if (config.instantiate)
+            options += ";instantiated";
+        for (auto const& pattern : config.only) {
+            options += ";only=";
+            options += pattern;
+        }
+        return options;
+    }
+
+    // the formats written from the flat form, which --only narrows
+    bool selectable(Config const& config) {
+        return config.format == Config::Format::Json || config.format == Config::Format::Binary;
+    }
+
+    bool parse_arguments(std::vector<std::string> const& original_args, Config& config) {
+        using namespace sapc;
+
+        // `--name=value` is shorthand for `--name value`
+        std::vector<std::string_view> args;
+        args.reserve(original_args.size());
+        bool split_options = true;
+        for (auto const& arg : original_args) {
+            auto const equals = arg.find('=');
+            if (arg == "--")
+                split_options = false;
+            if (!split_options || !starts_with(arg, "--") || equals == std::string::npos)
+                args.emplace_back(arg);
+            else {
+                args.emplace_back(arg.data(), equals);
+                args.emplace_back(arg.data() + equals + 1, arg.size() - equals - 1);
+            }
+        }
+
         enum class Arg {
             None,
             InputFile,
             OutputFile,
             DepsFile,
             IncludePath,
+            CacheDir,
+            Jobs,
+            Format,
+            Locations,
+            Trace,
+            MaxErrors,
+            Sarif,
+            Specializations,
+            Only,
         } mode = Arg::None;
         std::string_view mode_argument;
 
         bool allow_options = true;
 
-        for (int arg_index = 1; arg_index != argc; ++arg_index) {
-            auto arg = std::string_view{ argv[arg_index] };
+        for (auto arg : args) {
             auto const original_arg = arg;
 
             switch (mode) {
+            case Arg::InputFile:
+                config.inputs.push_back(fs::path{ arg }.make_preferred());
+                mode = Arg::None;
+                break;
             case Arg::OutputFile:
-                config.output = arg;
+                config.outputs.push_back(arg);
                 mode = Arg::None;
                 break;
             case Arg::DepsFile:
-                config.deps = arg;
+                config.deps.push_back(arg);
                 mode = Arg::None;
                 break;
             case Arg::IncludePath:
                 config.search.push_back(fs::path{ arg }.make_preferred());
                 mode = Arg::None;
                 break;
+            case Arg::CacheDir:
+                config.cacheDir = fs::path{ arg }.make_preferred();
+                mode = Arg::None;
+                break;
+            case Arg::Jobs:
+                if (auto const [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), config.jobs); ec != std::errc{} || end != arg.data() + arg.size()) {
+                    std::cerr << "error: Expected a number of jobs after '" << mode_argument << "', got '" << arg << "'\n";
+                    return false;
+                }
+                mode = Arg::None;
+                break;
+            case Arg::Format:
+                if (!parse_format(arg, config.format)) {
+                    std::cerr << "error: Unknown output format '" << arg << "' after '" << mode_argument << "'\n";
+                    return false;
+                }
+                mode = Arg::None;
+                break;
+            case Arg::Locations:
+                if (!parse_locations(arg, config.json.locations)) {
+                    std::cerr << "error: Unknown location mode '" << arg << "' after '" << mode_argument << "'\n";
+                    return false;
+                }
+                mode = Arg::None;
+                break;
+            case Arg::Trace:
+                config.trace = fs::path{ arg }.make_preferred();
+                mode = Arg::None;
+                break;
+            case Arg::MaxErrors:
+                if (auto const [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), config.maxErrors); ec != std::errc{} || end != arg.data() + arg.size() || config.maxErrors < 0) {
+                    std::cerr << "error: Expected a number of errors after '" << mode_argument << "', got '" << arg << "'\n";
+                    return false;
+                }
+                mode = Arg::None;
+                break;
+            case Arg::Sarif:
+                config.sarif = fs::path{ arg }.make_preferred();
+                mode = Arg::None;
+                break;
+            case Arg::Specializations:
+                if (!parse_specializations(arg, config.instantiate)) {
+                    std::cerr << "error: Unknown specialization mode '" << arg << "' after '" << mode_argument << "'\n";
+                    return false;
+                }
+                mode = Arg::None;
+                break;
+            case Arg::Only:
+                config.only.emplace_back(arg);
+                mode = Arg::None;
+                break;
             default:
                 if (arg == "--") {
                     allow_options = false;
@@ -73,13 +288,9 @@ namespace {
                     arg = arg.substr(2);
                 else if (allow_options && (starts_with(arg, "/") || starts_with(arg, "-")))
                     arg = arg.substr(1);
-                else if (config.input.empty()) {
-                    config.input = fs::path{ arg }.make_preferred();
-                    break;
-                }
                 else {
-                    std::cerr << "Unexpected command parameter '" << arg << "'\n";
-                    return false;
+                    config.inputs.push_back(fs::path{ arg }.make_preferred());
+                    break;
                 }
 
                 mode_argument = original_arg;
@@ -89,14 +300,42 @@ namespace {
                     mode = Arg::OutputFile;
                 else if (arg == "d" || arg == "deps")
                     mode = Arg::DepsFile;
+                else if (arg == "cache-dir")
+                    mode = Arg::CacheDir;
+                else if (arg == "j" || arg == "jobs")
+                    mode = Arg::Jobs;
+                else if (arg == "format")
+                    mode = Arg::Format;
+                else if (arg == "locations")
+                    mode = Arg::Locations;
+                else if (arg == "compact")
+                    config.json.compact = true;
+                else if (arg == "bulk-copy")
+                    config.bulkCopy = true;
+                else if (arg == "stats")
+                    config.stats = true;
+                else if (arg == "always-write")
+                    config.alwaysWrite = true;
+                else if (arg == "trace")
+                    mode = Arg::Trace;
+                else if (arg == "max-errors")
+                    mode = Arg::MaxErrors;
+                else if (arg == "sarif")
+                    mode = Arg::Sarif;
+                else if (arg == "specializations")
+                    mode = Arg::Specializations;
+                else if (arg == "only")
+                    mode = Arg::Only;
+                else if (arg == "serve")
+                    config.mode = Config::Mode::Serve;
                 else if (arg == "h" || arg == "help")
                     config.mode = Config::Mode::Help;
                 else if (starts_with(arg, "I") && arg.size() > 1)
                     config.search.push_back(fs::path{ arg.substr(1) }.make_preferred());
                 else if (starts_with(arg, "I") && arg.size() == 1)
                     mode = Arg::IncludePath;
-                else if (starts_with(original_arg, "/") && config.input.empty())
-                    config.input = fs::path{ original_arg }.make_preferred();
+                else if (starts_with(original_arg, "/"))
+                    config.inputs.push_back(fs::path{ original_arg }.make_preferred());
                 else {
                     std::cerr << "error: Unknown command argument '" << original_arg << "'\n";
                     return false;
@@ -111,97 +350,466 @@ namespace {
             return false;
         }
 
-        return true;
-    }
-}
+        // outputs and deps files are paired with inputs in the order given
+        if (config.inputs.size() > 1 && config.outputs.size() != config.inputs.size()) {
+            std::cerr << "error: Each input requires an output when compiling multiple inputs\n";
+            return false;
+        }
+        if (config.outputs.size() > std::max<size_t>(config.inputs.size(), 1)) {
+            std::cerr << "error: More outputs than inputs were provided\n";
+            return false;
+        }
+        if (!config.deps.empty() && config.deps.size() != config.outputs.size()) {
+            std::cerr << "error: Each output requires a deps file when deps files are requested\n";
+            return false;
+        }
+        if (!config.only.empty() && !selectable(config)) {
+            std::cerr << "error: --only applies to JSON and binary output\n";
+            return false;
+        }
 
-static int compile(Config& config) {
-    if (config.input.empty()) {
-        std::cerr << "error: No input file provided; use --help to see options\n";
-        return 1;
+        return true;
     }
 
-    sapc::Log log;
-
-    sapc::Context ctx;
-    ctx.targetFile = config.input;
-    ctx.searchPaths = config.search;
+    // splits a request line into arguments; double quotes group spaces
+    void split_arguments(std::string_view line, std::vector<std::string>& args) {
+        std::string current;
+        bool quoted = false;
+        bool pending = false;
 
-    auto const compiled = compile(ctx, log);
-    if (!compiled && log.lines.empty())
-        log.error({ ctx.targetFile }, "Failed to compile input");
+        for (char const ch : line) {
+            if (ch == '"') {
+                quoted = !quoted;
+                pending = true;
+            }
+            else if (!quoted && (ch == ' ' || ch == '\t' || ch == '\r')) {
+                if (pending)
+                    args.push_back(std::move(current));
+                current.clear();
+                pending = false;
+            }
+            else {
+                current.push_back(ch);
+                pending = true;
+            }
+        }
 
-    auto const valid = compiled && validate(*ctx.rootModule, log);
+        if (pending)
+            args.push_back(std::move(current));
+    }
 
-    for (auto const& line : log.lines)
-        std::cerr << line << '\n';
+    bool expand_arguments(int argc, char* argv[], std::vector<std::string>& args) {
+        using namespace sapc;
 
-    if (!compiled)
-        return 2;
-    if (!valid)
-        return 4;
+        for (int arg_index = 1; arg_index != argc; ++arg_index) {
+            auto const arg = std::string_view{ argv[arg_index] };
+            if (starts_with(arg, "@") && arg.size() > 1) {
+                if (!load_response_file(fs::path{ arg.substr(1) }, args))
+                    return false;
+            }
+            else
+                args.emplace_back(arg);
+        }
 
-    auto const doc = sapc::serializeToJson(*ctx.rootModule);
-    auto const json = doc.dump(4);
+        return true;
+    }
+}
 
-    if (!config.output.empty()) {
-        std::ofstream output_stream(config.output);
-        if (!output_stream) {
-            std::cerr << "error: Failed to open '" << config.output.string() << "' for writing\n";
+// files are written to a temporary that replaces the target once complete,
+// so that readers never see a partial file, and a target that already holds
+// the same contents is left untouched unless always is set
+static int write_file(fs::path const& filename, bool binary, bool always, std::function<void(std::ostream&)> const& write) {
+    auto const temp = sapc::tempPath(filename);
+    {
+        std::ofstream stream(temp, binary ? std::ios::out | std::ios::binary : std::ios::out);
+        if (!stream) {
+            std::cerr << "error: Failed to open '" << filename.string() << "' for writing\n";
             return 3;
         }
-        output_stream << json << '\n';
+        write(stream);
+        if (!stream.flush()) {
+            std::error_code ec;
+            fs::remove(temp, ec);
+            std::cerr << "error: Failed to write '" << filename.string() << "'\n";
+            return 3;
+        }
+    }
+
+    if (!sapc::replaceFile(temp, filename, always)) {
+        std::cerr << "error: Failed to replace '" << filename.string() << "'\n";
+        return 3;
+    }
+    return 0;
+}
+
+// text outputs end with a newline; binary outputs are written exactly as serialized
+static int write_output(fs::path const& output, bool binary, bool always, std::function<void(std::ostream&)> const& write) {
+    if (!output.empty()) {
+        return write_file(output, binary, always, [binary, &write](std::ostream& os) {
+            write(os);
+            if (!binary)
+                os << '\n';
+        });
     }
+
+    write(std::cout);
+    if (!binary)
+        std::cout << '\n';
+    return 0;
+}
+
+static int write_output(fs::path const& output, bool binary, bool always, std::string_view contents) {
+    return write_output(output, binary, always, [contents](std::ostream& os) { os.write(contents.data(), static_cast<std::streamsize>(contents.size())); });
+}
+
+static void serialize(std::ostream& os, Config const& config, sapc::Context const& ctx, sapc::flat::Module const& flat) {
+    sapc::Stats::Scope scope(ctx.stats, "serialize");
+    if (config.format == Config::Format::Binary)
+        sapc::serializeToBinary(os, flat, ctx.files);
+    else if (config.format == Config::Format::Header)
+        sapc::generateCxxHeader(os, *ctx.rootModule, ctx.files);
+    else if (config.format == Config::Format::Reflection)
+        sapc::generateCxxReflection(os, *ctx.rootModule);
+    else if (config.format == Config::Format::Serializer)
+        sapc::generateCxxSerializer(os, *ctx.rootModule, config.bulkCopy);
     else
-        std::cout << json << '\n';
+        sapc::serializeToJson(os, flat, ctx.files, config.json);
+}
 
-    if (!config.deps.empty() && !config.output.empty()) {
-        std::ofstream deps_stream(config.deps);
-        if (!deps_stream) {
-            std::cerr << "error: Failed to open '" << config.deps.string() << "' for writing\n";
-            return 3;
-        }
+static int write_deps(fs::path const& deps, fs::path const& output, bool always, std::vector<fs::path> const& dependencies) {
+    if (deps.empty() || output.empty())
+        return 0;
 
-        deps_stream << fs::relative(config.output).string() << ": ";
+    return write_file(deps, false, always, [&output, &dependencies](std::ostream& deps_stream) {
+        deps_stream << fs::relative(output).string() << ": ";
 
-        auto const num_deps = ctx.dependencies.size();
+        auto const num_deps = dependencies.size();
         for (size_t i = 0; i != num_deps; ++i) {
             if (i != 0)
                 deps_stream << "  ";
 
-            deps_stream << fs::relative(ctx.dependencies[i]).string() << ' ';
+            deps_stream << fs::relative(dependencies[i]).string() << ' ';
 
             if (i != num_deps - 1)
                 deps_stream << '\\';
 
             deps_stream << '\n';
         }
+    });
+}
+
+static bool matches_any(sapc::schema::Module const& mod, std::string_view pattern) {
+    for (auto const* type : mod.types)
+        if (sapc::matchesPattern(pattern, type->qualifiedName.str()))
+            return true;
+    for (auto const* constant : mod.constants)
+        if (sapc::matchesPattern(pattern, constant->qualifiedName.str()))
+            return true;
+    return false;
+}
+
+// every import of the dependencies, which must resolve the same way for a
+// cached result to be used
+static std::vector<sapc::CacheImport> cache_imports(sapc::Context const& ctx) {
+    std::vector<sapc::CacheImport> imports;
+    for (auto const& filename : ctx.dependencies) {
+        if (auto const it = ctx.importGraph.find(filename); it != ctx.importGraph.end())
+            for (auto const& imported : it->second)
+                imports.push_back({ std::string{ imported.name.str() }, filename, imported.filename });
+    }
+    return imports;
+}
+
+// diagnostics are printed as they arrive, and also collected for --sarif
+static int compile(sapc::Context& ctx, Config const& config, fs::path const& input, fs::path const& output, fs::path const& deps, std::vector<sapc::Report>& reports) {
+    // a cached result skips loading, parsing, and compiling entirely
+    std::string cacheKey;
+    bool const binary = config.format == Config::Format::Binary;
+    if (!config.cacheDir.empty()) {
+        sapc::Stats::Scope scope(ctx.stats, "cache");
+        cacheKey = sapc::cacheKey(input, config.search, output_options(config));
+
+        // imports are resolved again, apart from the context, whose search
+        // paths are only set once a compile starts
+        sapc::ImportIndex imports;
+        imports.setSearchPaths(config.search);
+        auto const resolve = [&imports, &ctx](std::string_view moduleName, fs::path const& importer) {
+            return imports.resolve(moduleName, importer, ctx.stats).filename;
+        };
+
+        sapc::CacheEntry entry;
+        if (sapc::loadCacheEntry(config.cacheDir, cacheKey, resolve, entry)) {
+            for (auto& report : entry.diagnostics) {
+                report.print(std::cerr);
+                std::cerr << '\n';
+                reports.push_back(std::move(report));
+            }
+
+            sapc::Stats::Scope writeScope(ctx.stats, "write");
+            if (auto const rs = write_output(output, binary, config.alwaysWrite, entry.output); rs != 0)
+                return rs;
+            return write_deps(deps, output, config.alwaysWrite, entry.dependencies);
+        }
+    }
+
+    sapc::Log log;
+    log.files = &ctx.files;
+    log.maxErrors = config.maxErrors;
+    log.stream = &std::cerr;
+
+    ctx.targetFile = input;
+    ctx.instantiate = config.instantiate;
+
+    auto const compiled = compile(ctx, log);
+    if (!compiled && log.diagnostics.empty())
+        log.error(sapc::Code::CompileFailed, sapc::Location{ ctx.files.intern(ctx.targetFile) }, "Failed to compile input");
+
+    // validation and the serializers walk the flat form
+    sapc::flat::Module flat;
+    bool valid = false;
+    if (compiled) {
+        {
+            sapc::Stats::Scope scope(ctx.stats, "flatten", ctx.rootModule->filename);
+            flat = sapc::flatten(*ctx.rootModule, { config.instantiate });
+        }
+
+        sapc::Stats::Scope scope(ctx.stats, "validate", ctx.rootModule->filename);
+        valid = validate(flat, log, ctx.jobs);
+    }
+
+    // the whole module is validated, but only the selection is written
+    if (valid && !config.only.empty()) {
+        for (auto const& pattern : config.only)
+            if (!matches_any(*ctx.rootModule, pattern))
+                log.warn(sapc::Code::OnlyUnmatched, ctx.rootModule->location, "no type or constant matches `", pattern, "'");
+
+        sapc::Stats::Scope scope(ctx.stats, "flatten", ctx.rootModule->filename);
+        flat = sapc::flatten(*ctx.rootModule, { config.instantiate, config.only });
+    }
+
+    if (log.limitReached())
+        std::cerr << "error: Stopped after " << config.maxErrors << " errors; use --max-errors to change the limit\n";
+
+    auto logReports = log.reports();
+    if (!config.sarif.empty())
+        reports.insert(reports.end(), logReports.begin(), logReports.end());
+
+    if (!compiled)
+        return 2;
+    if (!valid)
+        return 4;
+
+    // the document is streamed straight to the output unless a copy is needed for the cache
+    if (config.cacheDir.empty()) {
+        sapc::Stats::Scope scope(ctx.stats, "write");
+        auto const write = [&config, &ctx, &flat](std::ostream& os) { serialize(os, config, ctx, flat); };
+        if (auto const rs = write_output(output, binary, config.alwaysWrite, write); rs != 0)
+            return rs;
+        return write_deps(deps, output, config.alwaysWrite, ctx.dependencies);
+    }
+
+    std::ostringstream buffer;
+    serialize(buffer, config, ctx, flat);
+    auto const contents = std::move(buffer).str();
+
+    {
+        sapc::Stats::Scope scope(ctx.stats, "write");
+        if (auto const rs = write_output(output, binary, config.alwaysWrite, contents); rs != 0)
+            return rs;
+        if (auto const rs = write_deps(deps, output, config.alwaysWrite, ctx.dependencies); rs != 0)
+            return rs;
     }
 
+    // failing to populate the cache only costs a future compile
+    sapc::storeCacheEntry(config.cacheDir, cacheKey, { ctx.dependencies, cache_imports(ctx), std::move(logReports), contents });
+
     return 0;
 }
 
+static std::unique_ptr<sapc::Stats> start_stats(Config const& config) {
+    if (!config.stats && config.trace.empty())
+        return nullptr;
+    return std::make_unique<sapc::Stats>();
+}
+
+static int write_sarif(Config const& config, std::vector<sapc::Report> const& reports, int result) {
+    if (config.sarif.empty())
+        return result;
+
+    if (!sapc::writeSarif(config.sarif, reports)) {
+        std::cerr << "error: Failed to write diagnostics to '" << config.sarif.string() << "'\n";
+        return result != 0 ? result : 3;
+    }
+
+    return result;
+}
+
+// statistics go to stderr, keeping stdout for the output and server replies
+static int finish_stats(Config const& config, sapc::Stats const* stats, int result) {
+    if (stats == nullptr)
+        return result;
+
+    if (config.stats)
+        stats->report(std::cerr);
+
+    if (!config.trace.empty() && !stats->writeTrace(config.trace)) {
+        std::cerr << "error: Failed to write trace to '" << config.trace.string() << "'\n";
+        return result != 0 ? result : 3;
+    }
+
+    return result;
+}
+
+static int compile(Config const& config) {
+    if (config.inputs.empty()) {
+        std::cerr << "error: No input file provided; use --help to see options\n";
+        return 1;
+    }
+
+    auto const stats = start_stats(config);
+
+    // all inputs share one context, so common imports are only compiled once
+    sapc::Context ctx;
+    ctx.searchPaths = config.search;
+    ctx.jobs = config.jobs;
+    ctx.stats = stats.get();
+
+    int result = 0;
+    std::vector<sapc::Report> reports;
+    for (size_t index = 0; index != config.inputs.size(); ++index) {
+        auto const& output = index < config.outputs.size() ? config.outputs[index] : fs::path{};
+        auto const& deps = index < config.deps.size() ? config.deps[index] : fs::path{};
+
+        auto const rs = compile(ctx, config, config.inputs[index], output, deps, reports);
+        if (result == 0)
+            result = rs;
+    }
+    result = write_sarif(config, reports, result);
+    return finish_stats(config, stats.get(), result);
+}
+
+static int serve(Config const& config) {
+    // The context stays resident between requests; only modules whose files
+    // (or whose imports' files) have changed are parsed and compiled again.
+    auto const stats = start_stats(config);
+
+    sapc::Context ctx;
+    ctx.searchPaths = config.search;
+    ctx.jobs = config.jobs;
+    ctx.stats = stats.get();
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        auto const request = sapc::trim(line);
+        if (request.empty())
+            continue;
+        if (request == "quit")
+            break;
+
+        std::vector<std::string> args;
+        split_arguments(request, args);
+
+        // requests use the server's output options unless they name their own
+        Config requestConfig;
+        requestConfig.format = config.format;
+        requestConfig.json = config.json;
+        requestConfig.bulkCopy = config.bulkCopy;
+        requestConfig.instantiate = config.instantiate;
+        requestConfig.alwaysWrite = config.alwaysWrite;
+        requestConfig.maxErrors = config.maxErrors;
+        requestConfig.sarif = config.sarif;
+        int result = 1;
+        if (parse_arguments(args, requestConfig)) {
+            if (requestConfig.inputs.empty())
+                std::cerr << "error: No input file provided\n";
+            else if (requestConfig.mode != Config::Mode::Compile || !requestConfig.search.empty() || requestConfig.jobs != 0 || requestConfig.stats || !requestConfig.trace.empty())
+                std::cerr << "error: Requests may only specify inputs, outputs, deps files, output formats, diagnostics options, and a cache directory\n";
+            else {
+                requestConfig.search = config.search;
+                if (requestConfig.cacheDir.empty())
+                    requestConfig.cacheDir = config.cacheDir;
+                if (requestConfig.only.empty() && selectable(requestConfig))
+                    requestConfig.only = config.only;
+
+                sapc::invalidateModified(ctx);
+
+                result = 0;
+                std::vector<sapc::Report> reports;
+                for (size_t index = 0; index != requestConfig.inputs.size(); ++index) {
+                    auto const& output = index < requestConfig.outputs.size() ? requestConfig.outputs[index] : fs::path{};
+                    auto const& deps = index < requestConfig.deps.size() ? requestConfig.deps[index] : fs::path{};
+
+                    auto const rs = compile(ctx, requestConfig, requestConfig.inputs[index], output, deps, reports);
+                    if (result == 0)
+                        result = rs;
+                }
+                result = write_sarif(requestConfig, reports, result);
+            }
+        }
+
+        // clients wait for this line to know that a request has completed
+        std::cerr.flush();
+        std::cout << "done " << result << std::endl;
+    }
+
+    // statistics cover every request served
+    return finish_stats(config, stats.get(), 0);
+}
+
 static int help(std::filesystem::path program) {
     std::cout <<
-        "usage: " << program.filename().string() << " [-I<path>]... [-o <input>] [-d <depfile>] [-h] [--] <input>\n" <<
+        "usage: " << program.filename().string() << " [-I<path>]... [-o <output>]... [-d <depfile>]... [-h] [@<response>]... [--] <input>...\n" <<
         "  -I<path>              Add a path to the search list for importsand includes\n" <<
         "  -o|--output <ouput>   Output file path, otherwise prints to stdout\n"
         "  -d|--deps <depfile>   Specify the path that a Make-style deps file will be written to for build system integration\n" <<
+        "  --always-write        Rewrite outputs and deps files even when their contents are unchanged\n" <<
+        "  --cache-dir <path>    Reuse results of previous compiles of unchanged inputs stored in this directory\n" <<
+        "  --format <name>       Output format: json (the default), binary, header for a C++ header, reflection\n" <<
+        "                        for constexpr reflection tables of that header, or serializer for binary\n" <<
+        "                        read and write functions for its structs\n" <<
+        "  --bulk-copy           Serializers copy trivially copyable structs with a single memcpy\n" <<
+        "  --compact             Write JSON without indentation or line breaks\n" <<
+        "  --locations <mode>    JSON locations: full (the default), files to reference a top-level file table, or none\n" <<
+        "  --only <pattern>      Write only the types and constants whose qualified names match, and the types they\n" <<
+        "                        use, to JSON and binary output; `*` matches any characters, and the option may repeat\n" <<
+        "  --specializations <mode>  Specialized generic types in JSON and binary output: shared (the default) to\n" <<
+        "                        reference the generic's fields, or instantiated to also list them with the type\n" <<
+        "                        arguments substituted\n" <<
+        "  -j|--jobs <count>     Number of threads used to load imports and validate, defaults to the number of cores\n" <<
+        "  --stats               Print time and allocations per phase and per module, and compiler counters, to stderr\n" <<
+        "  --trace <file>        Write a Chrome trace_event JSON file of every phase, for Perfetto or chrome://tracing\n" <<
+        "  --max-errors <count>  Stop compiling an input once this many errors are reported; 0, the default, is no limit\n" <<
+        "  --sarif <file>        Also write every diagnostic to a SARIF 2.1.0 JSON file\n" <<
+        "  --serve               Read compile requests from stdin, one per line, keeping compiled modules resident\n" <<
         "  -h|--help             Print this help information\n" <<
-        "  <input>               The input sap IDL file\n";
+        "  @<response>           Read additional arguments from a file, one per line\n" <<
+        "  <input>               The input sap IDL file\n" <<
+        "\n" <<
+        "Multiple inputs may be compiled in one invocation; the Nth -o and -d\n" <<
+        "options apply to the Nth input, and imports are compiled only once.\n" <<
+        "\n" <<
+        "With --serve, each line of input holds the inputs, -o, -d, --cache-dir,\n" <<
+        "diagnostics, and output format arguments of one request. The line\n" <<
+        "`done <status>` is printed to stdout after each request, and the line\n" <<
+        "`quit` stops the server.\n";
     return 0;
 }
 
 int main(int argc, char* argv[]) {
     fs::path inputPath;
 
+    std::vector<std::string> args;
+    if (!expand_arguments(argc, argv, args))
+        return 1;
+
     Config config;
-    if (!parse_arguments(argc, argv, config)) {
+    if (!parse_arguments(args, config)) {
         return 1;
     }
 
     switch (config.mode) {
     case Config::Mode::Compile: return compile(config);
+    case Config::Mode::Serve: return serve(config);
     case Config::Mode::Help: return help(argv[0]);
     default: return 1;
     }
@@ -0,0 +1,70 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "ast.hh"
+#include "compiler.hh"
+#include "context.hh"
+#include "json.hh"
+#include "log.hh"
+#include "sapc/flat.hh"
+#include "sapc/sapc.hh"
+#include "validate.hh"
+
+namespace sapc {
+    Session::Session() : context(std::make_unique<Context>()) {}
+
+    Session::~Session() = default;
+
+    void Session::setSource(std::filesystem::path const& filename, std::string text) {
+        context->sources[filename] = std::move(text);
+        invalidate(*context, { filename });
+    }
+
+    void Session::removeSource(std::filesystem::path const& filename) {
+        if (context->sources.erase(filename) != 0)
+            invalidate(*context, { filename });
+    }
+
+    Session::Result Session::compile(std::filesystem::path const& target) {
+        auto& ctx = *context;
+        ctx.searchPaths = searchPaths;
+        ctx.resolver = resolver;
+        ctx.jobs = jobs;
+        ctx.instantiate = instantiate;
+
+        invalidateModified(ctx);
+
+        Log log;
+        log.files = &ctx.files;
+        log.maxErrors = maxErrors;
+
+        ctx.targetFile = target;
+        auto const compiled = sapc::compile(ctx, log);
+        if (!compiled && log.diagnostics.empty())
+            log.error(Code::CompileFailed, Location{ ctx.files.intern(target) }, "Failed to compile input");
+        if (compiled)
+            validate(flatten(*ctx.rootModule, { instantiate }), log, ctx.jobs);
+
+        Result result;
+        result.module = ctx.rootModule;
+        result.dependencies = ctx.dependencies;
+        result.diagnostics = log.lines();
+        result.errors = log.countErrors;
+        return result;
+    }
+
+    void Session::writeJson(std::ostream& os, schema::Module const& mod, bool compact) const {
+        JsonOptions options;
+        options.compact = compact;
+        serializeToJson(os, flatten(mod, { instantiate, only }), context->files, options);
+    }
+
+    FileTable const& Session::files() const noexcept {
+        return context->files;
+    }
+
+    void Session::reset() {
+        context = std::make_unique<Context>();
+    }
+}
@@ -0,0 +1,272 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "stats.hh"
+#include "sapc/schema.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#   include <psapi.h>
+#else
+#   include <sys/resource.h>
+#endif
+
+namespace {
+    // per thread, so counting needs no synchronization
+    thread_local std::uint64_t allocationCount = 0;
+    thread_local std::uint64_t allocatedBytes = 0;
+
+    thread_local sapc::Stats::Scope* currentScope = nullptr;
+    thread_local std::uint32_t threadIndex = ~0u;
+    std::atomic<std::uint32_t> nextThreadIndex{ 0 };
+
+    std::uint32_t currentThread() noexcept {
+        if (threadIndex == ~0u)
+            threadIndex = nextThreadIndex++;
+        return threadIndex;
+    }
+
+    void writeString(std::ostream& os, std::string_view text) {
+        os << '"';
+        for (char const ch : text) {
+            if (ch == '"' || ch == '\\')
+                os << '\\' << ch;
+            else if (static_cast<unsigned char>(ch) < 0x20) {
+                char escape[8];
+                std::snprintf(escape, sizeof escape, "\\u%04x", static_cast<unsigned>(ch));
+                os << escape;
+            }
+            else
+                os << ch;
+        }
+        os << '"';
+    }
+}
+
+namespace sapc {
+    void Stats::countAllocation(std::size_t bytes) noexcept {
+        ++allocationCount;
+        allocatedBytes += bytes;
+    }
+
+    Stats::Scope::Scope(Stats* stats, std::string_view phase, std::string detail) : stats(stats) {
+        if (stats == nullptr)
+            return;
+
+        event.phase = phase;
+        event.detail = std::move(detail);
+        event.thread = currentThread();
+
+        parent = currentScope;
+        currentScope = this;
+
+        allocationsBegan = allocationCount;
+        bytesBegan = allocatedBytes;
+        began = Clock::now();
+    }
+
+    Stats::Scope::~Scope() {
+        if (stats == nullptr)
+            return;
+
+        auto const ended = Clock::now();
+        auto const allocations = allocationCount - allocationsBegan;
+        auto const bytes = allocatedBytes - bytesBegan;
+
+        event.start = std::chrono::duration<double, std::micro>(began - stats->origin).count();
+        event.duration = std::chrono::duration<double, std::micro>(ended - began).count();
+        event.self = event.duration - children;
+        event.allocations = allocations - childAllocations;
+        event.allocatedBytes = bytes - childBytes;
+
+        currentScope = parent;
+        if (parent != nullptr) {
+            parent->children += event.duration;
+            parent->childAllocations += allocations;
+            parent->childBytes += bytes;
+        }
+
+        std::lock_guard lock(stats->mutex);
+        stats->events.push_back(std::move(event));
+    }
+
+    void Stats::countModule(schema::Module const& mod) {
+        ModuleCounts counts;
+        counts.name = std::string{ mod.name.str() };
+        counts.filename = mod.filename.string();
+
+        // imported and derived types listed by the module are counted where they are declared
+        for (auto const* type : mod.types) {
+            if (type->scope == nullptr || type->scope->owner != &mod)
+                continue;
+            if (type->kind == schema::Type::Kind::Array || type->kind == schema::Type::Kind::Pointer || type->kind == schema::Type::Kind::Specialized)
+                continue;
+
+            ++counts.types;
+            if (type->kind == schema::Type::Kind::Struct || type->kind == schema::Type::Kind::Union || type->kind == schema::Type::Kind::Attribute)
+                counts.fields += static_cast<schema::TypeAggregate const*>(type)->fields.size();
+        }
+
+        std::lock_guard lock(mutex);
+        modules.push_back(std::move(counts));
+    }
+
+    void Stats::report(std::ostream& os) const {
+        std::lock_guard lock(mutex);
+
+        struct Totals {
+            size_t calls = 0;
+            double total = 0;
+            double self = 0;
+            std::uint64_t allocations = 0;
+            std::uint64_t bytes = 0;
+        };
+
+        // phases are listed in the order they first ran
+        std::vector<std::string_view> phases;
+        std::unordered_map<std::string_view, Totals> totals;
+        std::unordered_map<std::string, std::unordered_map<std::string_view, double>> byFile;
+        for (auto const& event : events) {
+            auto const [it, inserted] = totals.try_emplace(event.phase);
+            if (inserted)
+                phases.push_back(event.phase);
+
+            auto& phase = it->second;
+            ++phase.calls;
+            phase.total += event.duration;
+            phase.self += event.self;
+            phase.allocations += event.allocations;
+            phase.bytes += event.allocatedBytes;
+
+            if (!event.detail.empty())
+                byFile[event.detail][event.phase] += event.self;
+        }
+
+        auto const ms = [](double micro) { return micro / 1000.0; };
+
+        os << std::fixed << std::setprecision(3);
+        os << "sapc stats\n";
+        os << std::left << std::setw(12) << "phase" << std::right << std::setw(8) << "calls" << std::setw(12) << "total ms" << std::setw(12) << "self ms" <<
+            std::setw(14) << "allocations" << std::setw(14) << "alloc KiB" << '\n';
+        for (auto const phase : phases) {
+            auto const& entry = totals.at(phase);
+            os << std::left << std::setw(12) << phase << std::right << std::setw(8) << entry.calls << std::setw(12) << ms(entry.total) << std::setw(12) << ms(entry.self) <<
+                std::setw(14) << entry.allocations << std::setw(14) << entry.bytes / 1024 << '\n';
+        }
+
+        size_t types = 0;
+        size_t fields = 0;
+        if (!modules.empty()) {
+            static constexpr std::string_view columns[] = { "load", "tokenize", "grammar", "compile" };
+
+            size_t width = 6;
+            for (auto const& mod : modules)
+                width = std::max(width, mod.name.size() + 2);
+
+            os << '\n' << std::left << std::setw(static_cast<int>(width)) << "module" << std::right;
+            for (auto const column : columns)
+                os << std::setw(12) << (std::string{ column } + " ms");
+            os << std::setw(8) << "types" << std::setw(8) << "fields" << '\n';
+
+            for (auto const& mod : modules) {
+                os << std::left << std::setw(static_cast<int>(width)) << mod.name << std::right;
+                auto const it = byFile.find(mod.filename);
+                for (auto const column : columns) {
+                    double self = 0;
+                    if (it != byFile.end())
+                        if (auto const found = it->second.find(column); found != it->second.end())
+                            self = found->second;
+                    os << std::setw(12) << ms(self);
+                }
+                os << std::setw(8) << mod.types << std::setw(8) << mod.fields << '\n';
+
+                types += mod.types;
+                fields += mod.fields;
+            }
+        }
+
+        auto const lookups = resolveHits + resolveMisses;
+        os << '\n';
+        os << "modules: " << modules.size() << ", types: " << types << ", fields: " << fields << '\n';
+        os << "resolve cache: " << resolveHits << " hits, " << resolveMisses << " misses";
+        if (lookups != 0)
+            os << " (" << std::setprecision(1) << 100.0 * static_cast<double>(resolveHits) / static_cast<double>(lookups) << "% hits)";
+        os << '\n';
+        os << "import index: " << importHits << " hits, " << importMisses << " misses, " << directoriesListed << " directories listed\n";
+        if (auto const peak = peakResidentBytes(); peak != 0)
+            os << "peak RSS: " << peak / 1024 << " KiB\n";
+        os << std::defaultfloat;
+    }
+
+    // Chrome trace_event format, as read by Perfetto and chrome://tracing
+    bool Stats::writeTrace(std::filesystem::path const& filename) const {
+        std::ofstream os(filename);
+        if (!os)
+            return false;
+
+        std::lock_guard lock(mutex);
+
+        os << std::fixed << std::setprecision(3);
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"sapc\"}}";
+
+        std::uint32_t threads = 0;
+        for (auto const& event : events)
+            threads = std::max(threads, event.thread + 1);
+        for (std::uint32_t thread = 0; thread != threads; ++thread)
+            os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":\"thread " << thread << "\"}}";
+
+        for (auto const& event : events) {
+            os << ",\n{\"name\":";
+            if (event.detail.empty())
+                writeString(os, event.phase);
+            else
+                writeString(os, std::string{ event.phase } + ' ' + std::filesystem::path{ event.detail }.stem().string());
+            os << ",\"cat\":";
+            writeString(os, event.phase);
+            os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start << ",\"dur\":" << event.duration <<
+                ",\"args\":{\"allocations\":" << event.allocations << ",\"bytes\":" << event.allocatedBytes;
+            if (!event.detail.empty()) {
+                os << ",\"file\":";
+                writeString(os, event.detail);
+            }
+            os << "}}";
+        }
+
+        os << "\n],\"otherData\":{\"resolveHits\":" << resolveHits << ",\"resolveMisses\":" << resolveMisses <<
+            ",\"importHits\":" << importHits << ",\"importMisses\":" << importMisses << ",\"directoriesListed\":" << directoriesListed <<
+            ",\"peakResidentBytes\":" << peakResidentBytes() << "}}\n";
+
+        return static_cast<bool>(os);
+    }
+
+    std::uint64_t Stats::peakResidentBytes() {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters))
+            return counters.PeakWorkingSetSize;
+        return 0;
+#else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#   if defined(__APPLE__)
+        return static_cast<std::uint64_t>(usage.ru_maxrss); // bytes
+#   else
+        return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024; // kilobytes
+#   endif
+#endif
+    }
+}
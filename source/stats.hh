@@ -0,0 +1,93 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sapc {
+    namespace schema {
+        struct Module;
+    }
+
+    // Timings, allocation counts, and counters collected for --stats and
+    // --trace; instrumented code does nothing when handed a null Stats
+    struct Stats {
+        using Clock = std::chrono::steady_clock;
+
+        struct Event {
+            std::string_view phase; // always a literal
+            std::string detail; // the file or module a phase worked on, if any
+            std::uint32_t thread = 0;
+            double start = 0; // microseconds since the stats were created
+            double duration = 0;
+            double self = 0; // excluding nested phases on the same thread
+            std::uint64_t allocations = 0; // excluding nested phases
+            std::uint64_t allocatedBytes = 0;
+        };
+
+        struct ModuleCounts {
+            std::string name;
+            std::string filename;
+            size_t types = 0;
+            size_t fields = 0;
+        };
+
+        // Records a phase on the calling thread from construction to destruction
+        struct Scope {
+            Scope(Stats* stats, std::string_view phase, std::string detail = {});
+            Scope(Stats* stats, std::string_view phase, std::filesystem::path const& file)
+                : Scope(stats, phase, stats != nullptr ? file.string() : std::string{}) {}
+            ~Scope();
+
+            Scope(Scope const&) = delete;
+            Scope& operator=(Scope const&) = delete;
+
+            Stats* stats = nullptr;
+            Scope* parent = nullptr;
+            Event event;
+            Clock::time_point began;
+            double children = 0;
+            std::uint64_t allocationsBegan = 0;
+            std::uint64_t bytesBegan = 0;
+            std::uint64_t childAllocations = 0;
+            std::uint64_t childBytes = 0;
+        };
+
+        void countModule(schema::Module const& mod);
+
+        void report(std::ostream& os) const;
+        bool writeTrace(std::filesystem::path const& filename) const;
+
+        // called by the executable's operator new; hosts of the library may
+        // call it from their own allocators, or leave allocations uncounted
+        static void countAllocation(std::size_t bytes) noexcept;
+
+        // the most memory the process has held, or 0 where unsupported
+        static std::uint64_t peakResidentBytes();
+
+        Clock::time_point const origin = Clock::now();
+
+        // events arrive from the worker threads that load imports
+        mutable std::mutex mutex;
+        std::vector<Event> events;
+        std::vector<ModuleCounts> modules;
+
+        std::uint64_t resolveHits = 0;
+        std::uint64_t resolveMisses = 0;
+
+        // updated by the import index, under its own lock
+        std::uint64_t importHits = 0;
+        std::uint64_t importMisses = 0;
+        std::uint64_t directoriesListed = 0;
+    };
+}
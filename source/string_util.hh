@@ -11,6 +11,10 @@ namespace sapc {
         return str.size() >= prefix.size() && str.substr(0, prefix.size()) == prefix;
     }
 
+    constexpr bool ends_with(std::string_view str, std::string_view suffix) noexcept {
+        return str.size() >= suffix.size() && str.substr(str.size() - suffix.size()) == suffix;
+    }
+
     constexpr std::string_view trim(std::string_view str) noexcept {
         auto const start = str.find_first_not_of(" \t\n");
         if (start == std::string_view::npos)
@@ -0,0 +1,29 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "symbol_pool.hh"
+
+#include <cstring>
+#include <ostream>
+
+namespace sapc {
+    Symbol SymbolPool::intern(std::string_view text) {
+        if (text.empty())
+            return {};
+
+        std::lock_guard lock(mutex);
+
+        if (auto const it = entries.find(text); it != entries.end())
+            return Symbol{ &*it };
+
+        // set nodes never move, so the stored view doubles as the symbol identity
+        auto* const chars = static_cast<char*>(this->text.allocate(text.size(), 1));
+        std::memcpy(chars, text.data(), text.size());
+        return Symbol{ &*entries.insert(std::string_view{ chars, text.size() }).first };
+    }
+
+    std::ostream& operator<<(std::ostream& os, Symbol sym) {
+        return os << sym.str();
+    }
+}
@@ -0,0 +1,31 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "arena.hh"
+#include "sapc/symbol.hh"
+
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+
+namespace sapc {
+    // Owns the text of interned symbols. Each context has its own pool, so
+    // the names it saw are released along with it; symbols are only valid
+    // while their pool lives, and only compare equal within one pool.
+    struct SymbolPool {
+        SymbolPool() = default;
+
+        SymbolPool(SymbolPool const&) = delete;
+        SymbolPool& operator=(SymbolPool const&) = delete;
+
+        // thread-safe, as loader threads intern the names of imports
+        Symbol intern(std::string_view text);
+
+        std::mutex mutex;
+        std::unordered_set<std::string_view> entries;
+        Arena text;
+    };
+}
@@ -0,0 +1,96 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sapc {
+    // Minimal fixed-size worker pool; tasks may submit further tasks, and
+    // wait() returns once every submitted task has completed
+    struct ThreadPool {
+        explicit ThreadPool(unsigned threads) {
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+
+            // a single job runs tasks on the calling thread from wait()
+            if (threads == 1)
+                return;
+
+            workers.reserve(threads);
+            for (unsigned index = 0; index != threads; ++index)
+                workers.emplace_back([this] { work(); });
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard lock(mutex);
+                shutdown = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator=(ThreadPool const&) = delete;
+
+        void submit(std::function<void()> task) {
+            {
+                std::lock_guard lock(mutex);
+                tasks.push_back(std::move(task));
+                ++pending;
+            }
+            wake.notify_one();
+        }
+
+        void wait() {
+            if (workers.empty()) {
+                while (!tasks.empty()) {
+                    auto task = std::move(tasks.front());
+                    tasks.pop_front();
+                    task();
+                    --pending;
+                }
+                return;
+            }
+
+            std::unique_lock lock(mutex);
+            idle.wait(lock, [this] { return pending == 0; });
+        }
+
+        void work() {
+            std::unique_lock lock(mutex);
+            for (;;) {
+                wake.wait(lock, [this] { return shutdown || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+
+                auto task = std::move(tasks.front());
+                tasks.pop_front();
+
+                lock.unlock();
+                task();
+                lock.lock();
+
+                if (--pending == 0)
+                    idle.notify_all();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::deque<std::function<void()>> tasks;
+        std::vector<std::thread> workers;
+        size_t pending = 0;
+        bool shutdown = false;
+    };
+}
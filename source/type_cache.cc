@@ -0,0 +1,70 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#include "type_cache.hh"
+
+#include <algorithm>
+#include <cassert>
+
+namespace sapc {
+    schema::TypeIndirect* TypeCache::adopt(std::unique_ptr<schema::TypeIndirect> type, std::vector<schema::Type const*> const& components, schema::Module const* core) {
+        Derived entry;
+        entry.type = std::move(type);
+
+        auto const own = [&entry](schema::Module const* mod) {
+            if (std::find(entry.owners.begin(), entry.owners.end(), mod) == entry.owners.end())
+                entry.owners.push_back(mod);
+        };
+
+        // a derived component brings the modules it was built from; the
+        // core module is never released, so it owns nothing
+        for (auto const* component : components) {
+            if (auto const it = derived.find(component); it != derived.end()) {
+                for (auto const* mod : it->second.owners)
+                    own(mod);
+            }
+            else if (component->scope != nullptr && component->scope->owner != core)
+                own(component->scope->owner);
+        }
+
+        auto* const result = entry.type.get();
+        derived.insert({ result, std::move(entry) });
+        return result;
+    }
+
+    schema::Field* TypeCache::adopt(schema::TypeIndirect const& type, std::unique_ptr<schema::Field> field) {
+        assert(derived.count(&type) != 0);
+        return derived.at(&type).fields.emplace_back(std::move(field)).get();
+    }
+
+    void TypeCache::release(std::unordered_set<schema::Module const*> const& modules) {
+        if (modules.empty())
+            return;
+
+        for (auto it = derived.begin(); it != derived.end();) {
+            auto const& owners = it->second.owners;
+            if (std::none_of(owners.begin(), owners.end(), [&modules](auto const* mod) { return modules.count(mod) != 0; })) {
+                ++it;
+                continue;
+            }
+
+            auto const& type = *it->second.type;
+            switch (type.kind) {
+            case schema::Type::Kind::Array:
+                arrays.erase({ type.refType, type.arraySize });
+                break;
+            case schema::Type::Kind::Pointer:
+                pointers.erase(type.refType);
+                break;
+            case schema::Type::Kind::Specialized:
+                specialized.erase({ type.refType, type.typeArgs });
+                instantiated.erase(&type);
+                break;
+            default:
+                break;
+            }
+            it = derived.erase(it);
+        }
+    }
+}
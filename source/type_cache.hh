@@ -0,0 +1,74 @@
+// sapc - by Sean Middleditch
+// This is free and unencumbered software released into the public domain.
+// See LICENSE.md for more details.
+
+#pragma once
+
+#include "hash_util.hh"
+#include "sapc/schema.hh"
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace sapc {
+    // Hash-consing of derived types; keys compare by the identity of the
+    // types they are built from, so distinct types can never collide, and
+    // each specialization is created once per context. The cache owns the
+    // derived types, each of which lives until a module it is built from is
+    // released; any module using it imports that module, so is released too.
+    struct TypeCache {
+        struct Derived {
+            std::unique_ptr<schema::TypeIndirect> type;
+            std::vector<std::unique_ptr<schema::Field>> fields; // instantiated from the generic
+            std::vector<schema::Module const*> owners; // the modules of the types it is built from
+        };
+
+        struct ArrayKey {
+            schema::Type const* of = nullptr;
+            std::optional<long long> size;
+
+            friend bool operator==(ArrayKey const& lhs, ArrayKey const& rhs) noexcept {
+                return lhs.of == rhs.of && lhs.size == rhs.size;
+            }
+        };
+
+        struct SpecializedKey {
+            schema::Type const* generic = nullptr;
+            std::vector<schema::Type const*> typeArgs;
+
+            friend bool operator==(SpecializedKey const& lhs, SpecializedKey const& rhs) noexcept {
+                return lhs.generic == rhs.generic && lhs.typeArgs == rhs.typeArgs;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(ArrayKey const& key) const noexcept {
+                auto hash = std::hash<schema::Type const*>{}(key.of);
+                return key.size ? hash_combine(*key.size, hash) : hash;
+            }
+
+            size_t operator()(SpecializedKey const& key) const noexcept {
+                auto hash = std::hash<schema::Type const*>{}(key.generic);
+                for (auto const* typeArg : key.typeArgs)
+                    hash = hash_combine(typeArg, hash);
+                return hash;
+            }
+        };
+
+        std::unordered_map<ArrayKey, schema::Type const*, KeyHash> arrays;
+        std::unordered_map<schema::Type const*, schema::Type const*> pointers;
+        std::unordered_map<SpecializedKey, schema::TypeIndirect*, KeyHash> specialized;
+        std::unordered_set<schema::Type const*> instantiated; // specializations whose fields have been filled in
+        std::unordered_map<schema::Type const*, Derived> derived;
+
+        // takes ownership of a derived type built from the given types
+        schema::TypeIndirect* adopt(std::unique_ptr<schema::TypeIndirect> type, std::vector<schema::Type const*> const& components, schema::Module const* core);
+        schema::Field* adopt(schema::TypeIndirect const& type, std::unique_ptr<schema::Field> field);
+
+        // frees every derived type built from any of the modules
+        void release(std::unordered_set<schema::Module const*> const& modules);
+    };
+}
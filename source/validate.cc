@@ -3,81 +3,496 @@
 // See LICENSE.md for more details.
 
 #include "log.hh"
-#include "schema.hh"
+#include "sapc/flat.hh"
+#include "thread_pool.hh"
 #include "validate.hh"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <filesystem>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace sapc {
     namespace {
+        using Kind = schema::Type::Kind;
+
+        // types are checked in batches of this many, each batch on one thread
+        constexpr size_t batchSize = 512;
+
+        // the records a value is checked for, as named in diagnostics
+        struct Subject {
+            std::string_view what;
+            Symbol name;
+        };
+
+        // where a chain of base types stops, which is shared by every type
+        // along the chain
+        struct BaseChain {
+            enum class State : std::uint8_t { Unvisited, Visiting, Ends, NotStruct, Cycle };
+
+            State state = State::Unvisited;
+            flat::Index blame = flat::none; // the first link that is not a struct
+        };
+
+        struct Validator;
+
+        // Checks a batch of types on one thread; diagnostics are collected
+        // in its own fork of the log and merged once every batch is done
+        struct Checker {
+            Validator const& shared;
+            flat::Module const& mod;
+            Log log;
+            std::vector<bool> usedImports;
+
+            // reused for every type, to avoid rebuilding the tables each time
+            std::unordered_map<Symbol, flat::Field const*> fields;
+            std::unordered_map<long long, flat::EnumItem const*> values;
+            std::vector<bool> visited;
+
+            Checker(Validator const& shared, Log&& log);
+
+            void check(flat::Type const& type);
+            void checkAggregate(flat::Type const& type);
+            void checkEnum(flat::Type const& type);
+            void checkBase(flat::Type const& type);
+            void check(flat::Constant const& constant);
+            void check(flat::Range annotations, Location const& loc);
+            void check(flat::Value const& value, flat::Index type, Subject const& subject, Location const& loc);
+
+            flat::Index resolveAlias(flat::Index type) const noexcept;
+            bool integerRange(flat::Index type, long long& min, long long& max) const noexcept;
+
+            void use(flat::Index type);
+            void use(flat::Range annotations);
+            void use(flat::Value const& value);
+        };
+
         struct Validator {
-            Log& log;
+            flat::Module const& mod;
+
+            // the module may come from any context, so built-ins are found by their text
+            std::string_view coreModule = "$core";
+            std::string_view stringName = "string";
+            std::string_view boolName = "bool";
+            std::string_view byteName = "byte";
+            std::string_view intName = "int";
+            std::string_view floatName = "float";
+            std::string_view customTagName = "$customtag";
 
-            inline bool validate(schema::Module const& mod);
-            inline bool validate(schema::Type const& type);
-            inline bool validate(schema::TypeAggregate const& type);
+            std::unordered_map<Symbol, size_t> importIds;
+            bool customTags = false;
+            std::vector<BaseChain> baseChains; // by type index
+
+            bool validate(Log& log, unsigned jobs);
+            void followBases();
+            bool local(flat::Index scope) const noexcept { return scope != flat::none && mod.namespaces[scope].module == mod.name; }
         };
+
+        char const* describe(flat::ValueKind kind) {
+            switch (kind) {
+            case flat::ValueKind::Null: return "null";
+            case flat::ValueKind::Bool: return "a boolean";
+            case flat::ValueKind::Integer: return "an integer";
+            case flat::ValueKind::String: return "a string";
+            case flat::ValueKind::TypeName: return "a type name";
+            case flat::ValueKind::Enum: return "an enumeration item";
+            case flat::ValueKind::Array: return "an array";
+            default: assert(false && "unknown value kind"); return "a value";
+            }
+        }
+
+        // generated enumerations and ints are C++ ints
+        constexpr long long intMin = std::numeric_limits<std::int32_t>::min();
+        constexpr long long intMax = std::numeric_limits<std::int32_t>::max();
     }
 }
 
-bool sapc::validate(schema::Module const& mod, Log& log) {
-    Validator validator{ log };
-    return validator.validate(mod);
+bool sapc::validate(flat::Module const& mod, Log& log, unsigned jobs) {
+    Validator validator{ mod };
+    return validator.validate(log, jobs);
 }
 
-bool sapc::Validator::validate(schema::Module const& mod) {
-    bool success = true;
+bool sapc::Validator::validate(Log& log, unsigned jobs) {
+    auto const errors = log.countErrors;
 
     // validate that the module has a name declaration
-    if (mod.name.empty()) {
-        log.error(mod.location, "module name is missing");
-        success = false;
-    }
+    if (mod.name.empty())
+        log.error(Code::MissingModuleName, mod.location, "module name is missing");
 
     // module name should be the same as the filename
-    const fs::path basename = mod.location.filename.stem();
-    if (basename != fs::path{ mod.name })
-        log.warn(mod.location, "module name `", mod.name, "' does not match filename");
+    const fs::path basename = fs::path{ mod.strings[mod.filename] }.stem();
+    if (basename != fs::path{ mod.name.str() })
+        log.warn(Code::ModuleNameMismatch, mod.location, "module name `", mod.name, "' does not match filename");
+
+    for (size_t index = 0; index != mod.imports.size(); ++index) {
+        auto const& imp = mod.imports[index];
+        if (auto const [it, inserted] = importIds.emplace(imp.name, index); !inserted) {
+            log.warn(Code::DuplicateImport, imp.location, "module `", imp.name, "' is imported more than once");
+            log.info(Code::FirstDeclared, mod.imports[it->second].location, "first import of module `", imp.name, "'");
+        }
+    }
+
+    // every type declared by the module, including those of nested namespaces
+    std::vector<flat::Index> types;
+    for (flat::Index index = 0; index != mod.listedTypes.count; ++index) {
+        auto const& type = mod.types[index];
+        if (local(type.scope) && type.kind != Kind::TypeParam)
+            types.push_back(index);
+        else if (type.name == customTagName && mod.namespaces[type.scope].module == coreModule)
+            customTags = true;
+    }
 
-    // validate all types
-    for (auto const* type : mod.root->types)
-        success |= validate(*type);
+    followBases();
 
-    return success;
+    auto const batches = std::max<size_t>(1, (types.size() + batchSize - 1) / batchSize);
+    std::vector<std::unique_ptr<Checker>> checkers;
+    checkers.reserve(batches);
+    for (size_t batch = 0; batch != batches; ++batch)
+        checkers.push_back(std::make_unique<Checker>(*this, log.fork()));
+
+    auto const run = [this, &types, &checkers](size_t batch) {
+        auto& checker = *checkers[batch];
+        auto const first = batch * batchSize;
+        auto const last = std::min(types.size(), first + batchSize);
+        for (auto index = first; index != last && !checker.log.shouldStop(); ++index)
+            checker.check(mod.types[types[index]]);
+    };
+
+    // a pool only pays for itself with several batches to share out
+    if (batches == 1 || jobs == 1) {
+        for (size_t batch = 0; batch != batches; ++batch)
+            run(batch);
+    }
+    else {
+        ThreadPool pool(std::min<unsigned>(jobs == 0 ? std::max(1u, std::thread::hardware_concurrency()) : jobs, static_cast<unsigned>(batches)));
+        for (size_t batch = 0; batch != batches; ++batch)
+            pool.submit([&run, batch] { run(batch); });
+        pool.wait();
+    }
+
+    // constants and the module's own annotations are few, and are checked last
+    auto& last = *checkers.back();
+    for (auto const& constant : mod.slice(mod.constants, mod.listedConstants))
+        if (local(constant.scope))
+            last.check(constant);
+    last.check(mod.moduleAnnotations, mod.location);
+
+    std::vector<bool> used(mod.imports.size());
+    for (auto& checker : checkers) {
+        log.merge(std::move(checker->log));
+        for (size_t index = 0; index != used.size(); ++index)
+            if (checker->usedImports[index])
+                used[index] = true;
+    }
+
+    // a custom tag may come from an import without naming anything it declares,
+    // and imports aren't known to be unused if checking stopped early
+    if (!customTags && !log.shouldStop()) {
+        for (size_t index = 0; index != mod.imports.size(); ++index) {
+            auto const& imp = mod.imports[index];
+            if (!used[index] && importIds.at(imp.name) == index)
+                log.warn(Code::UnusedImport, imp.location, "module `", imp.name, "' is imported but not used");
+        }
+    }
+
+    return log.countErrors == errors;
 }
 
-bool sapc::Validator::validate(schema::Type const& type) {
+// each chain of base types is followed once, however many types share it, so
+// that checking every type stays linear in the length of the chains
+void sapc::Validator::followBases() {
+    using State = BaseChain::State;
+
+    baseChains.assign(mod.types.size(), BaseChain{});
+
+    std::vector<flat::Index> path;
+    for (flat::Index start = 0; start != mod.types.size(); ++start) {
+        BaseChain result;
+        for (auto current = start;;) {
+            auto& chain = baseChains[current];
+            if (chain.state == State::Visiting) {
+                result.state = State::Cycle;
+                break;
+            }
+            if (chain.state != State::Unvisited) {
+                result = chain;
+                break;
+            }
+
+            chain.state = State::Visiting;
+            path.push_back(current);
+
+            auto const& type = mod.types[current];
+            if (type.kind != Kind::Struct && type.kind != Kind::Specialized) {
+                result = BaseChain{ State::NotStruct, current };
+                break;
+            }
+            if (type.refType == flat::none) {
+                result.state = State::Ends;
+                break;
+            }
+            current = type.refType;
+        }
+
+        for (auto const index : path)
+            baseChains[index] = result;
+        path.clear();
+    }
+}
+
+sapc::Checker::Checker(Validator const& shared, Log&& log) : shared(shared), mod(shared.mod), log(std::move(log)), usedImports(shared.mod.imports.size()), visited(shared.mod.types.size()) {}
+
+void sapc::Checker::check(flat::Type const& type) {
+    check(type.annotations, type.location);
+
     switch (type.kind) {
-    case schema::Type::Kind::Struct:
-    case schema::Type::Kind::Attribute:
-    case schema::Type::Kind::Union:
-        return validate(static_cast<schema::TypeAggregate const&>(type));
-    default: return true;
+    case Kind::Struct:
+    case Kind::Attribute:
+    case Kind::Union:
+        checkAggregate(type);
+        break;
+    case Kind::Enum:
+        checkEnum(type);
+        break;
+    case Kind::Alias:
+    case Kind::Array:
+    case Kind::Pointer:
+    case Kind::Specialized:
+        use(type.refType);
+        for (auto const typeArg : mod.refsOf(type.typeArgs))
+            use(typeArg);
+        break;
+    default:
+        break;
     }
 }
 
-bool sapc::Validator::validate(schema::TypeAggregate const& type) {
-    bool success = true;
+void sapc::Checker::checkAggregate(flat::Type const& type) {
+    checkBase(type);
 
     // field names should be unique
-    {
-        std::unordered_map<std::string_view, schema::Field const*> fields;
-        for (auto const& field : type.fields) {
-            assert(!field->name.empty());
-            assert(field->type != nullptr);
-
-            auto const rs = fields.insert({ field->name, field.get() });
-            if (!rs.second) {
-                log.error(field->location, "duplicate field `", field->name, "' in type `", type.name, "'");
-                log.info(rs.first->second->location, "first declaration of field `", field->name, "'");
-                success = false;
-            }
+    fields.clear();
+    for (auto const& field : mod.slice(mod.fields, type.fields)) {
+        assert(!field.name.empty());
+        assert(field.type != flat::none);
+
+        auto const rs = fields.insert({ field.name, &field });
+        if (!rs.second) {
+            log.error(Code::DuplicateField, field.location, "duplicate field `", field.name, "' in type `", type.name, "'");
+            log.info(Code::FirstDeclared, rs.first->second->location, "first declaration of field `", field.name, "'");
+        }
+
+        use(field.type);
+        check(field.annotations, field.location);
+        if (field.defaultValue != flat::none)
+            check(mod.values[field.defaultValue], field.type, { "field", field.name }, field.location);
+    }
+}
+
+// a chain of base types must end, and must only hold structs
+void sapc::Checker::checkBase(flat::Type const& type) {
+    if (type.refType == flat::none)
+        return;
+    use(type.refType);
+
+    auto const& chain = shared.baseChains[type.refType];
+    if (chain.state == BaseChain::State::NotStruct) {
+        auto const& base = mod.types[chain.blame];
+        log.error(Code::BaseNotStruct, type.location, "base type `", base.qualifiedName, "' of `", type.name, "' is not a struct");
+        log.info(Code::DeclaredHere, base.location, base.name, ": type declared here");
+    }
+    else if (chain.state == BaseChain::State::Cycle)
+        log.error(Code::BaseCycle, type.location, "type `", type.name, "' inherits from itself");
+}
+
+void sapc::Checker::checkEnum(flat::Type const& type) {
+    // items must fit the underlying type, which is an int unless declared
+    long long min = intMin;
+    long long max = intMax;
+    if (type.refType != flat::none) {
+        use(type.refType);
+        if (!integerRange(type.refType, min, max)) {
+            auto const& base = mod.types[type.refType];
+            log.error(Code::EnumBaseNotInteger, type.location, "base type `", base.qualifiedName, "' of enumeration `", type.name, "' is not an integer type");
+            log.info(Code::DeclaredHere, base.location, base.name, ": type declared here");
+            min = intMin;
+            max = intMax;
         }
     }
 
-    return success;
+    // values may be shared, but that is usually a mistake when items are numbered by hand
+    values.clear();
+    for (auto const& item : mod.slice(mod.enumItems, type.items)) {
+        check(item.annotations, item.location);
+
+        if (item.value < min || item.value > max)
+            log.error(Code::EnumValueRange, item.location, "value ", item.value, " of enumeration item `", item.name, "' is out of range for `", type.name, "'");
+
+        auto const rs = values.insert({ item.value, &item });
+        if (!rs.second) {
+            log.warn(Code::DuplicateEnumValue, item.location, "enumeration item `", item.name, "' has the same value as `", rs.first->second->name, "' in `", type.name, "'");
+            log.info(Code::FirstDeclared, rs.first->second->location, "first item with value ", item.value);
+        }
+    }
+}
+
+void sapc::Checker::check(flat::Constant const& constant) {
+    use(constant.type);
+    check(constant.annotations, constant.location);
+    check(mod.values[constant.value], constant.type, { "constant", constant.name }, constant.location);
+}
+
+// arguments are checked against the fields of the attribute
+void sapc::Checker::check(flat::Range annotations, Location const& loc) {
+    use(annotations);
+
+    for (auto const& annotation : mod.slice(mod.annotations, annotations)) {
+        auto const& attribute = mod.types[annotation.type];
+        if (attribute.kind != Kind::Attribute)
+            continue;
+
+        auto const params = mod.slice(mod.fields, attribute.fields);
+        auto const args = mod.slice(mod.values, annotation.args);
+        if (params.size() != args.size())
+            continue; // already reported by the compiler
+
+        for (size_t index = 0; index != args.size(); ++index)
+            check(args[index], params[index].type, { "argument", params[index].name }, annotation.location.file != 0 ? annotation.location : loc);
+    }
+}
+
+void sapc::Checker::check(flat::Value const& value, flat::Index type, Subject const& subject, Location const& loc) {
+    if (type == flat::none)
+        return;
+
+    // aliases accept the values of the type they name
+    type = resolveAlias(type);
+
+    auto const& target = mod.types[type];
+    auto const mismatch = [this, &value, &target, &subject, &loc](char const* expected) {
+        log.error(Code::ValueKind, loc, subject.what, " `", subject.name, "' of type `", target.qualifiedName, "' expects ", expected, ", got ", describe(value.kind));
+    };
+
+    // null, and {} as in C++, initialize any type
+    if (value.kind == flat::ValueKind::Null || (value.kind == flat::ValueKind::Array && value.elements.count == 0))
+        return;
+
+    switch (target.kind) {
+    case Kind::Simple: {
+        if (mod.namespaces[target.scope].module != shared.coreModule)
+            return;
+
+        if (target.name == shared.stringName) {
+            if (value.kind != flat::ValueKind::String)
+                mismatch("a string");
+        }
+        else if (target.name == shared.boolName) {
+            if (value.kind != flat::ValueKind::Bool)
+                mismatch("a boolean");
+        }
+        else if (target.name == shared.floatName) {
+            if (value.kind != flat::ValueKind::Integer)
+                mismatch("a number");
+        }
+        else if (long long min = 0, max = 0; integerRange(type, min, max)) {
+            if (value.kind != flat::ValueKind::Integer)
+                mismatch("an integer");
+            else if (value.number < min || value.number > max)
+                log.error(Code::ValueRange, loc, subject.what, " `", subject.name, "' value ", value.number, " is out of range for `", target.qualifiedName, "'");
+        }
+        break;
+    }
+    case Kind::TypeId:
+        if (value.kind != flat::ValueKind::TypeName)
+            mismatch("a type name");
+        break;
+    case Kind::Enum:
+        if (value.kind != flat::ValueKind::Enum)
+            mismatch("an enumeration item");
+        else if (auto const& item = mod.enumItems[value.index]; item.parent != type)
+            log.error(Code::ValueItem, loc, subject.what, " `", subject.name, "' expects an item of `", target.qualifiedName, "', got `", mod.types[item.parent].qualifiedName, ".", item.name, "'");
+        break;
+    case Kind::Array:
+        if (value.kind != flat::ValueKind::Array)
+            mismatch("an array");
+        else {
+            auto const elements = mod.slice(mod.values, value.elements);
+            if (target.arraySize && static_cast<long long>(elements.size()) > *target.arraySize)
+                log.error(Code::ArraySize, loc, subject.what, " `", subject.name, "' has ", elements.size(), " elements, but `", target.qualifiedName, "' holds ", *target.arraySize);
+            for (auto const& element : elements)
+                check(element, target.refType, subject, loc);
+        }
+        break;
+    default:
+        // structs and other composite types have no literal form to check
+        break;
+    }
+}
+
+sapc::flat::Index sapc::Checker::resolveAlias(flat::Index type) const noexcept {
+    for (size_t depth = 0; mod.types[type].kind == Kind::Alias && mod.types[type].refType != flat::none && depth != mod.types.size(); ++depth)
+        type = mod.types[type].refType;
+    return type;
+}
+
+// the values the generated C++ type can hold, for the built-in integer types
+bool sapc::Checker::integerRange(flat::Index type, long long& min, long long& max) const noexcept {
+    auto const& target = mod.types[resolveAlias(type)];
+    if (target.kind != Kind::Simple || mod.namespaces[target.scope].module != shared.coreModule)
+        return false;
+
+    if (target.name == shared.intName) {
+        min = intMin;
+        max = intMax;
+        return true;
+    }
+    if (target.name == shared.byteName) {
+        min = 0;
+        max = 255;
+        return true;
+    }
+    return false;
+}
+
+// records which imports are referenced, looking through derived types to what they are built from
+void sapc::Checker::use(flat::Index type) {
+    if (type == flat::none || visited[type])
+        return;
+    visited[type] = true;
+
+    auto const& record = mod.types[type];
+    if (auto const it = shared.importIds.find(mod.namespaces[record.scope].module); it != shared.importIds.end())
+        usedImports[it->second] = true;
+
+    if (record.kind == Kind::Array || record.kind == Kind::Pointer || record.kind == Kind::Specialized) {
+        use(record.refType);
+        for (auto const typeArg : mod.refsOf(record.typeArgs))
+            use(typeArg);
+    }
+}
+
+void sapc::Checker::use(flat::Range annotations) {
+    for (auto const& annotation : mod.slice(mod.annotations, annotations)) {
+        use(annotation.type);
+        for (auto const& arg : mod.slice(mod.values, annotation.args))
+            use(arg);
+    }
+}
+
+void sapc::Checker::use(flat::Value const& value) {
+    if (value.kind == flat::ValueKind::TypeName)
+        use(value.index);
+    else if (value.kind == flat::ValueKind::Enum)
+        use(mod.enumItems[value.index].parent);
+    else if (value.kind == flat::ValueKind::Array)
+        for (auto const& element : mod.slice(mod.values, value.elements))
+            use(element);
 }
@@ -6,9 +6,12 @@
 
 namespace sapc {
     struct Log;
-    namespace schema {
+    namespace flat {
         struct Module;
     }
 
-    bool validate(schema::Module const& mod, Log& log);
+    // checks run in parallel over the declared types with up to `jobs`
+    // threads, 0 using every core; diagnostics come in the same order however
+    // many threads are used
+    bool validate(flat::Module const& mod, Log& log, unsigned jobs = 1);
 }
@@ -0,0 +1,10 @@
+#include "first.h"
+#include "second.h"
+
+int main() {
+    [[maybe_unused]] st::Moved moved = {};
+    moved.position.x = 1;
+
+    [[maybe_unused]] st::Stopped stopped = {};
+    stopped.path.push_back(moved.position);
+}
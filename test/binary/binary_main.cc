@@ -0,0 +1,110 @@
+#include <sapc/binary.hh>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace sapc::binary;
+
+static Type const* findType(View const& view, std::string_view qualified) {
+    for (auto const& type : view.types())
+        if (view.string(type.qualified) == qualified)
+            return &type;
+    return nullptr;
+}
+
+static int fail(char const* message) {
+    std::cerr << "error: " << message << '\n';
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2)
+        return fail("expected the path to a binary schema");
+
+    std::ifstream stream(argv[1], std::ios::binary);
+    std::ostringstream contents;
+    contents << stream.rdbuf();
+    auto const bytes = contents.str();
+
+    // the view requires 8-byte alignment, which a std::string doesn't promise
+    std::vector<std::uint64_t> buffer((bytes.size() + 7) / 8);
+    std::copy(bytes.begin(), bytes.end(), reinterpret_cast<char*>(buffer.data()));
+
+    View const view(buffer.data(), bytes.size());
+    if (!view.valid())
+        return fail("invalid binary schema");
+    if (view.moduleName() != "binary_test")
+        return fail("wrong module name");
+
+    auto const* color = findType(view, "color");
+    if (color == nullptr || color->kind != TypeKind::Enum)
+        return fail("missing enum");
+    auto const items = view.items(color->items);
+    if (items.size() != 3 || view.string(items[1].name) != "green" || items[1].value != 2 || items[2].value != 8)
+        return fail("wrong enum items");
+
+    auto const* point = findType(view, "point");
+    if (point == nullptr || point->kind != TypeKind::Struct)
+        return fail("missing struct");
+    auto const annotations = view.annotations(point->annotations);
+    if (annotations.size() != 1 || view.string(annotations[0].type) != "tag")
+        return fail("wrong struct annotations");
+    auto const tagArgs = view.values(annotations[0].args);
+    if (tagArgs.size() != 1 || tagArgs[0].kind != ValueKind::String || view.string(tagArgs[0].first) != "point")
+        return fail("wrong annotation arguments");
+    if (point->location.line != 12 || view.string(point->location.filename).find("sap") == std::string_view::npos)
+        return fail("wrong struct location");
+
+    auto const pointFields = view.fields(point->fields);
+    if (pointFields.size() != 2 || view.string(pointFields[1].type) != "int")
+        return fail("wrong struct fields");
+    auto const* y = view.value(pointFields[1].defaultValue);
+    if (y == nullptr || y->kind != ValueKind::Integer || y->number != -2)
+        return fail("wrong field default");
+
+    auto const* shape = findType(view, "shape");
+    if (shape == nullptr)
+        return fail("missing struct");
+    auto const shapeFields = view.fields(shape->fields);
+    if (shapeFields.size() != 3)
+        return fail("wrong struct fields");
+
+    auto const* points = view.value(shapeFields[1].defaultValue);
+    if (points == nullptr || points->kind != ValueKind::Array)
+        return fail("wrong array default");
+    auto const elements = view.elements(*points);
+    if (elements.size() != 2 || elements[1].kind != ValueKind::Array)
+        return fail("wrong array elements");
+    auto const second = view.elements(elements[1]);
+    if (second.size() != 2 || second[0].number != 3 || second[1].number != 4)
+        return fail("wrong nested array elements");
+
+    auto const* array = findType(view, view.string(shapeFields[1].type));
+    if (array == nullptr || array->kind != TypeKind::Array || view.string(array->refType) != "point")
+        return fail("missing array type");
+
+    auto const* fill = view.value(shapeFields[2].defaultValue);
+    if (fill == nullptr || fill->kind != ValueKind::Enum || view.string(fill->second) != "green" || fill->number != 2)
+        return fail("wrong enum default");
+
+    if (view.constants().size() != 1 || view.string(view.constants()[0].qualified) != "geometry.origin")
+        return fail("wrong constants");
+    if (view.string(view.constants()[0].ns) != "geometry")
+        return fail("wrong constant namespace");
+
+    if (view.namespaces().size() != 1)
+        return fail("wrong namespaces");
+    auto const nsConstants = view.strings(view.namespaces()[0].constants);
+    if (nsConstants.size() != 1 || view.string(nsConstants[0]) != "geometry.origin")
+        return fail("wrong namespace constants");
+
+    // a truncated file must be rejected rather than read out of bounds
+    if (View(buffer.data(), bytes.size() / 2).valid())
+        return fail("truncated schema accepted");
+
+    return 0;
+}
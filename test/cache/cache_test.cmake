@@ -0,0 +1,113 @@
+# Compiles a schema into a fresh cache, then verifies that repeated compiles
+# reproduce the same output, that editing an import or hiding it behind a new
+# file in an earlier search path invalidates the entry, that an entry stored
+# for another input is never served, and that checkouts at different roots
+# share entries
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+file(COPY ${SOURCE_DIR}/cache_base.sap ${SOURCE_DIR}/cache_test.sap DESTINATION ${WORK_DIR})
+
+function(compile_schema OUTPUT)
+    execute_process(
+        COMMAND ${SAPC} --cache-dir ${WORK_DIR}/cache ${ARGN} -o ${WORK_DIR}/${OUTPUT} ${WORK_DIR}/cache_test.sap
+        RESULT_VARIABLE RESULT
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "sapc failed with ${RESULT}")
+    endif()
+endfunction()
+
+compile_schema(first.json)
+file(GLOB ENTRIES ${WORK_DIR}/cache/*.sapcache)
+list(LENGTH ENTRIES NUM_ENTRIES)
+if(NOT NUM_ENTRIES EQUAL 1)
+    message(FATAL_ERROR "expected one cache entry, found ${NUM_ENTRIES}")
+endif()
+
+compile_schema(second.json)
+file(READ ${WORK_DIR}/first.json FIRST)
+file(READ ${WORK_DIR}/second.json SECOND)
+if(NOT FIRST STREQUAL SECOND)
+    message(FATAL_ERROR "cached output differs from compiled output")
+endif()
+
+# shifting the declarations changes the locations recorded in the output
+file(READ ${WORK_DIR}/cache_base.sap BASE)
+file(WRITE ${WORK_DIR}/cache_base.sap "// edited\n${BASE}")
+compile_schema(third.json)
+file(READ ${WORK_DIR}/third.json THIRD)
+if(NOT THIRD MATCHES "\"Base\"" OR FIRST STREQUAL THIRD)
+    message(FATAL_ERROR "modified import did not invalidate the cache entry")
+endif()
+
+# the import is found in the later of two search paths, until a file added
+# to the earlier one hides it
+file(MAKE_DIRECTORY ${WORK_DIR}/early ${WORK_DIR}/late)
+file(RENAME ${WORK_DIR}/cache_base.sap ${WORK_DIR}/late/cache_base.sap)
+compile_schema(fourth.json -I ${WORK_DIR}/early -I ${WORK_DIR}/late)
+compile_schema(fifth.json -I ${WORK_DIR}/early -I ${WORK_DIR}/late)
+file(READ ${WORK_DIR}/fourth.json FOURTH)
+file(READ ${WORK_DIR}/fifth.json FIFTH)
+if(NOT FOURTH STREQUAL FIFTH)
+    message(FATAL_ERROR "cached output from search paths differs from compiled output")
+endif()
+
+file(WRITE ${WORK_DIR}/early/cache_base.sap "module cache_base;\n\nstruct Base {\n    int shadowing;\n}\n")
+compile_schema(sixth.json -I ${WORK_DIR}/early -I ${WORK_DIR}/late)
+file(READ ${WORK_DIR}/sixth.json SIXTH)
+if(NOT SIXTH MATCHES "\"shadowing\"")
+    message(FATAL_ERROR "import hidden by an earlier search path did not invalidate the cache entry")
+endif()
+
+# an entry whose name collides with another key's must not be served
+file(REMOVE_RECURSE ${WORK_DIR}/cache)
+compile_schema(seventh.json -I ${WORK_DIR}/early)
+file(GLOB ENTRIES ${WORK_DIR}/cache/*.sapcache)
+file(WRITE ${WORK_DIR}/other.sap "module other;\n\nstruct Other {\n    int other;\n}\n")
+execute_process(
+    COMMAND ${SAPC} --cache-dir ${WORK_DIR}/cache -o ${WORK_DIR}/other.json ${WORK_DIR}/other.sap
+    RESULT_VARIABLE RESULT
+)
+file(GLOB ALL_ENTRIES ${WORK_DIR}/cache/*.sapcache)
+list(REMOVE_ITEM ALL_ENTRIES ${ENTRIES})
+if(NOT RESULT EQUAL 0 OR NOT ALL_ENTRIES)
+    message(FATAL_ERROR "sapc failed with ${RESULT} on other.sap")
+endif()
+configure_file(${ENTRIES} ${ALL_ENTRIES} COPYONLY)
+execute_process(
+    COMMAND ${SAPC} --cache-dir ${WORK_DIR}/cache -o ${WORK_DIR}/other.json ${WORK_DIR}/other.sap
+    RESULT_VARIABLE RESULT
+)
+file(READ ${WORK_DIR}/other.json OTHER)
+if(NOT RESULT EQUAL 0 OR NOT OTHER MATCHES "\"Other\"")
+    message(FATAL_ERROR "an entry stored for another input was served")
+endif()
+
+# relative inputs compiled in one checkout are cached for another
+function(compile_checkout ROOT)
+    file(MAKE_DIRECTORY ${WORK_DIR}/${ROOT})
+    file(COPY ${SOURCE_DIR}/cache_base.sap ${SOURCE_DIR}/cache_test.sap DESTINATION ${WORK_DIR}/${ROOT})
+    execute_process(
+        COMMAND ${SAPC} --stats --cache-dir ${WORK_DIR}/shared -o out.json -d out.d cache_test.sap
+        WORKING_DIRECTORY ${WORK_DIR}/${ROOT}
+        RESULT_VARIABLE RESULT
+        ERROR_VARIABLE STATS
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "sapc failed with ${RESULT} in ${ROOT}")
+    endif()
+    set(STATS ${STATS} PARENT_SCOPE)
+endfunction()
+
+compile_checkout(checkout_a)
+compile_checkout(checkout_b)
+if(NOT STATS MATCHES "modules: 0,")
+    message(FATAL_ERROR "a second checkout did not reuse the cache entry")
+endif()
+file(READ ${WORK_DIR}/checkout_a/out.json CHECKOUT_A)
+file(READ ${WORK_DIR}/checkout_b/out.json CHECKOUT_B)
+file(READ ${WORK_DIR}/checkout_b/out.d DEPS_B)
+if(NOT CHECKOUT_A STREQUAL CHECKOUT_B OR DEPS_B MATCHES "checkout_a")
+    message(FATAL_ERROR "cached output from another checkout differs")
+endif()
@@ -0,0 +1,28 @@
+# Derived types are shared between modules; each module that uses one must
+# list it exactly once, even when another module built it first
+
+execute_process(
+    COMMAND ${SAPC} -I ${SOURCE_DIR} -o ${WORK_DIR}/derived_test.json ${SOURCE_DIR}/derived_test.sap
+    RESULT_VARIABLE RESULT
+)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "sapc failed with ${RESULT}")
+endif()
+file(READ ${WORK_DIR}/derived_test.json JSON)
+
+string(JSON NUM_TYPES LENGTH "${JSON}" types)
+math(EXPR LAST_TYPE "${NUM_TYPES} - 1")
+set(ARRAYS 0)
+set(POINTERS 0)
+foreach(INDEX RANGE ${LAST_TYPE})
+    string(JSON NAME GET "${JSON}" types ${INDEX} name)
+    if(NAME STREQUAL "element[]")
+        math(EXPR ARRAYS "${ARRAYS} + 1")
+    elseif(NAME STREQUAL "element*")
+        math(EXPR POINTERS "${POINTERS} + 1")
+    endif()
+endforeach()
+
+if(NOT ARRAYS EQUAL 1 OR NOT POINTERS EQUAL 1)
+    message(FATAL_ERROR "element[] is listed ${ARRAYS} times and element* ${POINTERS} times, expected once each")
+endif()
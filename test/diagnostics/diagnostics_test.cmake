@@ -0,0 +1,134 @@
+# Checks that --max-errors stops reporting after the limit, in the compiler
+# and in parallel validation, that --sarif records the diagnostics of
+# compiled and cached inputs alike, and that nesting limits are enforced
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+function(run_sapc OUT_RESULT OUT_ERRORS)
+    execute_process(
+        COMMAND ${SAPC} -o ${WORK_DIR}/out.json ${ARGN}
+        RESULT_VARIABLE RESULT
+        ERROR_VARIABLE ERRORS
+    )
+    set(${OUT_RESULT} ${RESULT} PARENT_SCOPE)
+    set(${OUT_ERRORS} "${ERRORS}" PARENT_SCOPE)
+endfunction()
+
+function(expect_errors ERRORS EXPECTED)
+    string(REGEX MATCHALL "error C2[0-9][0-9][0-9]" FOUND "${ERRORS}")
+    list(LENGTH FOUND COUNT)
+    if(NOT COUNT EQUAL EXPECTED)
+        message(FATAL_ERROR "expected ${EXPECTED} errors, got ${COUNT}:\n${ERRORS}")
+    endif()
+endfunction()
+
+# every struct names an unknown type, failing in the compiler
+set(SOURCE "module unknown;\n")
+foreach(INDEX RANGE 1 200)
+    string(APPEND SOURCE "struct type${INDEX} { missing${INDEX} value; }\n")
+endforeach()
+file(WRITE ${WORK_DIR}/unknown.sap "${SOURCE}")
+
+run_sapc(RESULT ERRORS ${WORK_DIR}/unknown.sap)
+if(NOT RESULT EQUAL 2)
+    message(FATAL_ERROR "expected the compile to fail with 2, got ${RESULT}:\n${ERRORS}")
+endif()
+expect_errors("${ERRORS}" 200)
+
+run_sapc(RESULT ERRORS --max-errors=5 ${WORK_DIR}/unknown.sap)
+if(NOT RESULT EQUAL 2)
+    message(FATAL_ERROR "expected the limited compile to fail with 2, got ${RESULT}:\n${ERRORS}")
+endif()
+expect_errors("${ERRORS}" 5)
+string(FIND "${ERRORS}" "missing5" FOUND)
+if(FOUND EQUAL -1)
+    message(FATAL_ERROR "the first errors should be kept:\n${ERRORS}")
+endif()
+string(FIND "${ERRORS}" "Stopped after 5 errors" FOUND)
+if(FOUND EQUAL -1)
+    message(FATAL_ERROR "the limit should be reported:\n${ERRORS}")
+endif()
+
+# enough types for several validation batches, each with a duplicate field
+set(SOURCE "module duplicates;\n")
+foreach(INDEX RANGE 1 1500)
+    string(APPEND SOURCE "struct type${INDEX} { int value; int value; }\n")
+endforeach()
+file(WRITE ${WORK_DIR}/duplicates.sap "${SOURCE}")
+
+foreach(JOBS 1 4)
+    run_sapc(RESULT ERRORS -j ${JOBS} --max-errors 10 ${WORK_DIR}/duplicates.sap)
+    if(NOT RESULT EQUAL 4)
+        message(FATAL_ERROR "expected validation with ${JOBS} jobs to fail with 4, got ${RESULT}:\n${ERRORS}")
+    endif()
+    expect_errors("${ERRORS}" 10)
+endforeach()
+
+run_sapc(RESULT ERRORS --sarif ${WORK_DIR}/unknown.sarif ${WORK_DIR}/unknown.sap)
+file(READ ${WORK_DIR}/unknown.sarif SARIF)
+string(JSON VERSION GET "${SARIF}" version)
+string(JSON TOOL GET "${SARIF}" runs 0 tool driver name)
+string(JSON COUNT LENGTH "${SARIF}" runs 0 results)
+string(JSON RULE GET "${SARIF}" runs 0 results 0 ruleId)
+string(JSON LEVEL GET "${SARIF}" runs 0 results 0 level)
+string(JSON TEXT GET "${SARIF}" runs 0 results 0 message text)
+string(JSON LINE GET "${SARIF}" runs 0 results 0 locations 0 physicalLocation region startLine)
+string(JSON URI GET "${SARIF}" runs 0 results 0 locations 0 physicalLocation artifactLocation uri)
+if(NOT VERSION STREQUAL "2.1.0" OR NOT TOOL STREQUAL "sapc" OR NOT COUNT EQUAL 200 OR NOT RULE STREQUAL "C2401" OR NOT LEVEL STREQUAL "error" OR NOT LINE EQUAL 2)
+    message(FATAL_ERROR "unexpected SARIF log:\n${SARIF}")
+endif()
+if(NOT TEXT MATCHES "missing1" OR NOT URI MATCHES "unknown.sap$")
+    message(FATAL_ERROR "unexpected SARIF result:\n${SARIF}")
+endif()
+
+# warnings of a cached compile are replayed into the SARIF log
+file(WRITE ${WORK_DIR}/renamed.sap "module other;\nstruct type { int value; }\n")
+foreach(PASS compiled cached)
+    run_sapc(RESULT ERRORS --cache-dir ${WORK_DIR}/cache --sarif ${WORK_DIR}/${PASS}.sarif ${WORK_DIR}/renamed.sap)
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "expected the ${PASS} compile to succeed, got ${RESULT}:\n${ERRORS}")
+    endif()
+    file(READ ${WORK_DIR}/${PASS}.sarif SARIF)
+    string(JSON COUNT LENGTH "${SARIF}" runs 0 results)
+    string(JSON RULE GET "${SARIF}" runs 0 results 0 ruleId)
+    string(JSON LEVEL GET "${SARIF}" runs 0 results 0 level)
+    string(JSON LINE GET "${SARIF}" runs 0 results 0 locations 0 physicalLocation region startLine)
+    if(NOT COUNT EQUAL 1 OR NOT RULE STREQUAL "C4103" OR NOT LEVEL STREQUAL "warning" OR NOT LINE EQUAL 1)
+        message(FATAL_ERROR "unexpected SARIF log of the ${PASS} compile:\n${SARIF}")
+    endif()
+endforeach()
+file(READ ${WORK_DIR}/compiled.sarif COMPILED)
+file(READ ${WORK_DIR}/cached.sarif CACHED)
+if(NOT COMPILED STREQUAL CACHED)
+    message(FATAL_ERROR "cached diagnostics differ:\n${COMPILED}\n${CACHED}")
+endif()
+
+# nesting past the limit is an error, rather than recursing without bound
+string(REPEAT "namespace n { " 300 OPEN)
+string(REPEAT "}" 300 CLOSE)
+file(WRITE ${WORK_DIR}/nested.sap "module nested;\n${OPEN}${CLOSE}\n")
+string(REPEAT "box<" 300 OPEN)
+string(REPEAT ">" 300 CLOSE)
+file(WRITE ${WORK_DIR}/generic.sap "module generic;\nstruct box<T> { T value; }\nstruct holder { ${OPEN}int${CLOSE} value; }\n")
+string(REPEAT "{" 300 OPEN)
+string(REPEAT "}" 300 CLOSE)
+file(WRITE ${WORK_DIR}/literal.sap "module literal;\nconst int[] values = ${OPEN}${CLOSE};\n")
+foreach(NAME nested generic literal)
+    run_sapc(RESULT ERRORS ${WORK_DIR}/${NAME}.sap)
+    if(RESULT EQUAL 0 OR NOT ERRORS MATCHES "nested more than 256 deep")
+        message(FATAL_ERROR "expected ${NAME}.sap to fail on its nesting, got ${RESULT}:\n${ERRORS}")
+    endif()
+endforeach()
+
+# chains of base types have no limit, as they are followed without recursion
+set(SOURCE "module bases;\nstruct type0 { int value; }\n")
+foreach(INDEX RANGE 1 300)
+    math(EXPR BASE "${INDEX} - 1")
+    string(APPEND SOURCE "struct type${INDEX} : type${BASE} { int value${INDEX}; }\n")
+endforeach()
+file(WRITE ${WORK_DIR}/bases.sap "${SOURCE}")
+run_sapc(RESULT ERRORS ${WORK_DIR}/bases.sap)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "expected a long chain of bases to compile, got ${RESULT}:\n${ERRORS}")
+endif()
@@ -1,5 +1,65 @@
 #include "enum_test.h"
 
-int main() {
+#include <sapc/binary.hh>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// the header declares the base, so the enum has the size of a byte
+static_assert(std::is_same_v<std::underlying_type_t<st::Small>, unsigned char>);
+static_assert(sizeof(st::Small) == 1);
+
+static int fail(char const* message) {
+    std::cerr << "error: " << message << '\n';
+    return 1;
+}
+
+static std::string load(char const* filename) {
+    std::ifstream stream(filename, std::ios::binary);
+    std::ostringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+}
+
+int main(int argc, char* argv[]) {
     [[maybe_unused]] st::Color color = st::Color::Red;
+    if (static_cast<int>(st::Small::High) != 200)
+        return fail("wrong enum value");
+
+    if (argc != 3)
+        return fail("expected the paths to the JSON and binary schemas");
+
+    // only the enum with a declared base has one
+    auto const json = load(argv[1]);
+    auto const small = json.find("\"name\": \"Small\"");
+    auto const base = json.find("\"base\": \"byte\"");
+    if (small == std::string::npos || base == std::string::npos || base < small || json.find("\"base\"") != base)
+        return fail("JSON lacks the enum base");
+
+    auto const bytes = load(argv[2]);
+    std::vector<std::uint64_t> buffer((bytes.size() + 7) / 8);
+    std::copy(bytes.begin(), bytes.end(), reinterpret_cast<char*>(buffer.data()));
+    sapc::binary::View const view(buffer.data(), bytes.size());
+    if (!view.valid())
+        return fail("invalid binary schema");
+
+    bool found = false;
+    for (auto const& type : view.types()) {
+        auto const name = view.string(type.qualified);
+        if (name == "Small" && view.string(type.refType) != "byte")
+            return fail("binary lacks the enum base");
+        if (name == "Color" && type.refType != sapc::binary::none)
+            return fail("binary has a base for an enum without one");
+        found = found || name == "Small";
+    }
+    if (!found)
+        return fail("binary lacks the enum");
+
+    return 0;
 }
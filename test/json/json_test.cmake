@@ -0,0 +1,80 @@
+# Compiles a schema with each JSON output mode and checks the shape of the
+# document; compact output must hold the same data as the indented output
+
+function(compile_schema OUTPUT)
+    execute_process(
+        COMMAND ${SAPC} ${ARGN} -o ${WORK_DIR}/${OUTPUT} ${SOURCE_DIR}/json_test.sap
+        RESULT_VARIABLE RESULT
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "sapc ${ARGN} failed with ${RESULT}")
+    endif()
+    file(READ ${WORK_DIR}/${OUTPUT} CONTENTS)
+    set(JSON ${CONTENTS} PARENT_SCOPE)
+endfunction()
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+compile_schema(full.json)
+set(FULL ${JSON})
+
+compile_schema(compact.json --compact)
+string(STRIP "${JSON}" COMPACT)
+if(COMPACT MATCHES "\n" OR COMPACT MATCHES "\": ")
+    message(FATAL_ERROR "compact output contains whitespace")
+endif()
+
+# every value of the indented output must be present in the compact output
+string(JSON NUM_TYPES LENGTH "${FULL}" types)
+string(JSON NUM_COMPACT_TYPES LENGTH "${COMPACT}" types)
+if(NOT NUM_TYPES EQUAL NUM_COMPACT_TYPES)
+    message(FATAL_ERROR "compact output has ${NUM_COMPACT_TYPES} types, expected ${NUM_TYPES}")
+endif()
+math(EXPR LAST_TYPE "${NUM_TYPES} - 1")
+foreach(INDEX RANGE ${LAST_TYPE})
+    string(JSON TYPE GET "${FULL}" types ${INDEX})
+    string(JSON COMPACT_TYPE GET "${COMPACT}" types ${INDEX})
+    string(JSON EQUAL EQUAL "${TYPE}" "${COMPACT_TYPE}")
+    if(NOT EQUAL)
+        message(FATAL_ERROR "compact output differs for type ${INDEX}")
+    endif()
+endforeach()
+
+compile_schema(none.json --locations=none)
+if(JSON MATCHES "\"location\"" OR JSON MATCHES "\"files\"")
+    message(FATAL_ERROR "locations were written with --locations=none")
+endif()
+
+compile_schema(files.json --locations files)
+if(JSON MATCHES "\"filename\": \"[^\"]*json_test.sap\"")
+    message(FATAL_ERROR "filenames were written in locations with --locations=files")
+endif()
+string(JSON TYPE_NAME GET "${JSON}" types 1 name)
+string(JSON FILE_INDEX GET "${JSON}" types 1 location file)
+string(JSON FILENAME GET "${JSON}" files ${FILE_INDEX})
+if(NOT TYPE_NAME STREQUAL "tag" OR NOT FILENAME MATCHES "json_test.sap$")
+    message(FATAL_ERROR "location of '${TYPE_NAME}' refers to '${FILENAME}'")
+endif()
+
+# imported types are listed in the order that a depth-first walk reaches them,
+# with a generic's base and fields ahead of its type parameters
+execute_process(
+    COMMAND ${SAPC} -o ${WORK_DIR}/generic.json ${SOURCE_DIR}/json_generic_use.sap
+    RESULT_VARIABLE RESULT
+)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "sapc failed with ${RESULT} on json_generic_use.sap")
+endif()
+file(READ ${WORK_DIR}/generic.json JSON)
+set(ORDER)
+string(JSON NUM_TYPES LENGTH "${JSON}" types)
+math(EXPR LAST_TYPE "${NUM_TYPES} - 1")
+foreach(INDEX RANGE ${LAST_TYPE})
+    string(JSON QUALIFIED GET "${JSON}" types ${INDEX} qualified)
+    list(APPEND ORDER "${QUALIFIED}")
+endforeach()
+set(EXPECTED "Box;Base;int;Box.T;Elem;Box<Elem>;User;Holder")
+if(NOT ORDER STREQUAL EXPECTED)
+    message(FATAL_ERROR "imported types are ordered '${ORDER}', expected '${EXPECTED}'")
+endif()
@@ -0,0 +1,179 @@
+#include <sapc/flat.hh>
+#include <sapc/sapc.hh>
+
+#include "context.hh"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace fs = std::filesystem;
+using namespace sapc;
+
+static schema::Type const* findType(schema::Module const& mod, std::string_view qualified) {
+    for (auto const* type : mod.types)
+        if (type->qualifiedName == qualified)
+            return type;
+    return nullptr;
+}
+
+static size_t countFields(schema::Module const& mod, std::string_view qualified) {
+    auto const* type = findType(mod, qualified);
+    if (type == nullptr || type->kind != schema::Type::Kind::Struct)
+        return 0;
+    return static_cast<schema::TypeAggregate const*>(type)->fields.size();
+}
+
+static int fail(char const* message, Session::Result const& result = {}) {
+    std::cerr << "error: " << message << '\n';
+    for (auto const& line : result.diagnostics)
+        std::cerr << line << '\n';
+    return 1;
+}
+
+int main() {
+    Session session;
+
+    // every module lives in memory, under a directory that doesn't exist
+    session.resolver = [](std::string_view name, fs::path const&) {
+        if (name == "missing")
+            return fs::path{};
+        return fs::path{ "memory" } / (std::string{ name } + ".sap");
+    };
+    session.setSource("memory/shapes.sap", "module shapes;\nstruct point { int x; int y; }\n");
+    session.setSource("memory/drawing.sap", "module drawing;\nimport shapes;\nstruct line { point from; point to; }\n");
+
+    auto const first = session.compile("memory/drawing.sap");
+    if (!first)
+        return fail("in-memory compile failed", first);
+    if (first.module->name != "drawing" || first.dependencies.size() != 2)
+        return fail("unexpected module or dependencies", first);
+    if (countFields(*first.module, "line") != 2 || countFields(*first.module, "point") != 2)
+        return fail("unexpected fields", first);
+
+    auto const* const line = static_cast<schema::TypeAggregate const*>(findType(*first.module, "line"));
+    auto const position = session.files().position(line->location.file, line->location.start);
+    if (session.files().path(line->location.file) != "memory/drawing.sap" || position.line != 3)
+        return fail("unexpected location", first);
+
+    // unchanged sources reuse the compiled module
+    auto const again = session.compile("memory/drawing.sap");
+    if (again.module != first.module)
+        return fail("unchanged module was recompiled", again);
+
+    // replacing an import recompiles its importers, releasing the old modules
+    session.setSource("memory/shapes.sap", "module shapes;\nstruct point { int x; int y; int z; }\n");
+    auto const changed = session.compile("memory/drawing.sap");
+    if (!changed || countFields(*changed.module, "point") != 3 || session.context->builtModules.size() != 2)
+        return fail("changed import was not recompiled", changed);
+
+    // the flat form lists the same types, with references as indices
+    auto const flat = flatten(*changed.module);
+    if (flat.listedTypes.count != changed.module->types.size())
+        return fail("flat form lists different types", changed);
+    for (auto const& type : flat.slice(flat.types, flat.listedTypes)) {
+        if (type.qualifiedName != "point")
+            continue;
+        auto const fields = flat.slice(flat.fields, type.fields);
+        if (fields.size() != 3 || fields[2].name != "z" || flat.types[fields[2].type].qualifiedName != "int")
+            return fail("flat form has unexpected fields", changed);
+    }
+
+    std::ostringstream json;
+    session.writeJson(json, *changed.module, true);
+    if (json.str().find("\"name\":\"line\"") == std::string::npos)
+        return fail("JSON output lacks the line type", changed);
+
+    // only the selected types, and those they use, are written
+    session.only = { "point" };
+    std::ostringstream selected;
+    session.writeJson(selected, *changed.module, true);
+    session.only.clear();
+    if (selected.str().find("\"name\":\"line\"") != std::string::npos || selected.str().find("\"name\":\"point\"") == std::string::npos)
+        return fail("JSON output was not narrowed to the selected type", changed);
+
+    // errors are reported as diagnostics rather than printed
+    session.setSource("memory/broken.sap", "module broken;\nimport missing;\n");
+    auto const broken = session.compile("memory/broken.sap");
+    if (broken || broken.errors == 0 || broken.diagnostics.empty() || broken.diagnostics.front().find("module not found") == std::string::npos)
+        return fail("missing import was not reported", broken);
+
+    // a module that failed to compile is built again, from a fresh parse,
+    // by every compile that imports it, and its custom tags still apply
+    session.setSource("memory/tags.sap", "module tags;\nattribute note { string text; }\n[note(\"kept\")]\nuse tagged : struct;\nstruct bad { nothing x; }\n");
+    session.setSource("memory/user.sap", "module user;\nimport tags;\ntagged thing { string name = \"value\"; }\n");
+    for (int pass = 0; pass != 2; ++pass) {
+        auto const tagged = session.compile("memory/user.sap");
+        if (tagged.module == nullptr || tagged.errors != 1 || tagged.diagnostics.front().find("nothing: type not found") == std::string::npos)
+            return fail("broken import was not reported again", tagged);
+
+        auto const* const thing = static_cast<schema::TypeAggregate const*>(findType(*tagged.module, "thing"));
+        if (thing == nullptr || thing->annotations.empty() || thing->annotations.front()->args.size() != 1 || thing->fields.size() != 1)
+            return fail("custom tag of a broken import was not applied", tagged);
+        auto const* const text = std::get_if<std::string>(&thing->annotations.front()->args.front().data);
+        auto const* const name = std::get_if<std::string>(&thing->fields.front()->defaultValue->data);
+        if (text == nullptr || *text != "kept" || name == nullptr || *name != "value")
+            return fail("custom tag or default lost its value", tagged);
+    }
+
+    // diagnostics past the error limit are dropped
+    session.setSource("memory/unknown.sap", "module unknown;\nstruct a { b x; c y; d z; }\n");
+    session.maxErrors = 2;
+    auto const limited = session.compile("memory/unknown.sap");
+    if (limited || limited.diagnostics.size() != 2)
+        return fail("error limit was not applied", limited);
+    session.maxErrors = 0;
+
+    // instantiated specializations get the generic's fields, with the type arguments substituted
+    session.instantiate = true;
+    session.setSource("memory/generic.sap", "module generic;\nstruct pair<K, V> { K key; V[] values; }\nstruct holder<T> { pair<T, int> inner; }\nstruct user { holder<string> held; }\n");
+    auto const generic = session.compile("memory/generic.sap");
+    if (!generic)
+        return fail("generic compile failed", generic);
+    auto const* const inner = static_cast<schema::TypeIndirect const*>(findType(*generic.module, "pair<string, int>"));
+    if (inner == nullptr || inner->fields.size() != 2 || inner->fields[0]->type->qualifiedName != "string" || inner->fields[1]->type->qualifiedName != "int[]")
+        return fail("specialization was not instantiated", generic);
+    auto const* const dependent = static_cast<schema::TypeIndirect const*>(findType(*generic.module, "pair<holder.T, int>"));
+    if (dependent == nullptr || !dependent->fields.empty())
+        return fail("specialization of a type parameter was instantiated", generic);
+
+    // chains of specializations too deep to instantiate are reported
+    std::string chain = "module chain;\nstruct g0<T> { T value; }\n";
+    for (int depth = 1; depth != 70; ++depth)
+        chain += "struct g" + std::to_string(depth) + "<T> { g" + std::to_string(depth - 1) + "<T[]> next; }\n";
+    chain += "struct user { g69<int> deep; }\n";
+    session.setSource("memory/chain.sap", chain);
+    auto const deep = session.compile("memory/chain.sap");
+    if (deep || deep.errors != 1 || deep.diagnostics.front().find("levels deep") == std::string::npos)
+        return fail("deep instantiation was not reported", deep);
+    session.instantiate = false;
+
+    // the names a session interned are released with its context
+    if (session.context->symbols.entries.empty())
+        return fail("compiles interned no names");
+    session.reset();
+    if (!session.context->symbols.entries.empty())
+        return fail("interned names survived a reset");
+    if (session.compile("memory/drawing.sap"))
+        return fail("sources survived a reset");
+
+    // files on disk are found through the import index, which sees files added later
+    auto const dir = fs::temp_directory_path() / "sapc_test_library";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::ofstream(dir / "main.sap") << "module main;\nimport later;\nstruct user { added value; }\n";
+
+    session.resolver = nullptr;
+    if (session.compile(dir / "main.sap"))
+        return fail("import of a file that doesn't exist yet succeeded");
+
+    std::ofstream(dir / "later.sap") << "module later;\nstruct added { int x; }\n";
+    auto const added = session.compile(dir / "main.sap");
+    if (!added || added.dependencies.size() != 2)
+        return fail("file added to an indexed directory was not found", added);
+    fs::remove_all(dir);
+
+    return 0;
+}
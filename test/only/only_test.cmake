@@ -0,0 +1,96 @@
+# Compiles a schema with --only filters and checks that exactly the selected
+# types and constants, and the types they use, are written
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+function(compile_schema OUTPUT)
+    execute_process(
+        COMMAND ${SAPC} -I ${SOURCE_DIR} ${ARGN} -o ${WORK_DIR}/${OUTPUT} ${SOURCE_DIR}/only_test.sap
+        RESULT_VARIABLE RESULT
+        ERROR_VARIABLE ERRORS
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "sapc ${ARGN} failed with ${RESULT}: ${ERRORS}")
+    endif()
+    file(READ ${WORK_DIR}/${OUTPUT} CONTENTS)
+    set(JSON ${CONTENTS} PARENT_SCOPE)
+    set(ERRORS ${ERRORS} PARENT_SCOPE)
+endfunction()
+
+# the qualified names of the records of one of the top-level arrays
+function(list_names JSON ARRAY OUT)
+    set(NAMES)
+    string(JSON COUNT LENGTH "${JSON}" ${ARRAY})
+    if(COUNT GREATER 0)
+        math(EXPR LAST "${COUNT} - 1")
+        foreach(INDEX RANGE ${LAST})
+            string(JSON NAME GET "${JSON}" ${ARRAY} ${INDEX} qualified)
+            list(APPEND NAMES ${NAME})
+        endforeach()
+    endif()
+    set(${OUT} ${NAMES} PARENT_SCOPE)
+endfunction()
+
+function(expect_names JSON ARRAY)
+    list_names("${JSON}" ${ARRAY} NAMES)
+    foreach(NAME ${ARGN})
+        list(FIND NAMES "${NAME}" FOUND)
+        if(FOUND EQUAL -1)
+            message(FATAL_ERROR "${ARRAY} lack '${NAME}': ${NAMES}")
+        endif()
+    endforeach()
+endfunction()
+
+function(reject_names JSON ARRAY)
+    list_names("${JSON}" ${ARRAY} NAMES)
+    foreach(NAME ${ARGN})
+        list(FIND NAMES "${NAME}" FOUND)
+        if(NOT FOUND EQUAL -1)
+            message(FATAL_ERROR "${ARRAY} include '${NAME}': ${NAMES}")
+        endif()
+    endforeach()
+endfunction()
+
+compile_schema(full.json)
+set(FULL ${JSON})
+
+# fields, bases, type arguments and parameters, and annotations are followed
+compile_schema(move.json --only net.Move)
+expect_names("${JSON}" types net.Move Header Vec Vec[] "Pair<int, Vec>" Pair Pair.A tag Color)
+reject_names("${JSON}" types net.Chat Other Unused)
+reject_names("${JSON}" constants limit net.greeting)
+string(JSON NAMESPACE_TYPES GET "${JSON}" namespaces 0 types)
+if(NOT NAMESPACE_TYPES MATCHES "net.Move" OR NAMESPACE_TYPES MATCHES "net.Chat")
+    message(FATAL_ERROR "namespace lists unselected members: ${NAMESPACE_TYPES}")
+endif()
+
+# patterns select every match, and constants bring their types
+compile_schema(net.json --only "net.*" --only limit)
+expect_names("${JSON}" types net.Move net.Chat)
+expect_names("${JSON}" constants net.greeting limit)
+reject_names("${JSON}" types Other Unused)
+
+# an unmatched pattern is a diagnostic at the module, so it is also in SARIF
+compile_schema(none.json --only missing --sarif ${WORK_DIR}/none.sarif)
+if(NOT ERRORS MATCHES "only_test.sap\\([0-9,]+\\): warning C4107: no type or constant matches `missing'")
+    message(FATAL_ERROR "unmatched pattern was not reported: ${ERRORS}")
+endif()
+file(READ ${WORK_DIR}/none.sarif SARIF)
+if(NOT SARIF MATCHES "\"ruleId\": \"C4107\", \"level\": \"warning\"" OR NOT SARIF MATCHES "no type or constant matches `missing'" OR NOT SARIF MATCHES "only_test.sap")
+    message(FATAL_ERROR "unmatched pattern was not written to SARIF:\n${SARIF}")
+endif()
+
+compile_schema(all.json --only "*")
+if(NOT JSON STREQUAL FULL)
+    message(FATAL_ERROR "selecting every type changed the output")
+endif()
+
+execute_process(
+    COMMAND ${SAPC} -I ${SOURCE_DIR} --only net.Move --format header -o ${WORK_DIR}/only.h ${SOURCE_DIR}/only_test.sap
+    RESULT_VARIABLE RESULT
+    ERROR_QUIET
+)
+if(RESULT EQUAL 0)
+    message(FATAL_ERROR "--only was accepted for header output")
+endif()
@@ -0,0 +1,67 @@
+#include "reflect_test_reflect.h"
+
+#include <cstring>
+
+using sapc_reflect::reflect;
+
+constexpr bool equal(char const* lhs, char const* rhs) {
+    while (*lhs != '\0' && *lhs == *rhs)
+        ++lhs, ++rhs;
+    return *lhs == *rhs;
+}
+
+constexpr auto const& shape = reflect<st::shape>::type;
+static_assert(equal(shape.name, "shape"));
+static_assert(shape.kind == sapc_reflect::Kind::Struct);
+static_assert(shape.size == sizeof(st::shape));
+static_assert(equal(shape.base, "base"));
+
+// ignored fields are left out, and fields are listed in declaration order
+static_assert(shape.fields.size() == 4);
+static_assert(equal(shape.fields[0].name, "name"));
+static_assert(equal(shape.fields[3].name, "scale"));
+static_assert(shape.fields[3].size == sizeof(float));
+
+static_assert(shape.fields[1].defaultValue.kind == sapc_reflect::ValueKind::Enum);
+static_assert(shape.fields[1].defaultValue.number == 2);
+static_assert(shape.fields[1].annotations.size() == 1);
+static_assert(equal(shape.fields[1].annotations[0].args[0].value.text, "fill"));
+static_assert(shape.fields[1].annotations[0].args[1].value.number == 1);
+
+static_assert(shape.fields[2].size == sizeof(int) * 3);
+static_assert(shape.fields[2].defaultValue.kind == sapc_reflect::ValueKind::Array);
+static_assert(shape.fields[2].defaultValue.number == 3);
+
+constexpr auto const& base = reflect<st::base>::type;
+static_assert(base.annotations.size() == 1);
+static_assert(equal(base.annotations[0].type, "tag"));
+static_assert(equal(base.annotations[0].args[0].name, "tag"));
+static_assert(base.annotations[0].args[1].value.kind == sapc_reflect::ValueKind::Integer);
+static_assert(base.annotations[0].args[1].value.number == 2);
+static_assert(base.fields[0].defaultValue.number == 7);
+
+constexpr auto const& color = reflect<st::color>::type;
+static_assert(color.kind == sapc_reflect::Kind::Enum);
+static_assert(color.items.size() == 3);
+static_assert(equal(color.items[1].name, "green") && color.items[1].value == 2);
+
+// generic types are listed in the module without a layout
+constexpr auto const& module = sapc_reflect::module_reflect_test::module_info;
+static_assert(equal(module.name, "reflect_test"));
+
+int main() {
+    st::shape value;
+    value.renamed = 2.f;
+
+    // offsets locate the members of live objects, whatever their C++ name
+    auto const& scale = shape.fields[3];
+    float read = 0;
+    std::memcpy(&read, reinterpret_cast<char const*>(&value) + scale.offset, sizeof(read));
+    if (read != 2.f)
+        return 1;
+
+    for (auto const& type : module.types)
+        if (equal(type.name, "pair"))
+            return type.size == 0 && type.fields.size() == 2 ? 0 : 1;
+    return 1;
+}
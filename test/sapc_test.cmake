@@ -1,12 +1,10 @@
-find_package (Python COMPONENTS Interpreter)
-
 if(${SAPC_VALIDATE_SCHEMA_TESTS})
     find_program(SAPC_PATH_AJV_BIN ajv HINTS ${CMAKE_SOURCE_DIR}/node_modules/.bin REQUIRED DOC "Path to ajv from npm package ajv-cli")
     message(STATUS "Found ajv at ${SAPC_PATH_AJV_BIN}")
 endif()
 
 function(sapc_test NAME)
-    cmake_parse_arguments(PARSE_ARGV 0 ARG "" "TARGET" "SOURCES;SCHEMAS;INCLUDE" )
+    cmake_parse_arguments(PARSE_ARGV 0 ARG "BATCH;REFLECT;SERIALIZE" "TARGET" "SOURCES;SCHEMAS;INCLUDE" )
 
     add_executable(${ARG_TARGET})
 
@@ -17,43 +15,100 @@ function(sapc_test NAME)
     target_compile_features(${ARG_TARGET} PRIVATE cxx_std_17)
     target_include_directories(${ARG_TARGET} PRIVATE ${CMAKE_CURRENT_BINARY_DIR})
 
+    set(INCLUDE_OPTS "")
+    foreach(INCLUDE ${ARG_INCLUDE})
+        get_filename_component(INCLUDE_LOCAL "${INCLUDE}" REALPATH BASE_DIR ${CMAKE_CURRENT_SOURCE_DIR})
+        list(APPEND INCLUDE_OPTS "-I${INCLUDE_LOCAL}")
+    endforeach()
+
+    # BATCH compiles every schema with a single sapc invocation via a response file
+    if(ARG_BATCH)
+        set(RESPONSE_FILE ${CMAKE_CURRENT_BINARY_DIR}/${ARG_TARGET}.rsp)
+        set(RESPONSE_ARGS "--format=header" ${INCLUDE_OPTS})
+        set(BATCH_OUTPUTS "")
+        set(BATCH_INPUTS "")
+        foreach(SCHEMA ${ARG_SCHEMAS})
+            get_filename_component(BASENAME ${SCHEMA} NAME_WE)
+            set(HEAD_FILE ${CMAKE_CURRENT_BINARY_DIR}/${BASENAME}.h)
+            list(APPEND RESPONSE_ARGS "-o" "${HEAD_FILE}")
+            list(APPEND BATCH_OUTPUTS ${HEAD_FILE})
+            list(APPEND BATCH_INPUTS ${CMAKE_CURRENT_SOURCE_DIR}/${SCHEMA})
+        endforeach()
+        list(APPEND RESPONSE_ARGS "--" ${BATCH_INPUTS})
+        list(JOIN RESPONSE_ARGS "\n" RESPONSE_TEXT)
+        file(WRITE ${RESPONSE_FILE} "${RESPONSE_TEXT}\n")
+
+        add_custom_command(OUTPUT ${BATCH_OUTPUTS}
+            COMMAND sapc @${RESPONSE_FILE}
+            COMMENT "Compiling schemas ${ARG_SCHEMAS}"
+            WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+            DEPENDS sapc ${BATCH_INPUTS} ${RESPONSE_FILE}
+        )
+    endif()
+
     foreach(SCHEMA ${ARG_SCHEMAS})
         get_filename_component(BASENAME ${SCHEMA} NAME_WE)
 
-        set(GEN_SCRIPT ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/gen_header.py)
         set(JSON_FILE ${CMAKE_CURRENT_BINARY_DIR}/${SCHEMA}.json)
         set(DEPS_FILE ${CMAKE_CURRENT_BINARY_DIR}/${SCHEMA}.d)
         set(HEAD_FILE ${CMAKE_CURRENT_BINARY_DIR}/${BASENAME}.h)
 
-        set(INCLUDE_OPTS "")
-        foreach(INCLUDE ${ARG_INCLUDE})
-            get_filename_component(INCLUDE_LOCAL "${INCLUDE}" REALPATH BASE_DIR ${CMAKE_CURRENT_SOURCE_DIR})
-            list(APPEND INCLUDE_OPTS "-I${INCLUDE_LOCAL}")
-        endforeach()
+        # Makefile generators won't create output directories for us
+        get_filename_component(JSON_DIR ${JSON_FILE} DIRECTORY)
+        file(MAKE_DIRECTORY ${JSON_DIR})
 
-        add_custom_command(OUTPUT ${JSON_FILE}
-            COMMAND sapc -o ${JSON_FILE} -d ${DEPS_FILE} ${INCLUDE_OPTS} -- ${CMAKE_CURRENT_SOURCE_DIR}/${SCHEMA}
-            COMMENT "Compiling schema ${SCHEMA}"
-            WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
-            MAIN_DEPENDENCY ${SCHEMA}
-            DEPENDS sapc
-            DEPFILE ${DEPS_FILE}
-        )
+        # headers are generated by sapc directly from the compiled module
+        if(NOT ARG_BATCH)
+            add_custom_command(OUTPUT ${HEAD_FILE}
+                COMMAND sapc --format=header -o ${HEAD_FILE} -d ${DEPS_FILE} ${INCLUDE_OPTS} -- ${CMAKE_CURRENT_SOURCE_DIR}/${SCHEMA}
+                COMMENT "Generating header ${SCHEMA}"
+                WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+                MAIN_DEPENDENCY ${SCHEMA}
+                DEPENDS sapc
+                DEPFILE ${DEPS_FILE}
+            )
+        endif()
+        target_sources(${ARG_TARGET} PRIVATE ${HEAD_FILE})
+
+        # REFLECT and SERIALIZE also generate companion headers for each schema
+        set(COMPANIONS "")
+        if(ARG_REFLECT)
+            list(APPEND COMPANIONS "reflection:reflect")
+        endif()
+        if(ARG_SERIALIZE)
+            list(APPEND COMPANIONS "serializer:serialize")
+        endif()
+        foreach(COMPANION ${COMPANIONS})
+            string(REPLACE ":" ";" COMPANION ${COMPANION})
+            list(GET COMPANION 0 FORMAT)
+            list(GET COMPANION 1 SUFFIX)
+            set(COMPANION_FILE ${CMAKE_CURRENT_BINARY_DIR}/${BASENAME}_${SUFFIX}.h)
+            set(COMPANION_DEPS_FILE ${CMAKE_CURRENT_BINARY_DIR}/${SCHEMA}.${SUFFIX}.d)
+
+            add_custom_command(OUTPUT ${COMPANION_FILE}
+                COMMAND sapc --format=${FORMAT} -o ${COMPANION_FILE} -d ${COMPANION_DEPS_FILE} ${INCLUDE_OPTS} -- ${CMAKE_CURRENT_SOURCE_DIR}/${SCHEMA}
+                COMMENT "Generating ${FORMAT} ${SCHEMA}"
+                WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+                MAIN_DEPENDENCY ${SCHEMA}
+                DEPENDS sapc
+                DEPFILE ${COMPANION_DEPS_FILE}
+            )
+            target_sources(${ARG_TARGET} PRIVATE ${COMPANION_FILE})
+        endforeach()
 
+        # the JSON output is only needed to validate it against the schema
         if(${SAPC_VALIDATE_SCHEMA_TESTS})
+            set(JSON_DEPS_FILE ${CMAKE_CURRENT_BINARY_DIR}/${SCHEMA}.json.d)
+
             add_custom_command(OUTPUT ${JSON_FILE}
+                COMMAND sapc -o ${JSON_FILE} -d ${JSON_DEPS_FILE} ${INCLUDE_OPTS} -- ${CMAKE_CURRENT_SOURCE_DIR}/${SCHEMA}
                 COMMAND ${SAPC_PATH_AJV_BIN} validate --errors=text -s "${SAPC_JSON_SCHEMA_PATH}" -d "${JSON_FILE}"
-                APPEND
+                COMMENT "Validating schema ${SCHEMA}"
+                WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+                DEPENDS sapc ${CMAKE_CURRENT_SOURCE_DIR}/${SCHEMA} ${SAPC_JSON_SCHEMA_PATH}
+                DEPFILE ${JSON_DEPS_FILE}
             )
+            target_sources(${ARG_TARGET} PRIVATE ${JSON_FILE})
         endif()
-
-        add_custom_command(OUTPUT ${HEAD_FILE}
-            COMMAND Python::Interpreter ${GEN_SCRIPT} -i ${JSON_FILE} -o ${HEAD_FILE}
-            COMMENT "Generating header ${SCHEMA}"
-            WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
-            MAIN_DEPENDENCY ${JSON_FILE}
-            DEPENDS ${GEN_SCRIPT}
-        )
-        target_sources(${ARG_TARGET} PRIVATE ${BASENAME}.h)
     endforeach()
 endfunction()
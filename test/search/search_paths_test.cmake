@@ -0,0 +1,70 @@
+# Checks that imports resolve next to a relative input, that shadowed,
+# repeated, and missing search paths are reported, and that missing modules
+# and import cycles are each reported once
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR}/first ${WORK_DIR}/second)
+
+file(WRITE ${WORK_DIR}/main.sap "module main;\nimport local;\nimport shared;\nstruct user { local_type a; shared_type b; }\n")
+file(WRITE ${WORK_DIR}/local.sap "module local;\nstruct local_type { int x; }\n")
+file(WRITE ${WORK_DIR}/first/shared.sap "module shared;\nstruct shared_type { int y; }\n")
+file(WRITE ${WORK_DIR}/second/shared.sap "module shared;\nstruct shared_type { string z; }\n")
+
+function(run_sapc OUT_RESULT OUT_ERRORS)
+    execute_process(
+        COMMAND ${SAPC} -o out.json ${ARGN}
+        WORKING_DIRECTORY ${WORK_DIR}
+        RESULT_VARIABLE RESULT
+        ERROR_VARIABLE ERRORS
+    )
+    set(${OUT_RESULT} ${RESULT} PARENT_SCOPE)
+    set(${OUT_ERRORS} "${ERRORS}" PARENT_SCOPE)
+endfunction()
+
+function(expect_lines ERRORS)
+    foreach(EXPECTED ${ARGN})
+        string(FIND "${ERRORS}" "${EXPECTED}" FOUND)
+        if(FOUND EQUAL -1)
+            message(FATAL_ERROR "diagnostics are missing '${EXPECTED}':\n${ERRORS}")
+        endif()
+    endforeach()
+endfunction()
+
+# an input without a directory still finds its neighbours
+run_sapc(RESULT ERRORS -I first main.sap)
+if(NOT RESULT EQUAL 0 OR NOT ERRORS STREQUAL "")
+    message(FATAL_ERROR "expected a clean compile, got ${RESULT}:\n${ERRORS}")
+endif()
+file(READ ${WORK_DIR}/out.json OUTPUT)
+string(FIND "${OUTPUT}" "\"y\"" FOUND)
+if(FOUND EQUAL -1)
+    message(FATAL_ERROR "shared should resolve to the first search path:\n${OUTPUT}")
+endif()
+
+run_sapc(RESULT ERRORS -I first -I second -I first/ -I missing main.sap)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "warnings should not fail the compile, got ${RESULT}:\n${ERRORS}")
+endif()
+expect_lines("${ERRORS}"
+    "module `shared' resolves to `first/shared.sap', hiding `second/shared.sap'"
+    "search path `first/' is listed more than once"
+    "search path `missing' is not a directory"
+)
+
+file(WRITE ${WORK_DIR}/broken.sap "module broken;\nimport absent;\nimport cycle_a;\n")
+file(WRITE ${WORK_DIR}/cycle_a.sap "module cycle_a;\nimport cycle_b;\n")
+file(WRITE ${WORK_DIR}/cycle_b.sap "module cycle_b;\nimport cycle_a;\n")
+
+run_sapc(RESULT ERRORS broken.sap)
+if(NOT RESULT EQUAL 2)
+    message(FATAL_ERROR "expected the compile to fail with 2, got ${RESULT}:\n${ERRORS}")
+endif()
+string(REGEX MATCHALL "error C2[0-9][0-9][0-9]" FOUND "${ERRORS}")
+list(LENGTH FOUND COUNT)
+if(NOT COUNT EQUAL 2)
+    message(FATAL_ERROR "expected 2 errors, got ${COUNT}:\n${ERRORS}")
+endif()
+expect_lines("${ERRORS}"
+    "broken.sap(2,8,2,14): error C2300: absent: module not found"
+    "cycle_b.sap(2,8,2,15): error C2301: module `cycle_a' is imported in a cycle: cycle_a -> cycle_b -> cycle_a"
+)
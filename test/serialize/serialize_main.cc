@@ -0,0 +1,105 @@
+#include "serialize_test_serialize.h"
+
+// generated types can't refer to themselves, but types serialized alongside
+// them may, so the depth of pointers in the input is unbounded
+struct chain {
+    std::unique_ptr<chain> next;
+};
+
+namespace sapc_serialize {
+    template <>
+    struct Serializer<chain> {
+        static void write(Writer& out, chain const& value) { sapc_serialize::write(out, value.next); }
+        static bool read(Reader& in, chain& value) { return sapc_serialize::read(in, value.next); }
+        static std::size_t min_size() { return 1; }
+    };
+}
+
+static st::node make_node(char const* name) {
+    st::node node;
+    node.name = name;
+    node.weights = { 1, -2, 3 };
+    node.points.push_back({ 1.5f, 2.5f });
+    node.anchor = std::make_unique<st::vec>(st::vec{ 3.f, 4.f });
+    node.state = st::mode::on;
+    node.range = { 10, 20 };
+    node.cached = 99;
+    return node;
+}
+
+static bool same(st::node const& lhs, st::node const& rhs) {
+    return lhs.name == rhs.name && lhs.weights == rhs.weights && lhs.points.size() == rhs.points.size() &&
+        lhs.points[0].x == rhs.points[0].x && lhs.points[0].y == rhs.points[0].y &&
+        (lhs.anchor != nullptr) == (rhs.anchor != nullptr) && (lhs.anchor == nullptr || lhs.anchor->y == rhs.anchor->y) &&
+        lhs.state == rhs.state && lhs.range.first == rhs.range.first && lhs.range.second == rhs.range.second;
+}
+
+int main() {
+    st::tree tree;
+    static_cast<st::node&>(tree) = make_node("root");
+    tree.children.push_back(std::make_unique<st::node>(make_node("child")));
+    tree.children.push_back(nullptr);
+    tree.visible = true;
+
+    std::vector<unsigned char> buffer;
+    sapc_serialize::Writer writer{ buffer };
+    sapc_serialize::write(writer, tree);
+
+    st::tree copy;
+    sapc_serialize::Reader reader{ buffer.data(), buffer.data() + buffer.size() };
+    if (!sapc_serialize::read(reader, copy) || reader.cursor != reader.end)
+        return 1;
+
+    if (!same(tree, copy) || !copy.visible || copy.children.size() != 2 || copy.children[1] != nullptr || !same(*tree.children[0], *copy.children[0]))
+        return 2;
+
+    // transient fields keep their defaults
+    if (copy.cached != 5)
+        return 3;
+
+    // truncated input must fail without reading out of bounds
+    for (size_t length = 0; length != buffer.size(); ++length) {
+        st::tree partial;
+        sapc_serialize::Reader truncated{ buffer.data(), buffer.data() + length };
+        if (sapc_serialize::read(truncated, partial))
+            return 4;
+    }
+
+    // pointers nested past the reader's limit fail rather than overflowing the stack
+    std::vector<unsigned char> const present(100000, 1);
+    chain chain;
+    sapc_serialize::Reader deep{ present.data(), present.data() + present.size() };
+    if (sapc_serialize::read(deep, chain) || deep.depth != 0)
+        return 5;
+
+    // nesting within the limit still reads
+    std::vector<unsigned char> shallow(200, 1);
+    shallow.push_back(0);
+    sapc_serialize::Reader within{ shallow.data(), shallow.data() + shallow.size() };
+    if (!sapc_serialize::read(within, chain) || within.cursor != within.end)
+        return 6;
+
+    // elements encoded in no bytes can't be bounded by the input, so their count is limited
+    st::markers markers;
+    markers.items.resize(1000);
+    buffer.clear();
+    sapc_serialize::write(writer, markers);
+    sapc_serialize::Reader empty{ buffer.data(), buffer.data() + buffer.size() };
+    if (!sapc_serialize::read(empty, markers) || markers.items.size() != 1000)
+        return 7;
+
+    unsigned char const huge[] = { 0xFF, 0xFF, 0xFF, 0xFF };
+    sapc_serialize::Reader unbounded{ huge, huge + sizeof(huge) };
+    if (sapc_serialize::read(unbounded, markers) || !markers.items.empty())
+        return 8;
+
+    // enums are written at the size of their declared base
+    buffer.clear();
+    sapc_serialize::write(writer, st::level::high);
+    st::level level = st::level::low;
+    sapc_serialize::Reader byte{ buffer.data(), buffer.data() + buffer.size() };
+    if (buffer.size() != 1 || sapc_serialize::Serializer<st::level>::min_size() != 1 || !sapc_serialize::read(byte, level) || level != st::level::high || byte.cursor != byte.end)
+        return 9;
+
+    return 0;
+}
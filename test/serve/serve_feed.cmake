@@ -0,0 +1,36 @@
+# Writes the requests of serve_test.cmake to stdout, rewriting the base
+# module and moving its modification time forward once the server has
+# answered the requests that read it
+
+function(send REQUEST)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E echo "${REQUEST}")
+endfunction()
+
+send("-o \"${WORK_DIR}/first.json\" \"${TEST_SAP}\"")
+send("")
+send("-o \"${WORK_DIR}/base.json\" -o \"${WORK_DIR}/second.json\" \"${BASE_SAP}\" \"${TEST_SAP}\"")
+send("-I unsupported \"${TEST_SAP}\"")
+
+set(WAITED 0)
+while(NOT EXISTS ${WORK_DIR}/second.json)
+    if(WAITED EQUAL 600)
+        message(FATAL_ERROR "the server did not answer")
+    endif()
+    execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 0.1)
+    math(EXPR WAITED "${WAITED} + 1")
+endwhile()
+
+# the server only notices the edit if the modification time changes, which
+# a rewrite within the same tick of a coarse filesystem clock would not do;
+# the time is pushed forward until it differs, at the resolution of seconds
+file(TIMESTAMP ${BASE_SAP} COMPILED_TIME "%s")
+file(WRITE ${BASE_SAP} "module serve_base;\n\nstruct Base {\n    int id;\n    int version;\n}\n")
+file(TIMESTAMP ${BASE_SAP} EDITED_TIME "%s")
+while(EDITED_TIME STREQUAL COMPILED_TIME)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 0.1)
+    file(TOUCH ${BASE_SAP})
+    file(TIMESTAMP ${BASE_SAP} EDITED_TIME "%s")
+endwhile()
+
+send("-o \"${WORK_DIR}/edited.json\" \"${TEST_SAP}\"")
+send("quit")
@@ -0,0 +1,69 @@
+# Sends several requests to one server and verifies that each produces the
+# same output as a standalone compile, and that editing an import recompiles
+# only the modules that depend on it
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR}/src)
+
+# the server edits its copy of the base module
+foreach(NAME serve_test serve_base serve_other)
+    configure_file(${SOURCE_DIR}/${NAME}.sap ${WORK_DIR}/src/${NAME}.sap COPYONLY)
+endforeach()
+set(TEST_SAP ${WORK_DIR}/src/serve_test.sap)
+set(BASE_SAP ${WORK_DIR}/src/serve_base.sap)
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -DWORK_DIR=${WORK_DIR} -DTEST_SAP=${TEST_SAP} -DBASE_SAP=${BASE_SAP} -P ${SOURCE_DIR}/serve_feed.cmake
+    COMMAND ${SAPC} --serve --trace ${WORK_DIR}/trace.json
+    OUTPUT_VARIABLE RESPONSES
+    RESULTS_VARIABLE RESULTS
+)
+if(NOT RESULTS STREQUAL "0;0")
+    message(FATAL_ERROR "sapc --serve failed with ${RESULTS}")
+endif()
+if(NOT RESPONSES STREQUAL "done 0\ndone 0\ndone 1\ndone 0\n")
+    message(FATAL_ERROR "unexpected responses:\n${RESPONSES}")
+endif()
+
+# the edited module is compiled again along with its importer, but the
+# module that doesn't depend on it is reused
+file(READ ${WORK_DIR}/trace.json TRACE)
+foreach(EXPECTED serve_other:1 serve_base:2 serve_test:2)
+    string(REPLACE ":" ";" EXPECTED ${EXPECTED})
+    list(GET EXPECTED 0 NAME)
+    list(GET EXPECTED 1 COUNT)
+    string(REGEX MATCHALL "\"compile ${NAME}\"" COMPILES "${TRACE}")
+    list(LENGTH COMPILES ACTUAL)
+    if(NOT ACTUAL EQUAL COUNT)
+        message(FATAL_ERROR "${NAME} was compiled ${ACTUAL} times rather than ${COUNT}")
+    endif()
+endforeach()
+
+execute_process(
+    COMMAND ${SAPC} -o ${WORK_DIR}/expected.json ${TEST_SAP}
+    RESULT_VARIABLE RESULT
+)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "sapc failed with ${RESULT}")
+endif()
+
+file(READ ${WORK_DIR}/expected.json EXPECTED)
+file(READ ${WORK_DIR}/edited.json ACTUAL)
+if(NOT ACTUAL STREQUAL EXPECTED)
+    message(FATAL_ERROR "edited.json differs from a standalone compile")
+endif()
+if(NOT ACTUAL MATCHES "\"version\"")
+    message(FATAL_ERROR "edited.json lacks the field added by the edit")
+endif()
+
+# the outputs from before the edit lack the new field
+file(READ ${WORK_DIR}/first.json EXPECTED)
+foreach(OUTPUT first second)
+    file(READ ${WORK_DIR}/${OUTPUT}.json ACTUAL)
+    if(ACTUAL MATCHES "\"version\"")
+        message(FATAL_ERROR "${OUTPUT}.json has the field added by the edit")
+    endif()
+    if(NOT ACTUAL STREQUAL EXPECTED)
+        message(FATAL_ERROR "${OUTPUT}.json differs from the first compile")
+    endif()
+endforeach()
@@ -0,0 +1,40 @@
+# Checks that --stats reports every phase and module, and that --trace
+# writes a Chrome trace_event document with an event for each phase
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+execute_process(
+    COMMAND ${SAPC} --stats --trace=${WORK_DIR}/trace.json -o ${WORK_DIR}/stats_test.json ${SOURCE_DIR}/stats_test.sap
+    RESULT_VARIABLE RESULT
+    ERROR_VARIABLE STATS
+)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "sapc failed with ${RESULT}:\n${STATS}")
+endif()
+
+foreach(EXPECTED "sapc stats" "grammar" "compile" "validate" "serialize" "stats_import" "resolve cache:" "modules: 2, types: 2, fields: 4")
+    string(FIND "${STATS}" "${EXPECTED}" FOUND)
+    if(FOUND EQUAL -1)
+        message(FATAL_ERROR "--stats output is missing '${EXPECTED}':\n${STATS}")
+    endif()
+endforeach()
+
+file(READ ${WORK_DIR}/trace.json TRACE)
+string(JSON NUM_EVENTS LENGTH "${TRACE}" traceEvents)
+math(EXPR LAST_EVENT "${NUM_EVENTS} - 1")
+set(PHASES)
+foreach(INDEX RANGE ${LAST_EVENT})
+    string(JSON PH GET "${TRACE}" traceEvents ${INDEX} ph)
+    if(PH STREQUAL "X")
+        string(JSON CATEGORY GET "${TRACE}" traceEvents ${INDEX} cat)
+        list(APPEND PHASES ${CATEGORY})
+    endif()
+endforeach()
+
+foreach(EXPECTED load tokenize grammar compile validate serialize write)
+    list(FIND PHASES ${EXPECTED} FOUND)
+    if(FOUND EQUAL -1)
+        message(FATAL_ERROR "trace has no '${EXPECTED}' event; found: ${PHASES}")
+    endif()
+endforeach()
@@ -0,0 +1,268 @@
+#include <sapc/sapc.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace sapc;
+
+// every allocation is counted, so that memory growth can be measured
+// without depending on the allocator or the resident set of the process
+static std::atomic<std::uint64_t> allocatedBytes{ 0 };
+
+void* operator new(std::size_t size) {
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* const ptr = std::malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+    using Sources = std::vector<std::pair<std::string, std::string>>; // module names and sources; the target is last
+
+    // A generated input whose size grows with n; scaling is measured from n
+    // to 4n, where linear growth is a ratio of 4 and quadratic growth is 16
+    struct Shape {
+        char const* name;
+        int base; // the smallest n for the default run, which doubles until it is slow enough to time
+        int full; // n for --full, where 4n is the size the fixture is named for
+        std::function<Sources(int n)> generate;
+    };
+
+    struct Sample {
+        double seconds = 0; // the median of the runs
+        std::uint64_t bytes = 0;
+        size_t types = 0;
+    };
+
+    // timings shorter than the minimum are mostly scheduling noise; sizes
+    // grow to the target, which leaves room for the median to come in lower
+    constexpr double minSeconds = 0.05;
+    constexpr double targetSeconds = 0.1;
+    constexpr int repeats = 5;
+
+    std::string typeName(int module, int index) {
+        return "m" + std::to_string(module) + "_t" + std::to_string(index);
+    }
+
+    // n structs in one namespace, each using the one before it and one
+    // declared much earlier, so lookups cover the whole namespace
+    Sources wideNamespace(int n) {
+        std::string source = "module wide;\nnamespace wide {\n";
+        for (int index = 0; index != n; ++index) {
+            source += "    struct " + typeName(0, index) + " { int id; ";
+            if (index != 0)
+                source += typeName(0, index - 1) + " previous; " + typeName(0, index / 2) + "* earlier; ";
+            source += "}\n";
+        }
+        source += "}\n";
+        return { { "wide", std::move(source) } };
+    }
+
+    // n structs, each deriving from the one before it, down to a generic
+    // whose type parameter every struct names through its bases
+    Sources baseChain(int n) {
+        std::string source = "module bases;\nstruct root<T> { int id; }\n";
+        for (int index = 0; index != n; ++index) {
+            auto const base = index != 0 ? typeName(0, index - 1) : std::string{ "root" };
+            source += "struct " + typeName(0, index) + " : " + base + " { T value" + std::to_string(index) + "; }\n";
+        }
+        return { { "bases", std::move(source) } };
+    }
+
+    // n modules, each importing the one before it, with a chain of types
+    // through every module, all of which the target reaches
+    Sources importChain(int n) {
+        Sources sources;
+        for (int module = 0; module != n; ++module) {
+            std::string source = "module chain" + std::to_string(module) + ";\n";
+            if (module != 0)
+                source += "import chain" + std::to_string(module - 1) + ";\n";
+            source += "struct " + typeName(module, 0) + " { int id; }\nstruct " + typeName(module, 1) + " { " + typeName(module, 0) + "[] items; ";
+            if (module != 0)
+                source += typeName(module - 1, 1) + " below; ";
+            source += "}\n";
+            sources.emplace_back("chain" + std::to_string(module), std::move(source));
+        }
+        return sources;
+    }
+
+    // n layers of two modules, each importing both modules of the layer
+    // below and using types of both, so that every module is reached along
+    // 2^depth paths
+    Sources importDiamonds(int n) {
+        auto const name = [](int layer, int side) { return "diamond" + std::to_string(layer) + (side == 0 ? "a" : "b"); };
+
+        Sources sources;
+        for (int layer = 0; layer != n; ++layer) {
+            for (int side = 0; side != 2; ++side) {
+                auto const module = layer * 2 + side;
+                std::string source = "module " + name(layer, side) + ";\n";
+                if (layer != 0)
+                    source += "import " + name(layer - 1, 0) + ";\nimport " + name(layer - 1, 1) + ";\n";
+                source += "struct " + typeName(module, 0) + " { int id; }\nstruct " + typeName(module, 1) + " { " + typeName(module, 0) + " own; ";
+                if (layer != 0)
+                    source += typeName(module - 2 - side, 1) + " left; " + typeName(module - 1 - side, 1) + " right; ";
+                source += "}\n";
+                sources.emplace_back(name(layer, side), std::move(source));
+            }
+        }
+
+        // the root imports the top of the diamonds
+        sources.emplace_back("diamonds", "module diamonds;\nimport " + name(n - 1, 0) + ";\nimport " + name(n - 1, 1) + ";\nstruct top { " + typeName(n * 2 - 2, 1) + " value; }\n");
+        return sources;
+    }
+
+    // n fields of distinct specializations, each nested up to 24 deep
+    Sources nestedGenerics(int n) {
+        std::string source = "module nested;\nstruct box<T> { T value; T[] values; }\nstruct pair<A, B> { A first; B second; }\n";
+        for (int index = 0; index != n; ++index)
+            source += "struct " + typeName(0, index) + " { int id; }\n";
+
+        source += "struct holder {\n";
+        for (int index = 0; index != n; ++index) {
+            auto const depth = 1 + index % 24;
+            std::string type = typeName(0, index);
+            for (int level = 0; level != depth; ++level)
+                type = level % 3 == 2 ? "pair<int, " + type + ">" : "box<" + type + ">";
+            source += "    " + type + " f" + std::to_string(index) + ";\n";
+        }
+        source += "}\n";
+        return { { "nested", std::move(source) } };
+    }
+
+    // n lines, mostly fields of small structs, with comments and annotations
+    Sources longFile(int n) {
+        std::string source = "module lines;\nattribute note { string text; }\n";
+        int lines = 2;
+        for (int index = 0; lines < n; ++index) {
+            source += "// struct " + std::to_string(index) + "\n[note(\"generated\")]\nstruct " + typeName(0, index) + " {\n";
+            source += "    int a = 1;\n    float b;\n    string c = \"text\";\n    bool d;\n";
+            if (index != 0)
+                source += "    " + typeName(0, index - 1) + " e;\n";
+            source += "}\n";
+            lines += index != 0 ? 9 : 8;
+        }
+        return { { "lines", std::move(source) } };
+    }
+
+    // compiles and writes the JSON of a fresh session, repeatedly, keeping
+    // the median time; the allocations are the same on every run
+    bool measure(Sources const& sources, int runs, Sample& out_sample) {
+        std::vector<double> times;
+        for (int run = 0; run != runs; ++run) {
+            Session session;
+            session.resolver = [](std::string_view name, fs::path const&) { return fs::path{ "memory" } / (std::string{ name } + ".sap"); };
+            for (auto const& [name, source] : sources)
+                session.setSource(fs::path{ "memory" } / (name + ".sap"), source);
+
+            auto const bytesBefore = allocatedBytes.load();
+            auto const began = std::chrono::steady_clock::now();
+
+            auto const result = session.compile(fs::path{ "memory" } / (sources.back().first + ".sap"));
+            if (!result) {
+                for (auto const& line : result.diagnostics)
+                    std::cerr << line << '\n';
+                return false;
+            }
+
+            std::ostringstream json;
+            session.writeJson(json, *result.module, true);
+
+            times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count());
+            out_sample.bytes = allocatedBytes.load() - bytesBefore;
+            out_sample.types = result.module->types.size();
+        }
+
+        std::sort(times.begin(), times.end());
+        out_sample.seconds = times[times.size() / 2];
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool full = false;
+    std::string_view only;
+    for (int arg = 1; arg != argc; ++arg) {
+        std::string_view const value = argv[arg];
+        if (value == "--full")
+            full = true;
+        else if (value == "--shape" && arg + 1 != argc)
+            only = argv[++arg];
+        else {
+            std::cerr << "usage: " << argv[0] << " [--full] [--shape <name>]\n";
+            return 1;
+        }
+    }
+
+    // allocation counts are deterministic, while timings vary with the
+    // load of the machine, so time is allowed more slack
+    constexpr double maxTimeRatio = 7.0;
+    constexpr double maxBytesRatio = 5.5;
+
+    std::vector<Shape> const shapes = {
+        { "wide-namespace", 500, 2500, wideNamespace },
+        { "import-chain", 100, 125, importChain },
+        { "import-diamonds", 50, 63, importDiamonds },
+        { "nested-generics", 800, 2500, nestedGenerics },
+        { "base-chain", 1000, 25000, baseChain },
+        { "long-file", 10000, 250000, longFile },
+    };
+
+    int failures = 0;
+    std::cout << std::fixed;
+    for (auto const& shape : shapes) {
+        if (!only.empty() && only != shape.name)
+            continue;
+
+        // the default size grows until the small compile is long enough to
+        // time, so that the ratio holds on fast machines and optimized builds
+        auto n = full ? shape.full : shape.base;
+        Sample small;
+        Sample large;
+        bool compiled = measure(shape.generate(n), 1, small);
+        while (compiled && !full && small.seconds < targetSeconds && n < shape.full * 64) {
+            n *= 2;
+            compiled = measure(shape.generate(n), 1, small);
+        }
+        compiled = compiled && measure(shape.generate(n), repeats, small) && measure(shape.generate(n * 4), repeats, large);
+        if (!compiled) {
+            std::cerr << "error: " << shape.name << " failed to compile\n";
+            ++failures;
+            continue;
+        }
+
+        // a shape still too fast to time at its largest size is judged by its allocations alone
+        bool const timed = small.seconds >= minSeconds;
+        auto const timeRatio = large.seconds / small.seconds;
+        auto const bytesRatio = static_cast<double>(large.bytes) / static_cast<double>(small.bytes);
+        bool const passed = (!timed || timeRatio <= maxTimeRatio) && bytesRatio <= maxBytesRatio;
+
+        std::cout << std::left << std::setw(16) << shape.name << std::right <<
+            " n=" << std::setw(7) << n << ": " <<
+            std::setprecision(3) << small.seconds << "s -> " << large.seconds << "s (x" << std::setprecision(2) << timeRatio << "), " <<
+            small.bytes / 1024 << " KiB -> " << large.bytes / 1024 << " KiB (x" << bytesRatio << "), " <<
+            large.types << " types" << (timed ? "" : ", too fast to time") << (passed ? "" : "  FAILED") << '\n';
+        if (!passed)
+            ++failures;
+    }
+
+    if (failures != 0) {
+        std::cerr << "error: " << failures << " shapes grew faster than linearly from n to 4n\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+# Checks the diagnostics of the validation pass, and that validating with
+# several threads reports them in the same order as with one
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+function(run_sapc OUT_RESULT OUT_ERRORS)
+    execute_process(
+        COMMAND ${SAPC} -o ${WORK_DIR}/out.json ${ARGN}
+        RESULT_VARIABLE RESULT
+        ERROR_VARIABLE ERRORS
+    )
+    set(${OUT_RESULT} ${RESULT} PARENT_SCOPE)
+    set(${OUT_ERRORS} "${ERRORS}" PARENT_SCOPE)
+endfunction()
+
+function(expect_lines ERRORS)
+    foreach(EXPECTED ${ARGN})
+        string(FIND "${ERRORS}" "${EXPECTED}" FOUND)
+        if(FOUND EQUAL -1)
+            message(FATAL_ERROR "diagnostics are missing '${EXPECTED}':\n${ERRORS}")
+        endif()
+    endforeach()
+endfunction()
+
+run_sapc(RESULT ERRORS ${SOURCE_DIR}/validate_errors.sap)
+if(NOT RESULT EQUAL 4)
+    message(FATAL_ERROR "expected validation to fail with 4, got ${RESULT}:\n${ERRORS}")
+endif()
+expect_lines("${ERRORS}"
+    "value 300 of enumeration item `huge' is out of range for `small'"
+    "base type `string' of enumeration `named' is not an integer type"
+    "argument `text' of type `string' expects a string, got an integer"
+    "field `level' value -1 is out of range for `byte'"
+    "field `count' of type `int' expects an integer, got a string"
+    "field `tint' expects an item of `color', got `shape.square'"
+    "field `pair' has 3 elements, but `int[2]' holds 2"
+    "field `flags' of type `bool' expects a boolean, got an array"
+    "argument `order' of type `int' expects an integer, got a string"
+    "duplicate field `value' in type `inner'"
+    "constant `limit' value 256 is out of range for `byte'"
+)
+
+run_sapc(RESULT ERRORS -I ${SOURCE_DIR} ${SOURCE_DIR}/validate_warnings.sap)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "warnings should not fail the compile, got ${RESULT}:\n${ERRORS}")
+endif()
+expect_lines("${ERRORS}"
+    "enumeration item `also' has the same value as `first' in `flags'"
+    "module `validate_unused' is imported but not used"
+)
+
+# enough types for several batches, each with a duplicate field
+set(SOURCE "module validate_parallel;\n")
+foreach(INDEX RANGE 1 1500)
+    string(APPEND SOURCE "struct type${INDEX} { int value; int value; }\n")
+endforeach()
+file(WRITE ${WORK_DIR}/validate_parallel.sap "${SOURCE}")
+
+run_sapc(SERIAL_RESULT SERIAL -j 1 ${WORK_DIR}/validate_parallel.sap)
+run_sapc(PARALLEL_RESULT PARALLEL -j 4 ${WORK_DIR}/validate_parallel.sap)
+if(NOT SERIAL_RESULT EQUAL 4 OR NOT PARALLEL_RESULT EQUAL 4)
+    message(FATAL_ERROR "expected validation to fail with 4, got ${SERIAL_RESULT} and ${PARALLEL_RESULT}")
+endif()
+if(NOT SERIAL STREQUAL PARALLEL)
+    message(FATAL_ERROR "parallel validation reported different diagnostics:\n${PARALLEL}")
+endif()
+expect_lines("${SERIAL}" "duplicate field `value' in type `type1'" "duplicate field `value' in type `type1500'")
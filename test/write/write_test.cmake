@@ -0,0 +1,65 @@
+# Compiles a schema repeatedly and checks that unchanged outputs and deps
+# files keep their timestamps, unless --always-write is given, and that
+# changed outputs are replaced without leaving temporary files behind
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+file(COPY ${SOURCE_DIR}/write_test.sap DESTINATION ${WORK_DIR})
+
+function(compile_schema)
+    execute_process(
+        COMMAND ${SAPC} ${ARGN} -o ${WORK_DIR}/out.json -d ${WORK_DIR}/out.d ${WORK_DIR}/write_test.sap
+        WORKING_DIRECTORY ${WORK_DIR}
+        RESULT_VARIABLE RESULT
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "sapc ${ARGN} failed with ${RESULT}")
+    endif()
+endfunction()
+
+function(read_stamps PREFIX)
+    file(TIMESTAMP ${WORK_DIR}/out.json OUTPUT_STAMP "%s")
+    file(TIMESTAMP ${WORK_DIR}/out.d DEPS_STAMP "%s")
+    set(${PREFIX}_OUTPUT ${OUTPUT_STAMP} PARENT_SCOPE)
+    set(${PREFIX}_DEPS ${DEPS_STAMP} PARENT_SCOPE)
+endfunction()
+
+# timestamps are compared in whole seconds
+function(wait_a_second)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 1.1)
+endfunction()
+
+compile_schema()
+read_stamps(FIRST)
+file(READ ${WORK_DIR}/out.json FIRST_JSON)
+
+wait_a_second()
+compile_schema()
+read_stamps(SECOND)
+if(NOT FIRST_OUTPUT EQUAL SECOND_OUTPUT OR NOT FIRST_DEPS EQUAL SECOND_DEPS)
+    message(FATAL_ERROR "unchanged output or deps file was rewritten")
+endif()
+
+compile_schema(--always-write)
+read_stamps(ALWAYS)
+if(ALWAYS_OUTPUT EQUAL SECOND_OUTPUT OR ALWAYS_DEPS EQUAL SECOND_DEPS)
+    message(FATAL_ERROR "--always-write did not rewrite the output and deps file")
+endif()
+
+# a changed schema replaces the output, but its deps file stays the same
+wait_a_second()
+file(APPEND ${WORK_DIR}/write_test.sap "struct Line { Point from; Point to; }\n")
+compile_schema()
+read_stamps(CHANGED)
+file(READ ${WORK_DIR}/out.json CHANGED_JSON)
+if(CHANGED_OUTPUT EQUAL ALWAYS_OUTPUT OR NOT CHANGED_JSON MATCHES "\"Line\"" OR CHANGED_JSON STREQUAL FIRST_JSON)
+    message(FATAL_ERROR "changed output was not replaced")
+endif()
+if(NOT CHANGED_DEPS EQUAL ALWAYS_DEPS)
+    message(FATAL_ERROR "unchanged deps file was rewritten")
+endif()
+
+file(GLOB TEMPORARIES ${WORK_DIR}/*.tmp)
+if(TEMPORARIES)
+    message(FATAL_ERROR "temporary files were left behind: ${TEMPORARIES}")
+endif()